@@ -0,0 +1,266 @@
+/* ---------------------------------------------------------------------------
+ * Cell centred data on an AMRHierarchy: one Field per patch per level.
+ *
+ * Coarse-fine synchronisation is conservative:
+ *      averageDown - every coarse cell covered by a finer level is set to
+ *                    the mean of its 2^mD children (restriction)
+ *      prolong     - children take the coarse value plus a minmod-limited
+ *                    slope, whose contributions cancel over the children
+ * so the composite integral (integral()) over uncovered cells is unchanged
+ * by regridding an averaged-down field.
+ * --------------------------------------------------------------------------*/
+
+#ifndef AMR_AMRFIELD_TPP
+#define AMR_AMRFIELD_TPP
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AMRHierarchy.h"
+#include "DataStructures/Field.tpp"
+
+namespace AMR
+{
+    template<size_t fD, size_t mD>
+    class AMRField
+    {
+        using HierarchyPtr = std::shared_ptr<const AMRHierarchy<mD>>;
+        using PatchField = Field<double, fD, mD>;
+        using Index = typename AMRHierarchy<mD>::Index;
+
+    public:
+        using Flags = typename AMRHierarchy<mD>::Flags;
+
+        AMRField(const HierarchyPtr hierarchy, const std::string& name):
+            hierarchy_(hierarchy),
+            name_(name)
+        {
+            for (size_t L=0; L<hierarchy_->numLevels(); L++) {
+                data_.emplace_back();
+                for (const auto& p : hierarchy_->patches(L)) {
+                    data_[L].emplace_back(p.mesh, name_);
+                }
+            }
+        }
+
+        const AMRHierarchy<mD>& hierarchy() const { return *hierarchy_; }
+        HierarchyPtr hierarchyPtr() const { return hierarchy_; }
+        const std::string& name() const { return name_; }
+
+        PatchField& patch(const size_t level, const size_t p) {
+            return data_[level][p];
+        }
+        const PatchField& patch(const size_t level, const size_t p) const {
+            return data_[level][p];
+        }
+
+        // Set every cell on every level: fn(centre, component)
+        template<typename Fn>
+        void setFrom(Fn&& fn) {
+            for (size_t L=0; L<data_.size(); L++) {
+                for (PatchField& f : data_[L]) {
+                    const Mesh<mD>& m = f.mesh();
+                    for (size_t c=0; c<m.numCells(); c++) {
+                        std::array<double, mD> x;
+                        size_t rem = c;
+                        for (size_t d=0; d<mD; d++) {
+                            x[d] = m.centres(d)[rem % m.dimSizes()[d]];
+                            rem /= m.dimSizes()[d];
+                        }
+                        for (size_t comp=0; comp<fD; comp++) {
+                            f.component(comp)[c] = fn(x, comp);
+                        }
+                    }
+                }
+            }
+        }
+
+        // Restrict from the finest level down to level 0
+        void averageDown() {
+            const AMRHierarchy<mD>& h = *hierarchy_;
+            const size_t children = size_t(1) << mD;
+            for (size_t L=data_.size()-1; L>0; L--) {
+                const Index n = h.patchCells(L);
+                const Index nc = h.patchCells(L-1);
+                for (size_t p=0; p<data_[L].size(); p++) {
+                    const auto& fine = h.patch(L, p);
+                    Index first;
+                    for (size_t d=0; d<mD; d++) {
+                        first[d] = fine.lo[d]/2;
+                    }
+                    const size_t cp = h.findPatch(L-1, first);
+                    assert(cp != AMRHierarchy<mD>::npos);
+                    const auto& coarse = h.patch(L-1, cp);
+                    for (size_t comp=0; comp<fD; comp++) {
+                        std::vector<double>& dst = data_[L-1][cp].component(comp);
+                        const std::vector<double>& src = data_[L][p].component(comp);
+                        forEachChild(n, [&](const size_t fc, const Index& cell) {
+                            size_t idx = 0, stride = 1;
+                            for (size_t d=0; d<mD; d++) {
+                                idx += stride*((fine.lo[d] + cell[d])/2 - coarse.lo[d]);
+                                stride *= nc[d];
+                            }
+                            // Children are visited in order, so the first
+                            // one clears the parent
+                            bool firstChild = true;
+                            for (size_t d=0; d<mD; d++) {
+                                firstChild = firstChild && cell[d]%2 == 0;
+                            }
+                            if (firstChild) {
+                                dst[idx] = 0;
+                            }
+                            dst[idx] += src[fc]/children;
+                        });
+                    }
+                }
+            }
+        }
+
+        // Fill a level L patch from level L-1
+        void prolong(const size_t L, const size_t p) {
+            assert(L > 0);
+            const AMRHierarchy<mD>& h = *hierarchy_;
+            const auto& fine = h.patch(L, p);
+            const Index n = h.patchCells(L);
+            const Index nc = h.patchCells(L-1);
+            Index first;
+            for (size_t d=0; d<mD; d++) {
+                first[d] = fine.lo[d]/2;
+            }
+            const size_t cp = h.findPatch(L-1, first);
+            assert(cp != AMRHierarchy<mD>::npos);
+            const auto& coarse = h.patch(L-1, cp);
+            for (size_t comp=0; comp<fD; comp++) {
+                const std::vector<double>& src = data_[L-1][cp].component(comp);
+                std::vector<double>& dst = data_[L][p].component(comp);
+                forEachChild(n, [&](const size_t fc, const Index& cell) {
+                    Index ci;
+                    size_t idx = 0, stride = 1;
+                    for (size_t d=0; d<mD; d++) {
+                        ci[d] = (fine.lo[d] + cell[d])/2 - coarse.lo[d];
+                        idx += stride*ci[d];
+                        stride *= nc[d];
+                    }
+                    double v = src[idx];
+                    stride = 1;
+                    for (size_t d=0; d<mD; d++) {
+                        // Minmod slope, zero at the patch edges
+                        if (ci[d] > 0 && ci[d]+1 < nc[d]) {
+                            const double dm = src[idx] - src[idx-stride];
+                            const double dp = src[idx+stride] - src[idx];
+                            const double s = (dm*dp <= 0) ? 0.0
+                                : std::copysign(std::min(std::fabs(dm),
+                                                         std::fabs(dp)), dm);
+                            v += ((fine.lo[d] + cell[d])%2 == 0 ? -0.25 : 0.25)*s;
+                        }
+                        stride *= nc[d];
+                    }
+                    dst[fc] = v;
+                });
+            }
+        }
+
+        // Copy of this field on a new hierarchy: patches that exist in both
+        // are copied, new patches are prolonged from the next level down
+        AMRField<fD, mD> regridded(const HierarchyPtr newHierarchy) const {
+            AMRField<fD, mD> out(newHierarchy, name_);
+            out.data_[0][0] = data_[0][0];
+            for (size_t L=1; L<out.data_.size(); L++) {
+                for (size_t p=0; p<out.data_[L].size(); p++) {
+                    const size_t old = (L < data_.size())
+                        ? hierarchy_->findPatch(L, newHierarchy->patch(L, p).lo)
+                        : AMRHierarchy<mD>::npos;
+                    if (old != AMRHierarchy<mD>::npos) {
+                        // Shares the buffers until either side writes
+                        out.data_[L][p] = data_[L][old];
+                    } else {
+                        out.prolong(L, p);
+                    }
+                }
+            }
+            return out;
+        }
+
+        // Integral of a component over the composite (uncovered) cells
+        double integral(const size_t comp) const {
+            const AMRHierarchy<mD>& h = *hierarchy_;
+            double total = 0;
+            for (size_t L=0; L<data_.size(); L++) {
+                const Index n = h.patchCells(L);
+                double sum = 0;
+                for (size_t p=0; p<data_[L].size(); p++) {
+                    const auto& patch = h.patch(L, p);
+                    const std::vector<double>& v = data_[L][p].component(comp);
+                    forEachChild(n, [&](const size_t c, const Index& cell) {
+                        Index g;
+                        for (size_t d=0; d<mD; d++) {
+                            g[d] = patch.lo[d] + cell[d];
+                        }
+                        if (!h.covered(L, g)) {
+                            sum += v[c];
+                        }
+                    });
+                }
+                total += sum*h.cellVolume(L);
+            }
+            return total;
+        }
+
+        // Flag cells where a component jumps by more than threshold to a
+        // neighbour in the same patch
+        Flags flagJumps(const size_t comp, const double threshold) const {
+            const AMRHierarchy<mD>& h = *hierarchy_;
+            Flags flags(data_.size());
+            for (size_t L=0; L<data_.size(); L++) {
+                const Index n = h.patchCells(L);
+                for (size_t p=0; p<data_[L].size(); p++) {
+                    const std::vector<double>& v = data_[L][p].component(comp);
+                    std::vector<bool> f(v.size(), false);
+                    forEachChild(n, [&](const size_t c, const Index& cell) {
+                        size_t stride = 1;
+                        for (size_t d=0; d<mD; d++) {
+                            if (cell[d]+1 < n[d]
+                             && std::fabs(v[c+stride] - v[c]) > threshold) {
+                                f[c] = true;
+                                f[c+stride] = true;
+                            }
+                            stride *= n[d];
+                        }
+                    });
+                    flags[L].push_back(std::move(f));
+                }
+            }
+            return flags;
+        }
+
+    private:
+        HierarchyPtr hierarchy_;
+        std::string name_;
+        std::vector<std::vector<PatchField>> data_;
+
+        // fn(flatIndex, cell) over a box of n cells in storage order
+        template<typename Fn>
+        static void forEachChild(const Index& n, Fn&& fn) {
+            size_t total = 1;
+            for (size_t d=0; d<mD; d++) {
+                total *= n[d];
+            }
+            Index cell;
+            cell.fill(0);
+            for (size_t c=0; c<total; c++) {
+                fn(c, cell);
+                for (size_t d=0; d<mD; d++) {
+                    if (++cell[d] < n[d]) {
+                        break;
+                    }
+                    cell[d] = 0;
+                }
+            }
+        }
+    };
+}
+
+#endif // AMR_AMRFIELD_TPP
@@ -0,0 +1,217 @@
+#include "AMRHierarchy.h"
+
+#include <set>
+#include <utility>
+
+namespace AMR {
+
+namespace {
+    template<size_t mD, size_t... Is>
+    std::shared_ptr<const Mesh<mD>> uniformMesh(const size_t n,
+                                               const std::array<double, mD>& lo,
+                                               const std::array<double, mD>& hi,
+                                               std::index_sequence<Is...>)
+    {
+        return std::make_shared<Mesh<mD>>(MeshScalingType::Constant,
+            MeshDimension(static_cast<int>(n), lo[Is], hi[Is])...);
+    }
+}
+
+template<size_t mD>
+AMRHierarchy<mD>::AMRHierarchy(const MeshPtr base, const size_t maxLevel,
+                               const size_t blockSize):
+    maxLevel_(maxLevel),
+    blockSize_(blockSize)
+{
+    assert(base->scalingType() == MeshScalingType::Constant);
+    assert(base->ordering() == CellOrdering::Lexicographic);
+    assert(blockSize_ >= 2 && blockSize_%2 == 0);
+    for (size_t d=0; d<mD; d++) {
+        // Level 1 tiles must fit the base mesh exactly
+        assert(base->dimSizes()[d] % (blockSize_/2) == 0);
+    }
+    Patch root;
+    root.block.fill(0);
+    root.lo.fill(0);
+    root.mesh = base;
+    levels_.push_back({ root });
+    lookup_.emplace_back();
+    lookup_[0][root.block] = 0;
+}
+
+template<size_t mD>
+typename AMRHierarchy<mD>::Index
+AMRHierarchy<mD>::patchCells(const size_t level) const
+{
+    Index n;
+    for (size_t d=0; d<mD; d++) {
+        n[d] = (level == 0 ? baseMesh().dimSizes()[d] : blockSize_);
+    }
+    return n;
+}
+
+template<size_t mD>
+double AMRHierarchy<mD>::cellSize(const size_t level, const size_t d) const
+{
+    const Mesh<mD>& base = baseMesh();
+    return (base.dimMax()[d] - base.dimMin()[d])
+            / (base.dimSizes()[d] * static_cast<double>(size_t(1) << level));
+}
+
+template<size_t mD>
+double AMRHierarchy<mD>::cellVolume(const size_t level) const
+{
+    double v = 1;
+    for (size_t d=0; d<mD; d++) {
+        v *= cellSize(level, d);
+    }
+    return v;
+}
+
+template<size_t mD>
+size_t AMRHierarchy<mD>::findPatch(const size_t level, const Index& cell) const
+{
+    if (level >= levels_.size()) {
+        return npos;
+    }
+    const Index n = patchCells(level);
+    Index block;
+    for (size_t d=0; d<mD; d++) {
+        block[d] = cell[d] / n[d];
+    }
+    auto it = lookup_[level].find(block);
+    return it == lookup_[level].end() ? npos : it->second;
+}
+
+template<size_t mD>
+bool AMRHierarchy<mD>::covered(const size_t level, const Index& cell) const
+{
+    Index fine;
+    for (size_t d=0; d<mD; d++) {
+        fine[d] = 2*cell[d];
+    }
+    return findPatch(level+1, fine) != npos;
+}
+
+template<size_t mD>
+size_t AMRHierarchy<mD>::numLeafCells() const
+{
+    size_t tile = 1;
+    for (size_t d=0; d<mD; d++) {
+        tile *= blockSize_/2;
+    }
+    size_t n = 0;
+    for (size_t L=0; L<levels_.size(); L++) {
+        for (const Patch& p : levels_[L]) {
+            n += p.mesh->numCells();
+        }
+        if (L+1 < levels_.size()) {
+            n -= levels_[L+1].size() * tile;
+        }
+    }
+    return n;
+}
+
+template<size_t mD>
+void AMRHierarchy<mD>::addLevel(const std::vector<Index>& blocks)
+{
+    const size_t L = levels_.size();
+    const Mesh<mD>& base = baseMesh();
+    levels_.emplace_back();
+    lookup_.emplace_back();
+    for (const Index& b : blocks) {
+        Patch p;
+        p.block = b;
+        std::array<double, mD> lo, hi;
+        for (size_t d=0; d<mD; d++) {
+            p.lo[d] = b[d]*blockSize_;
+            const double h = cellSize(L, d);
+            lo[d] = base.dimMin()[d] + h*p.lo[d];
+            hi[d] = base.dimMin()[d] + h*(p.lo[d] + blockSize_);
+        }
+        p.mesh = uniformMesh<mD>(blockSize_, lo, hi,
+                                 std::make_index_sequence<mD>{});
+        lookup_[L][b] = levels_[L].size();
+        levels_[L].push_back(std::move(p));
+    }
+}
+
+template<size_t mD>
+AMRHierarchy<mD> AMRHierarchy<mD>::regrid(const Flags& flags) const
+{
+    AMRHierarchy<mD> h;
+    h.maxLevel_ = maxLevel_;
+    h.blockSize_ = blockSize_;
+    h.levels_.push_back(levels_[0]);
+    h.lookup_.push_back(lookup_[0]);
+
+    const size_t tile = blockSize_/2;
+    size_t neighbours = 1;
+    for (size_t d=0; d<mD; d++) {
+        neighbours *= 3;
+    }
+    for (size_t L=0; L<maxLevel_ && L<levels_.size() && L<flags.size(); L++) {
+        // Level L extent, for clipping the buffer
+        Index extent;
+        for (size_t d=0; d<mD; d++) {
+            extent[d] = baseMesh().dimSizes()[d] << L;
+        }
+        // Level L+1 blocks are the tiles holding flagged cells
+        std::set<Index> tiles;
+        for (size_t p=0; p<levels_[L].size(); p++) {
+            const Patch& patch = levels_[L][p];
+            const Index n = patchCells(L);
+            assert(flags[L][p].size() == patch.mesh->numCells());
+            for (size_t c=0; c<flags[L][p].size(); c++) {
+                if (!flags[L][p][c]) {
+                    continue;
+                }
+                Index cell;
+                size_t rem = c;
+                for (size_t d=0; d<mD; d++) {
+                    cell[d] = patch.lo[d] + rem % n[d];
+                    rem /= n[d];
+                }
+                for (size_t k=0; k<neighbours; k++) {
+                    Index t;
+                    bool inside = true;
+                    size_t code = k;
+                    for (size_t d=0; d<mD; d++) {
+                        const long off = static_cast<long>(code % 3) - 1;
+                        code /= 3;
+                        const long x = static_cast<long>(cell[d]) + off;
+                        inside = inside && x >= 0
+                                && x < static_cast<long>(extent[d]);
+                        t[d] = inside ? static_cast<size_t>(x)/tile : 0;
+                    }
+                    if (inside) {
+                        tiles.insert(t);
+                    }
+                }
+            }
+        }
+        // Keep only tiles nested inside the new level L
+        std::vector<Index> blocks;
+        for (const Index& t : tiles) {
+            Index first;
+            for (size_t d=0; d<mD; d++) {
+                first[d] = t[d]*tile;
+            }
+            if (h.findPatch(L, first) != npos) {
+                blocks.push_back(t);
+            }
+        }
+        if (blocks.empty()) {
+            break;
+        }
+        h.addLevel(blocks);
+    }
+    return h;
+}
+
+// Instantiate templates
+template class AMRHierarchy<1>;
+template class AMRHierarchy<2>;
+template class AMRHierarchy<3>;
+
+}
@@ -0,0 +1,96 @@
+/* ---------------------------------------------------------------------------
+ * Block-structured adaptive mesh refinement.
+ *
+ * Level 0 is a single patch covering the whole base Mesh, which must have
+ * constant spacing. Every finer level refines by a factor of 2 and is made
+ * of patches of blockSize cells along each dimension, aligned to multiples
+ * of blockSize in that level's index space. Each patch owns a Mesh<mD> of
+ * its own (constant spacing), so per-patch Fields and the existing
+ * operators work unchanged on patches.
+ *
+ * A level L+1 patch covers blockSize/2 cells of level L along each
+ * dimension. Because those tiles are aligned inside the level L blocks,
+ * building level L+1 only from flagged level L cells keeps the levels
+ * properly nested.
+ *
+ * The hierarchy is immutable: regrid() builds a new one from flags on the
+ * current levels, and AMRField::regridded() moves data onto it.
+ * --------------------------------------------------------------------------*/
+
+#ifndef AMR_AMRHIERARCHY_H
+#define AMR_AMRHIERARCHY_H
+
+#include <array>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "DataStructures/Mesh.h"
+
+namespace AMR
+{
+    template<size_t mD>
+    class AMRHierarchy
+    {
+        using MeshPtr = std::shared_ptr<const Mesh<mD>>;
+
+    public:
+        using Index = std::array<size_t, mD>;
+        // flags[level][patch][cell], cells in the patch Mesh ordering
+        using Flags = std::vector<std::vector<std::vector<bool>>>;
+
+        struct Patch {
+            Index block;    // Block coordinate within the level
+            Index lo;       // First cell, in level index space
+            MeshPtr mesh;
+        };
+
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+        AMRHierarchy(const MeshPtr base, const size_t maxLevel,
+                     const size_t blockSize = 8);
+
+        size_t numLevels() const { return levels_.size(); }
+        size_t maxLevel() const { return maxLevel_; }
+        size_t blockSize() const { return blockSize_; }
+
+        const std::vector<Patch>& patches(const size_t level) const {
+            assert(level < levels_.size());
+            return levels_[level];
+        }
+        const Patch& patch(const size_t level, const size_t p) const {
+            return patches(level)[p];
+        }
+        const Mesh<mD>& baseMesh() const { return *levels_[0][0].mesh; }
+
+        // Cells along each dimension of a patch on this level
+        Index patchCells(const size_t level) const;
+        double cellSize(const size_t level, const size_t d) const;
+        double cellVolume(const size_t level) const;
+
+        // Patch containing a cell (level index space), or npos
+        size_t findPatch(const size_t level, const Index& cell) const;
+        // Whether a cell is covered by a patch on the next level
+        bool covered(const size_t level, const Index& cell) const;
+
+        // Cells not covered by a finer level
+        size_t numLeafCells() const;
+
+        // New hierarchy refining the flagged cells (and a buffer of one
+        // cell around them) on every level below maxLevel
+        AMRHierarchy<mD> regrid(const Flags& flags) const;
+
+    private:
+        size_t maxLevel_;
+        size_t blockSize_;
+        std::vector<std::vector<Patch>> levels_;
+        std::vector<std::map<Index, size_t>> lookup_;
+
+        AMRHierarchy() = default;
+
+        void addLevel(const std::vector<Index>& blocks);
+    };
+}
+
+#endif // AMR_AMRHIERARCHY_H
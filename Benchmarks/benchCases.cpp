@@ -0,0 +1,92 @@
+/* ---------------------------------------------------------------------------
+ * Throughput of a parameter sweep: upwind advection of a blob at several
+ * resolutions and Courant numbers, run one case after another (each using
+ * the whole pool for its loops) and then through a CaseRunner.
+ *
+ * Usage: benchCases [largestSide] [steps]
+ * --------------------------------------------------------------------------*/
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "DataStructures/Field.tpp"
+#include "DataStructures/Mesh.h"
+#include "FieldOperations/TemporalBlocking.h"
+#include "Parallel/CaseRunner.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double secondsSince(const Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // One case of the sweep, returning the peak value at the end
+    double advect(const int side, const double courant, const size_t steps) {
+        const MeshDimension dim(side, -1, 1);
+        auto mesh = std::make_shared<Mesh<2>>(MeshScalingType::Constant,
+                                              dim, dim);
+        Field<double, 2, 2> U(mesh, "U");
+        Field<double, 1, 2> q(mesh, "q");
+        const size_t nx = mesh->xCells();
+        for (size_t c=0; c<mesh->numCells(); c++) {
+            const double x = mesh->centres(0)[c % nx];
+            const double y = mesh->centres(1)[c / nx];
+            U.x()[c] = -y;
+            U.y()[c] = x;
+            q.x()[c] = std::exp(-20*((x-0.4)*(x-0.4) + y*y));
+        }
+        const FieldOps::UpwindAdvectionStep<2> step(U, courant*2.0/side);
+        FieldOps::TemporalBlocking<2> blocked(mesh, 4);
+        blocked.advance(q.x(), steps, step);
+        double peak = 0;
+        for (double v : q.x()) {
+            peak = std::max(peak, v);
+        }
+        return peak;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const int largest = (argc > 1 ? std::atoi(argv[1]) : 1024);
+    const size_t steps = (argc > 2 ? std::atoi(argv[2]) : 16);
+    std::vector<int> sides;
+    for (int side=largest; side>=64; side/=2) {
+        sides.push_back(side);
+    }
+    const double courants[] = { 0.1, 0.2, 0.4, 0.8 };
+    const size_t nCases = sides.size()*4;
+
+    std::vector<double> sequential, batched(nCases);
+    Clock::time_point start = Clock::now();
+    for (int side : sides) {
+        for (double c : courants) {
+            sequential.push_back(advect(side, c, steps));
+        }
+    }
+    const double tSeq = secondsSince(start);
+
+    Parallel::CaseRunner runner;
+    size_t k = 0;
+    for (int side : sides) {
+        for (double c : courants) {
+            runner.add("advect", double(side)*side*steps,
+                       [&batched, k, side, c, steps]() {
+                           batched[k] = advect(side, c, steps);
+                       });
+            k++;
+        }
+    }
+    const double tRun = runner.run();
+
+    std::cout << nCases << " cases, " << Parallel::ThreadPool::global().size()
+              << " threads (seconds)\n"
+              << "  one after another  " << tSeq << "\n"
+              << "  CaseRunner         " << tRun
+              << (batched == sequential ? "" : "  (differs!)") << "\n";
+}
@@ -0,0 +1,96 @@
+/* ---------------------------------------------------------------------------
+ * div(Rho U) in 2D, fused against staged.
+ *
+ * Staged: the flux Rho*U is formed as a full vector Field, then its
+ * divergence is taken in a second sweep. Fused: one FusedSweep computes the
+ * flux in tile-local scratch and differentiates it in the same pass. Both
+ * use the same kernels, so the difference is the memory traffic.
+ *
+ * Usage: benchFusion [cellsPerSide] [repeats]
+ * --------------------------------------------------------------------------*/
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "DataStructures/Field.tpp"
+#include "DataStructures/Mesh.h"
+#include "FieldOperations/Fusion.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+    using Slot = FieldOps::FusedSweep<2>::Slot;
+
+    double secondsSince(const Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const int side = (argc > 1 ? std::atoi(argv[1]) : 2048);
+    const size_t repeats = (argc > 2 ? std::atoi(argv[2]) : 10);
+    const MeshDimension dim(side, 0, 1);
+    auto mesh = std::make_shared<Mesh<2>>(MeshScalingType::Constant, dim, dim);
+    const double cells = static_cast<double>(mesh->numCells()) * repeats;
+
+    Field<double, 1, 2> Rho(mesh, "Rho");
+    Field<double, 2, 2> U(mesh, "U");
+    for (size_t c=0; c<mesh->numCells(); c++) {
+        Rho.x()[c] = 1 + 0.1*std::sin(0.01*c);
+        U.x()[c] = std::cos(0.02*c);
+        U.y()[c] = std::sin(0.03*c);
+    }
+    std::vector<double> staged, fused;
+
+    // Staged, the flux written into preallocated Fields
+    Field<double, 2, 2> flux(mesh, "flux");
+    FieldOps::FusedSweep<2> divOnly(mesh);
+    divOnly.output(divOnly.divergence({{ divOnly.input(flux, 0),
+                                         divOnly.input(flux, 1) }}),
+                   staged);
+    Clock::time_point start = Clock::now();
+    for (size_t r=0; r<repeats; r++) {
+        const double* rhoV = Rho.x().data();
+        for (size_t d=0; d<2; d++) {
+            const double* in = U.component(d).data();
+            double* out = flux.component(d).data();
+            for (size_t c=0; c<mesh->numCells(); c++) {
+                out[c] = rhoV[c]*in[c];
+            }
+        }
+        divOnly.run();
+    }
+    const double tStaged = secondsSince(start);
+
+    // Fused
+    FieldOps::FusedSweep<2> sweep(mesh);
+    const Slot rho = sweep.input(Rho);
+    const Slot u = sweep.input(U, 0);
+    const Slot v = sweep.input(U, 1);
+    auto F = sweep.pointwise<2>(std::array<Slot, 3>{{ rho, u, v }},
+        [](const std::array<double, 3>& a, std::array<double, 2>& f) {
+            f[0] = a[0]*a[1];
+            f[1] = a[0]*a[2];
+        });
+    sweep.output(sweep.divergence(F), fused);
+    start = Clock::now();
+    for (size_t r=0; r<repeats; r++) {
+        sweep.run();
+    }
+    const double tFused = secondsSince(start);
+
+    double maxDiff = 0;
+    for (size_t c=0; c<fused.size(); c++) {
+        maxDiff = std::max(maxDiff, std::fabs(fused[c] - staged[c]));
+    }
+    std::cout << "div(Rho U), " << side << "^2 cells, " << repeats
+              << " evaluations (ns per cell)\n";
+    std::cout << "  staged  " << 1e9*tStaged/cells << "\n";
+    std::cout << "  fused   " << 1e9*tFused/cells << "\n";
+    std::cout << "  max difference " << maxDiff << "\n";
+}
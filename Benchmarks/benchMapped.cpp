@@ -0,0 +1,86 @@
+/* ---------------------------------------------------------------------------
+ * Out-of-core stencils: the 4th order 3D Laplacian on MappedFields
+ * streamed slab by slab, against the same on in-memory Fields, with the
+ * peak resident memory of the process after each.
+ *
+ * Usage: benchMapped [cellsPerSide] [directory] [slabPlanes]
+ * --------------------------------------------------------------------------*/
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "DataStructures/Field.tpp"
+#include "DataStructures/MappedField.tpp"
+#include "DataStructures/Mesh.h"
+#include "FieldOperations/Stencil.tpp"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double secondsSince(const Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // Peak resident set (VmHWM) in MB, or -1 where /proc is not available
+    double peakResidentMB() {
+        std::ifstream status("/proc/self/status");
+        std::string key;
+        while (status >> key) {
+            if (key == "VmHWM:") {
+                double kB;
+                status >> kB;
+                return kB/1024;
+            }
+        }
+        return -1;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    using namespace FieldOps;
+    const int side = (argc > 1 ? std::atoi(argv[1]) : 256);
+    const std::string dir = (argc > 2 ? argv[2] : "/tmp");
+    const size_t slab = (argc > 3 ? std::atoi(argv[3]) : 0);
+    const MeshDimension dim(side, 0, 1);
+    auto mesh = std::make_shared<Mesh<3>>(MeshScalingType::Constant,
+                                          dim, dim, dim);
+    const double cells = static_cast<double>(mesh->numCells());
+    std::cout << "4th order Laplacian, " << side << "^3 cells, "
+              << cells*8/(1 << 20) << " MB per array\n";
+
+    // Mapped first, so the peak is not the in-memory run's
+    MappedField<double, 1, 3> mq(mesh, "benchQ", dir),
+                              mlap(mesh, "benchLap", dir);
+    if (!mq.good() || !mlap.good()) {
+        std::cout << "Cannot map files in " << dir << "\n";
+        return 1;
+    }
+    // Filled a plane at a time, released as it goes
+    double* q = mq.component(0);
+    const size_t planeCells = mesh->numCells()/side;
+    for (size_t p=0; p<size_t(side); p++) {
+        for (size_t c=p*planeCells; c<(p+1)*planeCells; c++) {
+            q[c] = std::sin(0.001*c);
+        }
+        mq.release(p*planeCells, (p+1)*planeCells);
+    }
+    const double before = peakResidentMB();
+    Clock::time_point start = Clock::now();
+    laplacian<Stencils::CentralSecond4>(mq, mlap, slab);
+    std::cout << "  MappedField  " << 1e9*secondsSince(start)/cells
+              << " ns/cell, peak resident " << peakResidentMB()
+              << " MB (" << before << " before)\n";
+
+    Field<double, 1, 3> f = mq.toField(), lap(mesh, "lap");
+    start = Clock::now();
+    laplacian<Stencils::CentralSecond4>(f, lap);
+    std::cout << "  Field        " << 1e9*secondsSince(start)/cells
+              << " ns/cell, peak resident " << peakResidentMB() << " MB"
+              << (mlap.toField() == lap ? "" : "  (differs!)") << "\n";
+}
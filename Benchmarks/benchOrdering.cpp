@@ -0,0 +1,118 @@
+/* ---------------------------------------------------------------------------
+ * Compares cell orderings on a 7-point Laplacian stencil in 3D.
+ *
+ * Every ordering is timed with the same kernel: cells are visited in
+ * storage order and neighbours come from a precomputed table, so the only
+ * difference is the memory locality of the gathers. The direct strided
+ * kernel on lexicographic storage is timed as the baseline.
+ *
+ * Usage: benchOrdering [cellsPerSide] [repeats]
+ * --------------------------------------------------------------------------*/
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "DataStructures/Field.tpp"
+#include "DataStructures/Mesh.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double secondsSince(const Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // Neighbour storage indices (-x,+x,-y,+y,-z,+z) of every cell, with
+    // boundary cells using themselves
+    std::vector<size_t> neighbourTable(const Mesh<3>& mesh) {
+        const size_t n = mesh.numCells();
+        std::vector<size_t> table(6*n);
+        for (size_t c=0; c<n; c++) {
+            for (size_t d=0; d<3; d++) {
+                for (long side=0; side<2; side++) {
+                    const size_t nb = mesh.neighbour(c, d, 2*side-1);
+                    table[6*c + 2*d + side] = (nb == Mesh<3>::npos ? c : nb);
+                }
+            }
+        }
+        return table;
+    }
+
+    double tableStencil(const Mesh<3>& mesh, const size_t repeats) {
+        const size_t n = mesh.numCells();
+        const std::vector<size_t> nb = neighbourTable(mesh);
+        std::vector<double> q(n), out(n);
+        for (size_t c=0; c<n; c++) {
+            q[mesh.storageIndex(c)] = c % 17;
+        }
+        const Clock::time_point start = Clock::now();
+        for (size_t r=0; r<repeats; r++) {
+            for (size_t c=0; c<n; c++) {
+                const size_t* s = &nb[6*c];
+                out[c] = q[s[0]] + q[s[1]] + q[s[2]] + q[s[3]]
+                       + q[s[4]] + q[s[5]] - 6*q[c];
+            }
+            std::swap(q, out);
+        }
+        const double t = secondsSince(start);
+        volatile double sink = q[n/2];
+        (void)sink;
+        return t;
+    }
+
+    double stridedStencil(const Mesh<3>& mesh, const size_t repeats) {
+        const size_t nx = mesh.xCells(), ny = mesh.yCells(), nz = mesh.zCells();
+        const size_t n = mesh.numCells();
+        std::vector<double> q(n), out(n);
+        for (size_t c=0; c<n; c++) {
+            q[c] = c % 17;
+        }
+        const Clock::time_point start = Clock::now();
+        for (size_t r=0; r<repeats; r++) {
+            for (size_t k=0; k<nz; k++) {
+                for (size_t j=0; j<ny; j++) {
+                    for (size_t i=0; i<nx; i++) {
+                        const size_t c = i + nx*(j + ny*k);
+                        out[c] = q[i > 0 ? c-1 : c] + q[i+1 < nx ? c+1 : c]
+                               + q[j > 0 ? c-nx : c] + q[j+1 < ny ? c+nx : c]
+                               + q[k > 0 ? c-nx*ny : c]
+                               + q[k+1 < nz ? c+nx*ny : c] - 6*q[c];
+                    }
+                }
+            }
+            std::swap(q, out);
+        }
+        const double t = secondsSince(start);
+        volatile double sink = q[n/2];
+        (void)sink;
+        return t;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const int side = (argc > 1 ? std::atoi(argv[1]) : 128);
+    const size_t repeats = (argc > 2 ? std::atoi(argv[2]) : 10);
+    const MeshDimension dim(side, 0, 1);
+    const Mesh<3> lex(MeshScalingType::Constant, dim, dim, dim);
+    const double cells = static_cast<double>(lex.numCells()) * repeats;
+
+    std::cout << "7-point stencil, " << side << "^3 cells, "
+              << repeats << " sweeps (ns per cell update)\n";
+    std::cout << "  strided lexicographic  "
+              << 1e9*stridedStencil(lex, repeats)/cells << "\n";
+    const std::pair<const char*, CellOrdering> orders[] = {
+        { "lexicographic", CellOrdering::Lexicographic },
+        { "tiled (8)    ", CellOrdering::Tiled },
+        { "morton       ", CellOrdering::Morton },
+        { "hilbert      ", CellOrdering::Hilbert }
+    };
+    for (const auto& o : orders) {
+        const Mesh<3> mesh = lex.reordered(o.second, 8);
+        std::cout << "  table " << o.first << "    "
+                  << 1e9*tableStencil(mesh, repeats)/cells << "\n";
+    }
+}
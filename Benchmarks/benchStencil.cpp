@@ -0,0 +1,171 @@
+/* ---------------------------------------------------------------------------
+ * Kernels generated from stencil descriptions against hand written loops:
+ * the 2nd and 4th order Laplacian in 3D on a uniform Mesh, and the 2nd
+ * order one on a stretched Mesh (per-cell weights), then on a narrow band
+ * around a blob (ActiveCells) against the whole Mesh, and finally an
+ * ensemble of realisations in one EnsembleField against a loop over
+ * separate Fields.
+ *
+ * Usage: benchStencil [cellsPerSide] [repeats]
+ * --------------------------------------------------------------------------*/
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "DataStructures/ActiveCells.h"
+#include "DataStructures/EnsembleField.tpp"
+#include "DataStructures/Field.tpp"
+#include "DataStructures/Mesh.h"
+#include "FieldOperations/Stencil.tpp"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double secondsSince(const Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // 7 point Laplacian with zero gradient boundaries, uniform spacing
+    void handLaplacian(const Mesh<3>& mesh, const std::vector<double>& q,
+                       std::vector<double>& out) {
+        const auto& dims = mesh.dimSizes();
+        const size_t nx = dims[0], ny = dims[1], nz = dims[2];
+        double inv[3];
+        for (size_t d=0; d<3; d++) {
+            const double h = (mesh.edges(d).back() - mesh.edges(d).front())
+                             / dims[d];
+            inv[d] = 1/(h*h);
+        }
+        for (size_t k=0; k<nz; k++) {
+            for (size_t j=0; j<ny; j++) {
+                const size_t row = (k*ny + j)*nx;
+                const double* c = q.data() + row;
+                const double* s = q.data() + (k*ny + (j>0 ? j-1 : j))*nx;
+                const double* n = q.data() + (k*ny + (j+1<ny ? j+1 : j))*nx;
+                const double* b = q.data() + ((k>0 ? k-1 : k)*ny + j)*nx;
+                const double* t = q.data() + ((k+1<nz ? k+1 : k)*ny + j)*nx;
+                for (size_t i=0; i<nx; i++) {
+                    const double w = c[i > 0 ? i-1 : i];
+                    const double e = c[i+1 < nx ? i+1 : i];
+                    out[row + i] = (w - 2*c[i] + e)*inv[0]
+                                 + (s[i] - 2*c[i] + n[i])*inv[1]
+                                 + (b[i] - 2*c[i] + t[i])*inv[2];
+                }
+            }
+        }
+    }
+
+    template<typename Fn>
+    double nsPerCell(const size_t repeats, const double cells, Fn fn) {
+        fn();
+        const Clock::time_point start = Clock::now();
+        for (size_t r=0; r<repeats; r++) {
+            fn();
+        }
+        return 1e9*secondsSince(start)/(cells*repeats);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    using namespace FieldOps;
+    const int side = (argc > 1 ? std::atoi(argv[1]) : 160);
+    const size_t repeats = (argc > 2 ? std::atoi(argv[2]) : 10);
+    const MeshDimension dim(side, 0, 1);
+
+    std::cout << "3D Laplacian, " << side << "^3 cells (ns per cell)\n";
+    for (auto scaling : { MeshScalingType::Constant,
+                          MeshScalingType::Hyperbolic }) {
+        auto mesh = std::make_shared<Mesh<3>>(scaling, dim, dim, dim);
+        const double cells = static_cast<double>(mesh->numCells());
+        Field<double, 1, 3> q(mesh, "q"), lap(mesh, "lap");
+        for (size_t c=0; c<mesh->numCells(); c++) {
+            q.x()[c] = std::sin(0.001*c);
+        }
+        const bool uniform = (scaling == MeshScalingType::Constant);
+        std::cout << (uniform ? "  Uniform\n" : "  Stretched\n");
+
+        if (uniform) {
+            std::vector<double> ref(mesh->numCells());
+            std::cout << "    hand written     "
+                      << nsPerCell(repeats, cells, [&]() {
+                             handLaplacian(*mesh, q.x(), ref);
+                         }) << "\n";
+        }
+        std::cout << "    CentralSecond    "
+                  << nsPerCell(repeats, cells, [&]() {
+                         laplacian<Stencils::CentralSecond>(q, lap);
+                     }) << "\n";
+        std::cout << "    CentralSecond4   "
+                  << nsPerCell(repeats, cells, [&]() {
+                         laplacian<Stencils::CentralSecond4>(q, lap);
+                     }) << "\n";
+    }
+
+    // Blob of radius 0.15 in the unit cube, band of 2 cells
+    auto mesh = std::make_shared<Mesh<3>>(MeshScalingType::Constant,
+                                          dim, dim, dim);
+    const double cells = static_cast<double>(mesh->numCells());
+    Field<double, 1, 3> q(mesh, "q"), lap(mesh, "lap");
+    for (size_t c=0; c<mesh->numCells(); c++) {
+        double r2 = 0;
+        const auto sub = mesh->cellSubIndex(c);
+        for (size_t d=0; d<3; d++) {
+            const double x = mesh->centres(d)[sub[d]] - 0.5;
+            r2 += x*x;
+        }
+        q.x()[c] = r2 < 0.15*0.15 ? 1 : 0;
+    }
+    ActiveCells<3> band(mesh);
+    band.narrowBand(q.x(), 0.5, 2);
+    std::cout << "  Narrow band, " << 100*band.fraction()
+              << "% of cells (ns per Mesh cell)\n"
+              << "    whole Mesh       "
+              << nsPerCell(repeats, cells, [&]() {
+                     laplacian<Stencils::CentralSecond>(q, lap);
+                 }) << "\n"
+              << "    band only        "
+              << nsPerCell(repeats, cells, [&]() {
+                     laplacian<Stencils::CentralSecond>(q, lap, band);
+                 }) << "\n"
+              << "    band update      "
+              << nsPerCell(repeats, cells, [&]() {
+                     band.updateBand(q.x(), 0.5, 2);
+                 }) << "\n";
+
+    // Ensemble on a small stretched Mesh, where per-cell weights dominate
+    const size_t nMembers = 32;
+    const MeshDimension small(side/4, 0, 1);
+    auto smallMesh = std::make_shared<Mesh<3>>(MeshScalingType::Hyperbolic,
+                                               small, small, small);
+    EnsembleField<double, 1, 3> E(smallMesh, "q", nMembers),
+                                lapE(smallMesh, "lap", nMembers);
+    std::vector<Field<double, 1, 3>> fields, laps;
+    for (size_t m=0; m<nMembers; m++) {
+        fields.emplace_back(smallMesh, "q");
+        laps.emplace_back(smallMesh, "lap");
+        for (size_t c=0; c<smallMesh->numCells(); c++) {
+            fields[m].x()[c] = std::sin(0.01*c*(m+1));
+        }
+        E.setMember(m, fields[m]);
+    }
+    const double memberCells =
+        static_cast<double>(smallMesh->numCells())*nMembers;
+    std::cout << "  Ensemble of " << nMembers << ", " << side/4
+              << "^3 stretched cells (ns per member cell)\n"
+              << "    separate Fields  "
+              << nsPerCell(repeats, memberCells, [&]() {
+                     for (size_t m=0; m<nMembers; m++) {
+                         laplacian<Stencils::CentralSecond>(fields[m],
+                                                            laps[m]);
+                     }
+                 }) << "\n"
+              << "    EnsembleField    "
+              << nsPerCell(repeats, memberCells, [&]() {
+                     laplacian<Stencils::CentralSecond>(E, lapE);
+                 }) << "\n";
+}
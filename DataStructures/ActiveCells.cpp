@@ -0,0 +1,145 @@
+#include "ActiveCells.h"
+
+#include <cmath>
+
+template<size_t meshDim>
+ActiveCells<meshDim>::ActiveCells(const MeshPtr mesh):
+    mesh_(mesh),
+    bits_((mesh->numCells() + 63)/64, 0)
+{}
+
+template<size_t meshDim>
+void ActiveCells<meshDim>::clear()
+{
+    unmarkAll();
+    runs_.clear();
+}
+
+template<size_t meshDim>
+void ActiveCells<meshDim>::activateAll()
+{
+    select([](size_t) { return true; });
+}
+
+template<size_t meshDim>
+void ActiveCells<meshDim>::activate(const std::vector<size_t>& cells)
+{
+    for (size_t c : cells) {
+        assert(c < mesh_->numCells());
+        if (mark(c)) {
+            cells_.push_back(c);
+        }
+    }
+    std::sort(cells_.begin(), cells_.end());
+    finish();
+}
+
+template<size_t meshDim>
+void ActiveCells<meshDim>::narrowBand(const std::vector<double>& q,
+                                      const double threshold,
+                                      const size_t width)
+{
+    assert(q.size() == mesh_->numCells());
+    std::vector<size_t> seeds;
+    for (size_t c=0; c<q.size(); c++) {
+        if (std::fabs(q[c]) > threshold) {
+            seeds.push_back(c);
+        }
+    }
+    grow(std::move(seeds), width);
+}
+
+template<size_t meshDim>
+void ActiveCells<meshDim>::updateBand(const std::vector<double>& q,
+                                      const double threshold,
+                                      const size_t width)
+{
+    assert(q.size() == mesh_->numCells());
+    std::vector<size_t> seeds;
+    for (size_t c : cells_) {
+        if (std::fabs(q[c]) > threshold) {
+            seeds.push_back(c);
+        }
+    }
+    grow(std::move(seeds), width);
+}
+
+template<size_t meshDim>
+void ActiveCells<meshDim>::unmarkAll()
+{
+    for (size_t c : cells_) {
+        bits_[c/64] = 0;
+    }
+    cells_.clear();
+}
+
+template<size_t meshDim>
+void ActiveCells<meshDim>::grow(std::vector<size_t>&& seeds,
+                                const size_t width)
+{
+    unmarkAll();
+    cells_ = std::move(seeds);
+    for (size_t c : cells_) {
+        mark(c);
+    }
+    // One dimension at a time, so the band is a box around every seed
+    const long w = static_cast<long>(width);
+    const bool lex = (mesh_->ordering() == CellOrdering::Lexicographic);
+    const std::vector<size_t>& dims = mesh_->dimSizes();
+    size_t stride = 1;
+    for (size_t d=0; d<meshDim && w>0; d++) {
+        const long N = static_cast<long>(dims[d]);
+        const size_t n = cells_.size();
+        for (size_t k=0; k<n; k++) {
+            const size_t c = cells_[k];
+            if (!lex) {
+                for (long o=-w; o<=w; o++) {
+                    const size_t nb = (o == 0 ? Mesh<meshDim>::npos
+                                              : mesh_->neighbour(c, d, o));
+                    if (nb != Mesh<meshDim>::npos && mark(nb)) {
+                        cells_.push_back(nb);
+                    }
+                }
+                continue;
+            }
+            const long i = static_cast<long>((c / stride) % dims[d]);
+            const long oBegin = std::max(-w, -i);
+            const long oEnd = std::min(w, N-1-i);
+            for (long o=oBegin; o<=oEnd; o++) {
+                const size_t nb = c + o*static_cast<long>(stride);
+                if (mark(nb)) {
+                    cells_.push_back(nb);
+                }
+            }
+        }
+        stride *= dims[d];
+    }
+    // In storage order, straight from the bitmask
+    cells_.clear();
+    for (size_t k=0; k<bits_.size(); k++) {
+        for (uint64_t word = bits_[k]; word; word &= word-1) {
+            cells_.push_back(k*64 + __builtin_ctzll(word));
+        }
+    }
+    finish();
+}
+
+template<size_t meshDim>
+void ActiveCells<meshDim>::finish()
+{
+    runs_.clear();
+    for (size_t k=0; k<cells_.size();) {
+        const size_t begin = cells_[k];
+        size_t end = begin + 1;
+        for (k++; k<cells_.size() && cells_[k]==end
+                  && end-begin<Parallel::defaultGrain; k++) {
+            end++;
+        }
+        runs_.emplace_back(begin, end);
+    }
+}
+
+// Instantiate templates
+template class ActiveCells<1>;
+template class ActiveCells<2>;
+template class ActiveCells<3>;
@@ -0,0 +1,136 @@
+/* ---------------------------------------------------------------------------
+ * Sets of active cells, so kernels only do work where something happens.
+ *
+ * The set is kept three ways:
+ *      a bitmask over the Mesh     - active(c) in O(1)
+ *      a sorted list of cells      - storage indices, for gathers
+ *      runs of consecutive cells   - [begin, end) ranges for contiguous,
+ *                                    vectorisable inner loops, at most
+ *                                    Parallel::defaultGrain cells long
+ *
+ * narrowBand() selects the cells where |q| exceeds a threshold and grows
+ * the selection by a band of 'width' cells along every dimension (a box
+ * around each cell). updateBand() moves the band with the front while only
+ * looking at the cells in the current band, so its cost is proportional to
+ * the band (plus a pass over the bitmask, one word per 64 cells), not the
+ * Mesh - as long as the front moves less than 'width' cells between
+ * updates. clear() likewise only touches the cells that were active.
+ *
+ * forRuns() shares the runs out over the global thread pool. Works with any
+ * cell ordering; runs are longest with lexicographic storage.
+ * --------------------------------------------------------------------------*/
+
+#ifndef DATASTRUCTURES_ACTIVECELLS_H
+#define DATASTRUCTURES_ACTIVECELLS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "Mesh.h"
+#include "Parallel/ParallelRange.h"
+
+template<size_t meshDim>
+class ActiveCells
+{
+    using MeshPtr = std::shared_ptr<const Mesh<meshDim>>;
+
+public:
+    // [begin, end) storage indices
+    using Run = std::pair<size_t, size_t>;
+
+    // No cells active
+    explicit ActiveCells(const MeshPtr mesh);
+
+    // Selection
+    void clear();
+    void activateAll();
+    // Cells c (storage indices) for which pred(c) holds - scans the Mesh
+    template<typename Pred>
+    void select(Pred pred);
+    // Add cells to the set
+    void activate(const std::vector<size_t>& cells);
+
+    // Cells with |q| > threshold plus a band of width cells - scans the Mesh
+    void narrowBand(const std::vector<double>& q, const double threshold,
+                    const size_t width);
+    // Same, looking only at the cells in the current band
+    void updateBand(const std::vector<double>& q, const double threshold,
+                    const size_t width);
+
+    // Lookups
+    bool active(const size_t c) const {
+        return (bits_[c/64] >> (c%64)) & 1u;
+    }
+    size_t size() const { return cells_.size(); }
+    bool empty() const { return cells_.empty(); }
+    double fraction() const {
+        return mesh_->numCells() ? double(size())/mesh_->numCells() : 0.0;
+    }
+    const std::vector<size_t>& cells() const { return cells_; }
+    const std::vector<Run>& runs() const { return runs_; }
+    const Mesh<meshDim>& mesh() const { return *mesh_; }
+
+    // fn(begin, end) for every run, shared over the global thread pool
+    template<typename Fn>
+    void forRuns(Fn fn) const;
+
+private:
+    // Data members
+    MeshPtr mesh_;
+    std::vector<uint64_t> bits_;
+    std::vector<size_t> cells_;
+    std::vector<Run> runs_;
+    // End data members
+
+    bool mark(const size_t c) {
+        uint64_t& word = bits_[c/64];
+        const uint64_t bit = uint64_t(1) << (c%64);
+        const bool wasSet = word & bit;
+        word |= bit;
+        return !wasSet;
+    }
+    // Unmark the current cells, leaving the set empty
+    void unmarkAll();
+    // The set becomes seeds grown by width cells along each dimension
+    void grow(std::vector<size_t>&& seeds, const size_t width);
+    void finish();
+};
+
+
+template<size_t meshDim>
+template<typename Pred>
+void ActiveCells<meshDim>::select(Pred pred)
+{
+    unmarkAll();
+    for (size_t c=0; c<mesh_->numCells(); c++) {
+        if (pred(c)) {
+            mark(c);
+            cells_.push_back(c);
+        }
+    }
+    finish();
+}
+
+template<size_t meshDim>
+template<typename Fn>
+void ActiveCells<meshDim>::forRuns(Fn fn) const
+{
+    if (runs_.empty()) {
+        return;
+    }
+    // Grain in runs, so that a piece holds about defaultGrain cells
+    const size_t perRun = std::max<size_t>(1, cells_.size()/runs_.size());
+    const size_t grain = std::max<size_t>(1, Parallel::defaultGrain/perRun);
+    Parallel::parallelFor(Parallel::ThreadPool::global(), 0, runs_.size(),
+        [this, &fn](const size_t begin, const size_t end) {
+            for (size_t r=begin; r<end; r++) {
+                fn(runs_[r].first, runs_[r].second);
+            }
+        }, grain);
+}
+
+#endif // DATASTRUCTURES_ACTIVECELLS_H
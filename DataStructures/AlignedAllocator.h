@@ -0,0 +1,41 @@
+/* ---------------------------------------------------------------------------
+ * Allocator returning memory aligned to 'Align' bytes (a cache line by
+ * default), so that arrays can be used with aligned SIMD loads.
+ * --------------------------------------------------------------------------*/
+
+#ifndef DATASTRUCTURES_ALIGNEDALLOCATOR_H
+#define DATASTRUCTURES_ALIGNEDALLOCATOR_H
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+template<typename T, size_t Align = 64>
+struct AlignedAllocator
+{
+    using value_type = T;
+
+    template<typename U>
+    struct rebind { using other = AlignedAllocator<U, Align>; };
+
+    AlignedAllocator() noexcept {}
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, Align>&) noexcept {}
+
+    T* allocate(const size_t n) {
+        return static_cast<T*>(::operator new(n*sizeof(T), std::align_val_t(Align)));
+    }
+    void deallocate(T* p, size_t) noexcept {
+        ::operator delete(p, std::align_val_t(Align));
+    }
+
+    template<typename U>
+    bool operator==(const AlignedAllocator<U, Align>&) const noexcept { return true; }
+    template<typename U>
+    bool operator!=(const AlignedAllocator<U, Align>&) const noexcept { return false; }
+};
+
+template<typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+#endif // DATASTRUCTURES_ALIGNEDALLOCATOR_H
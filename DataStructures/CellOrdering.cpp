@@ -0,0 +1,172 @@
+#include "CellOrdering.h"
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+#include <utility>
+
+namespace SFC {
+
+// Skilling, "Programming the Hilbert curve" (2004): the transpose form of
+// the key holds its bits spread across the coordinates
+template<size_t mD>
+uint64_t hilbertEncode(std::array<size_t, mD> X, const unsigned bits)
+{
+    const size_t M = size_t(1) << (bits-1);
+    // Inverse undo
+    for (size_t Q=M; Q>1; Q>>=1) {
+        const size_t P = Q-1;
+        for (size_t i=0; i<mD; i++) {
+            if (X[i] & Q) {
+                X[0] ^= P;
+            } else {
+                const size_t t = (X[0] ^ X[i]) & P;
+                X[0] ^= t;
+                X[i] ^= t;
+            }
+        }
+    }
+    // Gray encode
+    for (size_t i=1; i<mD; i++) {
+        X[i] ^= X[i-1];
+    }
+    size_t t = 0;
+    for (size_t Q=M; Q>1; Q>>=1) {
+        if (X[mD-1] & Q) {
+            t ^= Q-1;
+        }
+    }
+    for (size_t i=0; i<mD; i++) {
+        X[i] ^= t;
+    }
+    // Interleave the transpose, X[0] most significant
+    uint64_t key = 0;
+    for (unsigned b=bits; b-->0;) {
+        for (size_t i=0; i<mD; i++) {
+            key = (key << 1) | ((X[i] >> b) & 1);
+        }
+    }
+    return key;
+}
+
+template<size_t mD>
+std::array<size_t, mD> hilbertDecode(const uint64_t key, const unsigned bits)
+{
+    std::array<size_t, mD> X{};
+    unsigned pos = bits*mD;
+    for (unsigned b=bits; b-->0;) {
+        for (size_t i=0; i<mD; i++) {
+            X[i] |= ((key >> --pos) & 1) << b;
+        }
+    }
+    const size_t N = size_t(2) << (bits-1);
+    // Gray decode
+    size_t t = X[mD-1] >> 1;
+    for (size_t i=mD-1; i>0; i--) {
+        X[i] ^= X[i-1];
+    }
+    X[0] ^= t;
+    // Undo excess work
+    for (size_t Q=2; Q!=N; Q<<=1) {
+        const size_t P = Q-1;
+        for (size_t i=mD; i-->0;) {
+            if (X[i] & Q) {
+                X[0] ^= P;
+            } else {
+                t = (X[0] ^ X[i]) & P;
+                X[0] ^= t;
+                X[i] ^= t;
+            }
+        }
+    }
+    return X;
+}
+
+template uint64_t hilbertEncode<1>(std::array<size_t, 1>, const unsigned);
+template uint64_t hilbertEncode<2>(std::array<size_t, 2>, const unsigned);
+template uint64_t hilbertEncode<3>(std::array<size_t, 3>, const unsigned);
+template std::array<size_t, 1> hilbertDecode<1>(const uint64_t, const unsigned);
+template std::array<size_t, 2> hilbertDecode<2>(const uint64_t, const unsigned);
+template std::array<size_t, 3> hilbertDecode<3>(const uint64_t, const unsigned);
+
+}
+
+template<size_t mD>
+CellOrder<mD>::CellOrder(const std::vector<size_t>& dims,
+                         const CellOrdering type, const size_t tile):
+    type_(type),
+    tile_(tile)
+{
+    assert(dims.size() == mD);
+    assert(tile_ > 0);
+    size_t n = 1;
+    size_t largest = 1;
+    for (size_t s : dims) {
+        n *= s;
+        largest = std::max(largest, s);
+    }
+    unsigned bits = 1;
+    while ((size_t(1) << bits) < largest) {
+        bits++;
+    }
+    assert(type_ != CellOrdering::Morton || bits*mD <= 64);
+    assert(type_ != CellOrdering::Hilbert || bits*mD <= 64);
+
+    // Sort key of every cell, in lexicographic order
+    std::vector<uint64_t> key(n);
+    Index idx{};
+    for (size_t c=0; c<n; c++) {
+        switch (type_)
+        {
+            case CellOrdering::Lexicographic:
+                key[c] = c;
+                break;
+            case CellOrdering::Tiled:
+            {
+                // Tile number, then position within the tile
+                uint64_t t = 0, inTile = 0;
+                for (size_t d=mD; d-->0;) {
+                    t = t*((dims[d] + tile_ - 1)/tile_) + idx[d]/tile_;
+                    inTile = inTile*tile_ + idx[d]%tile_;
+                }
+                size_t perTile = 1;
+                for (size_t d=0; d<mD; d++) {
+                    perTile *= tile_;
+                }
+                key[c] = t*perTile + inTile;
+            }
+            break;
+            case CellOrdering::Morton:
+                key[c] = SFC::mortonEncode<mD>(idx);
+                break;
+            case CellOrdering::Hilbert:
+                key[c] = SFC::hilbertEncode<mD>(idx, bits);
+                break;
+        }
+        for (size_t d=0; d<mD; d++) {
+            if (++idx[d] < dims[d]) {
+                break;
+            }
+            idx[d] = 0;
+        }
+    }
+
+    // Ranking by key compacts the curve onto the cells that exist
+    storageToLex_.resize(n);
+    std::iota(storageToLex_.begin(), storageToLex_.end(), 0);
+    if (type_ != CellOrdering::Lexicographic) {
+        std::sort(storageToLex_.begin(), storageToLex_.end(),
+                  [&key](const size_t a, const size_t b) {
+                      return key[a] < key[b];
+                  });
+    }
+    lexToStorage_.resize(n);
+    for (size_t s=0; s<n; s++) {
+        lexToStorage_[storageToLex_[s]] = s;
+    }
+}
+
+// Instantiate templates
+template class CellOrder<1>;
+template class CellOrder<2>;
+template class CellOrder<3>;
@@ -0,0 +1,137 @@
+/* ---------------------------------------------------------------------------
+ * Orderings of the cells of a Mesh in Field storage.
+ *
+ * Lexicographic - dimension 0 fastest (the default, and what most kernels
+ *                 assume)
+ * Tiled         - lexicographic blocks of tile^mD cells, themselves in
+ *                 lexicographic order
+ * Morton        - Z-order curve (interleaved index bits)
+ * Hilbert       - Hilbert curve (Skilling's transpose algorithm)
+ *
+ * Meshes need not have power-of-two sizes, so the curve orderings are made
+ * compact: cells are ranked by their curve key, and CellOrder keeps tables
+ * mapping lexicographic index <-> storage index in both directions. Encode,
+ * decode and neighbour lookup are then a table lookup each.
+ * --------------------------------------------------------------------------*/
+
+#ifndef DATASTRUCTURES_CELLORDERING_H
+#define DATASTRUCTURES_CELLORDERING_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class CellOrdering {
+    Lexicographic,
+    Tiled,
+    Morton,
+    Hilbert
+};
+
+namespace SFC
+{
+    // Spread the low bits of x so that there are mD-1 zero bits between
+    // each (mD <= 3, up to 21 bits in 3D and 32 in 2D)
+    template<size_t mD>
+    constexpr uint64_t spreadBits(uint64_t x)
+    {
+        if constexpr (mD == 1) {
+            return x;
+        } else if constexpr (mD == 2) {
+            x &= 0xffffffffull;
+            x = (x | (x << 16)) & 0x0000ffff0000ffffull;
+            x = (x | (x << 8))  & 0x00ff00ff00ff00ffull;
+            x = (x | (x << 4))  & 0x0f0f0f0f0f0f0f0full;
+            x = (x | (x << 2))  & 0x3333333333333333ull;
+            x = (x | (x << 1))  & 0x5555555555555555ull;
+            return x;
+        } else {
+            static_assert(mD == 3, "Morton keys are for up to 3 dimensions");
+            x &= 0x1fffffull;
+            x = (x | (x << 32)) & 0x001f00000000ffffull;
+            x = (x | (x << 16)) & 0x001f0000ff0000ffull;
+            x = (x | (x << 8))  & 0x100f00f00f00f00full;
+            x = (x | (x << 4))  & 0x10c30c30c30c30c3ull;
+            x = (x | (x << 2))  & 0x1249249249249249ull;
+            return x;
+        }
+    }
+
+    // Inverse of spreadBits
+    template<size_t mD>
+    constexpr uint64_t compactBits(uint64_t x)
+    {
+        if constexpr (mD == 1) {
+            return x;
+        } else if constexpr (mD == 2) {
+            x &= 0x5555555555555555ull;
+            x = (x | (x >> 1))  & 0x3333333333333333ull;
+            x = (x | (x >> 2))  & 0x0f0f0f0f0f0f0f0full;
+            x = (x | (x >> 4))  & 0x00ff00ff00ff00ffull;
+            x = (x | (x >> 8))  & 0x0000ffff0000ffffull;
+            x = (x | (x >> 16)) & 0x00000000ffffffffull;
+            return x;
+        } else {
+            static_assert(mD == 3, "Morton keys are for up to 3 dimensions");
+            x &= 0x1249249249249249ull;
+            x = (x | (x >> 2))  & 0x10c30c30c30c30c3ull;
+            x = (x | (x >> 4))  & 0x100f00f00f00f00full;
+            x = (x | (x >> 8))  & 0x001f0000ff0000ffull;
+            x = (x | (x >> 16)) & 0x001f00000000ffffull;
+            x = (x | (x >> 32)) & 0x00000000001fffffull;
+            return x;
+        }
+    }
+
+    template<size_t mD>
+    constexpr uint64_t mortonEncode(const std::array<size_t, mD>& idx)
+    {
+        uint64_t key = 0;
+        for (size_t d=0; d<mD; d++) {
+            key |= spreadBits<mD>(idx[d]) << d;
+        }
+        return key;
+    }
+
+    template<size_t mD>
+    constexpr std::array<size_t, mD> mortonDecode(const uint64_t key)
+    {
+        std::array<size_t, mD> idx{};
+        for (size_t d=0; d<mD; d++) {
+            idx[d] = compactBits<mD>(key >> d);
+        }
+        return idx;
+    }
+
+    // Hilbert key of idx on a 2^bits per side grid
+    template<size_t mD>
+    uint64_t hilbertEncode(std::array<size_t, mD> idx, const unsigned bits);
+    template<size_t mD>
+    std::array<size_t, mD> hilbertDecode(const uint64_t key, const unsigned bits);
+}
+
+template<size_t mD>
+class CellOrder
+{
+public:
+    using Index = std::array<size_t, mD>;
+
+    // tile is the Tiled block size (ignored by the other orderings)
+    CellOrder(const std::vector<size_t>& dims, const CellOrdering type,
+              const size_t tile = 8);
+
+    CellOrdering type() const { return type_; }
+    size_t tile() const { return tile_; }
+
+    size_t toStorage(const size_t lex) const { return lexToStorage_[lex]; }
+    size_t toLexicographic(const size_t s) const { return storageToLex_[s]; }
+
+private:
+    CellOrdering type_;
+    size_t tile_;
+    std::vector<size_t> lexToStorage_;
+    std::vector<size_t> storageToLex_;
+};
+
+#endif // DATASTRUCTURES_CELLORDERING_H
@@ -0,0 +1,201 @@
+/* ---------------------------------------------------------------------------
+ * Ensemble of Fields: many realisations of the same quantity on one Mesh.
+ *
+ * Members are interleaved per cell, component d holding
+ *      values[cell*numMembers + member]
+ * so a kernel reading a cell's neighbours (or its metrics, or its stencil
+ * weights) does so once for every member, and the innermost loop runs over
+ * the members - contiguous, and long enough to fill the SIMD lanes even on
+ * small Meshes. To a stencil the members are just one more, fastest,
+ * dimension that is never differentiated along.
+ *
+ * The kernels with an all-members path are the compound operators here
+ * and the stencil gradient, divergence and laplacian (Stencil.tpp). The
+ * other FieldOps kernels - reconstruction and advection, interpolation,
+ * probes, fused sweeps, temporal blocking - and the solvers take ordinary
+ * Fields only: run them member by member through member() and
+ * setMember(), which copy, with none of the shared loads above.
+ *
+ * member() and setMember() convert to and from ordinary Fields. Storage is
+ * plain (not copy-on-write); cell centred only.
+ * --------------------------------------------------------------------------*/
+
+#ifndef DATASTRUCTURES_ENSEMBLEFIELD_TPP
+#define DATASTRUCTURES_ENSEMBLEFIELD_TPP
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Field.tpp"
+
+template<typename T, size_t fD, size_t mD>
+class EnsembleField
+{
+    using MeshPtr = std::shared_ptr<const Mesh<mD>>;
+    using MemberField = Field<T, fD, mD>;
+
+public:
+    EnsembleField(const MeshPtr mesh, const std::string& name,
+                  const size_t numMembers):
+        mesh_(mesh),
+        name_(name),
+        numMembers_(numMembers)
+    {
+        assert(numMembers_ > 0);
+        for (std::vector<T>& v : values_) {
+            v.resize(mesh_->numCells()*numMembers_);
+        }
+    }
+
+    // Every member a copy of f
+    EnsembleField(const MemberField& f, const size_t numMembers):
+        EnsembleField(f.meshPtr(), f.name(), numMembers)
+    {
+        for (size_t m=0; m<numMembers_; m++) {
+            setMember(m, f);
+        }
+    }
+
+    // Lookups
+    size_t numMembers() const { return numMembers_; }
+    size_t numCells() const { return mesh_->numCells(); }
+    const Mesh<mD>& mesh() const { return *mesh_; }
+    MeshPtr meshPtr() const { return mesh_; }
+    const std::string& name() const { return name_; }
+
+    // Interleaved storage of component d
+    const std::vector<T>& component(const size_t d) const {
+        assert(d < fD);
+        return values_[d];
+    }
+    std::vector<T>& component(const size_t d) {
+        assert(d < fD);
+        return values_[d];
+    }
+    const T& operator()(const size_t d, const size_t cell,
+                        const size_t member) const {
+        return values_[d][cell*numMembers_ + member];
+    }
+    T& operator()(const size_t d, const size_t cell, const size_t member) {
+        return values_[d][cell*numMembers_ + member];
+    }
+
+    // Conversion to and from single realisations
+    MemberField member(const size_t m) const {
+        assert(m < numMembers_);
+        MemberField f(mesh_, name_);
+        for (size_t d=0; d<fD; d++) {
+            std::vector<T>& out = f.component(d);
+            const T* in = values_[d].data() + m;
+            for (size_t c=0; c<out.size(); c++) {
+                out[c] = in[c*numMembers_];
+            }
+        }
+        return f;
+    }
+    void setMember(const size_t m, const MemberField& f) {
+        assert(m < numMembers_);
+        assert(f.mesh() == *mesh_);
+        for (size_t d=0; d<fD; d++) {
+            const std::vector<T>& in = f.component(d);
+            T* out = values_[d].data() + m;
+            for (size_t c=0; c<in.size(); c++) {
+                out[c*numMembers_] = in[c];
+            }
+        }
+    }
+
+    // Compound mathematical operators, every member at once
+    EnsembleField<T,fD,mD>& operator*=(const T& rhs) {
+        for (size_t d=0; d<fD; d++) {
+            combine(d, [rhs](const T v) { return v * rhs; });
+        }
+        return *this;
+    }
+    EnsembleField<T,fD,mD>& operator+=(const EnsembleField<T,fD,mD>& rhs) {
+        checkCompatible(rhs);
+        for (size_t d=0; d<fD; d++) {
+            combine(d, [](const T v, const T a) { return v + a; },
+                    rhs.component(d).data());
+        }
+        return *this;
+    }
+    EnsembleField<T,fD,mD>& operator-=(const EnsembleField<T,fD,mD>& rhs) {
+        checkCompatible(rhs);
+        for (size_t d=0; d<fD; d++) {
+            combine(d, [](const T v, const T a) { return v - a; },
+                    rhs.component(d).data());
+        }
+        return *this;
+    }
+    // this += a*x
+    EnsembleField<T,fD,mD>& axpy(const T& a, const EnsembleField<T,fD,mD>& x) {
+        checkCompatible(x);
+        for (size_t d=0; d<fD; d++) {
+            combine(d, [a](const T v, const T xv) { return v + a*xv; },
+                    x.component(d).data());
+        }
+        return *this;
+    }
+
+    void setFixed(const T& val) {
+        for (std::vector<T>& v : values_) {
+            std::fill(v.begin(), v.end(), val);
+        }
+    }
+
+    // Mean over the members, per cell
+    Field<T, fD, mD> mean() const {
+        Field<T, fD, mD> f(mesh_, name_);
+        for (size_t d=0; d<fD; d++) {
+            std::vector<T>& out = f.component(d);
+            const T* in = values_[d].data();
+            for (size_t c=0; c<out.size(); c++, in+=numMembers_) {
+                T sum = T();
+                for (size_t m=0; m<numMembers_; m++) {
+                    sum += in[m];
+                }
+                out[c] = sum / T(numMembers_);
+            }
+        }
+        return f;
+    }
+
+private:
+    // Data members
+    MeshPtr mesh_;
+    std::string name_;
+    size_t numMembers_;
+    std::array<std::vector<T>, fD> values_;
+    // End data members
+
+    void checkCompatible(const EnsembleField<T,fD,mD>& rhs) const {
+        assert(rhs.mesh() == *mesh_ && rhs.numMembers() == numMembers_);
+        (void)rhs;
+    }
+
+    // Component d becomes op(value, src[i]...) elementwise, large components
+    // shared over the global thread pool
+    template<typename Op, typename... Src>
+    void combine(const size_t d, Op op, const Src*... src) {
+        T* out = values_[d].data();
+        const size_t n = values_[d].size();
+        auto kernel = [=](const size_t begin, const size_t end) {
+            for (size_t i=begin; i<end; i++) {
+                out[i] = op(out[i], src[i]...);
+            }
+        };
+        if (n <= Parallel::defaultGrain) {
+            kernel(0, n);
+        } else {
+            Parallel::parallelFor(Parallel::ThreadPool::global(), 0, n, kernel);
+        }
+    }
+};
+
+#endif // DATASTRUCTURES_ENSEMBLEFIELD_TPP
@@ -4,7 +4,23 @@
  * Templated by data type T (eg double)
  *              the size_t fD (field dimension, expected to be 1 or mD)
  *              and size_t mD (mesh dimension)
+ *              and FieldLocation loc (cell centres unless specified)
  *
+ * Component d holds locationSize(mesh, loc, d) values - numCells() for
+ * cell centred Fields.
+ *
+ * Storage is copy-on-write, per component: copying a Field (including
+ * passing it by value) shares the buffers, and the first non-const access
+ * to a shared component copies it. Const access never copies. References
+ * obtained from a non-const accessor write to whichever buffer was current
+ * at the time, so take them after copying the Field, not before.
+ * Moves are noexcept and never allocate, so containers of Fields move their
+ * elements when they grow.
+ *
+ * Every buffer a Field allocates gets Parallel::Memory::defaultPolicy()
+ * (huge pages, NUMA placement - see Parallel/MemoryPolicy.h);
+ * setMemoryPolicy() changes the placement of this Field's buffers only,
+ * and placement() reports where a component's pages are.
  *
  * --------------------------------------------------------------------------*/
 
@@ -15,45 +31,67 @@
 #include <vector>
 #include <array>
 #include "Mesh.h"
+#include "ActiveCells.h"
+#include "FieldLocation.h"
+#include "Parallel/ParallelRange.h"
+#include "Parallel/MemoryPolicy.h"
 #include <utility>
 #include <memory>
 
 #include <iostream>
 
-template <typename T, size_t fD, size_t mD>
+template <typename T, size_t fD, size_t mD,
+          FieldLocation loc = FieldLocation::Cell>
 class Field
 {
     using vectorField = Field<T,mD,mD>;
     using scalarField = Field<T,1,mD>;
     using MeshPtr = std::shared_ptr<const Mesh<mD>>;
 
+    static_assert(loc != FieldLocation::Staggered || fD == mD,
+                  "Staggered storage needs one component per dimension");
+    static_assert(mD >= locationMinDim(loc),
+                  "Face location is not a dimension of this mesh");
+
 public:
+    static constexpr FieldLocation location = loc;
+
     // Empty value constructor
     Field(const MeshPtr mesh, const std::string& name):
         Field(mesh, name, std::make_index_sequence<fD>{})
     {}
 
 // ------ Copy, move, destructor calls need declaring and defining ---------
-    Field(const Field<T, fD, mD> &rhs, const std::string& name = std::string()):
+    Field(const Field<T,fD,mD,loc> &rhs, const std::string& name = std::string()):
         mesh_(rhs.meshPtr()),
         numCells_(rhs.numCells()),
         xCells_(rhs.xCells_), yCells_(rhs.yCells_), zCells_(rhs.zCells_),
         name_(name.empty() ? rhs.name() : name),
-        valueArray_(rhs.data())
+        valueArray_(rhs.valueArray_)
     {}
 
-    Field(Field<T, fD, mD> &&rhs): Field<T,fD,mD>() {
-        swap(*this, rhs);
+    // Steals the mesh, name and buffers without allocating. The moved-from
+    // Field has no mesh or storage, and can only be assigned to or destroyed.
+    Field(Field<T,fD,mD,loc> &&rhs) noexcept:
+        mesh_(std::move(rhs.mesh_)),
+        numCells_(rhs.numCells_),
+        xCells_(rhs.xCells_), yCells_(rhs.yCells_), zCells_(rhs.zCells_),
+        name_(std::move(rhs.name_)),
+        valueArray_(std::move(rhs.valueArray_))
+    {
+        rhs.numCells_ = rhs.xCells_ = rhs.yCells_ = rhs.zCells_ = 0;
     }
 
     ~Field() = default;
 
-    Field<T,fD,mD>& operator=(Field<T,fD,mD> rhs) {
+    // Copy and move assignment - any copy is made building rhs
+    Field<T,fD,mD,loc>& operator=(Field<T,fD,mD,loc> rhs) noexcept {
         swap(*this, rhs);
         return *this;
     }
 
-    friend void swap(Field<T,fD,mD>& first, Field<T,fD,mD>& second) {
+    friend void swap(Field<T,fD,mD,loc>& first,
+                     Field<T,fD,mD,loc>& second) noexcept {
         using std::swap;
         swap(first.mesh_, second.mesh_);
 //        swap(const_cast<size_t>(first.numCells_),
@@ -68,88 +106,262 @@ public:
 // -------------- Copy, move, assignment and destructor calls --------------
 
 
-    // Compound mathematical operators
-    const Field<T,fD,mD> operator+=(const T& rhs) {
-        for (std::vector<T>& vec : valueArray_) {
-            for (T& v : vec) {
-                v += rhs;
-            }
+    // Compound mathematical operators. None of these allocate storage
+    // unless a component is shared, in which case it is replaced by a new
+    // buffer holding the result (rather than copied and then updated).
+    // Components bigger than Parallel::defaultGrain run on the global pool.
+    Field<T,fD,mD,loc>& operator+=(const T& rhs) {
+        for (size_t d=0; d<fD; d++) {
+            combine(d, [rhs](const T v) { return v + rhs; });
         }
         return *this;
     }
-    const Field<T,fD,mD> operator-=(const T& rhs) {
+    Field<T,fD,mD,loc>& operator-=(const T& rhs) {
         return this->operator+=(-rhs);
     }
-    const Field<T,fD,mD> operator*=(const T& rhs) {
-        for (std::vector<T>& vec : valueArray_) {
-            for (T& v : vec) {
-                v *= rhs;
-            }
+    Field<T,fD,mD,loc>& operator*=(const T& rhs) {
+        for (size_t d=0; d<fD; d++) {
+            combine(d, [rhs](const T v) { return v * rhs; });
+        }
+        return *this;
+    }
+    Field<T,fD,mD,loc>& operator/=(const T& rhs) {
+        for (size_t d=0; d<fD; d++) {
+            combine(d, [rhs](const T v) { return v / rhs; });
+        }
+        return *this;
+    }
+
+    // Elementwise, component by component, with a Field on the same Mesh
+    Field<T,fD,mD,loc>& operator+=(const Field<T,fD,mD,loc>& rhs) {
+        checkCompatible(rhs.mesh());
+        for (size_t d=0; d<fD; d++) {
+            combine(d, [](const T v, const T a) { return v + a; },
+                    rhs.component(d).data());
+        }
+        return *this;
+    }
+    Field<T,fD,mD,loc>& operator-=(const Field<T,fD,mD,loc>& rhs) {
+        checkCompatible(rhs.mesh());
+        for (size_t d=0; d<fD; d++) {
+            combine(d, [](const T v, const T a) { return v - a; },
+                    rhs.component(d).data());
+        }
+        return *this;
+    }
+    Field<T,fD,mD,loc>& operator*=(const Field<T,fD,mD,loc>& rhs) {
+        checkCompatible(rhs.mesh());
+        for (size_t d=0; d<fD; d++) {
+            combine(d, [](const T v, const T a) { return v * a; },
+                    rhs.component(d).data());
+        }
+        return *this;
+    }
+    Field<T,fD,mD,loc>& operator/=(const Field<T,fD,mD,loc>& rhs) {
+        checkCompatible(rhs.mesh());
+        for (size_t d=0; d<fD; d++) {
+            combine(d, [](const T v, const T a) { return v / a; },
+                    rhs.component(d).data());
+        }
+        return *this;
+    }
+
+    // Every component scaled by a scalar Field at the same location
+    template<size_t fd=fD, EnableIf<(fd>1)>...>
+    Field<T,fD,mD,loc>& operator*=(const Field<T,1,mD,loc>& rhs) {
+        checkCompatible(rhs.mesh());
+        for (size_t d=0; d<fD; d++) {
+            combine(d, [](const T v, const T a) { return v * a; },
+                    rhs.x().data());
+        }
+        return *this;
+    }
+    template<size_t fd=fD, EnableIf<(fd>1)>...>
+    Field<T,fD,mD,loc>& operator/=(const Field<T,1,mD,loc>& rhs) {
+        checkCompatible(rhs.mesh());
+        for (size_t d=0; d<fD; d++) {
+            combine(d, [](const T v, const T a) { return v / a; },
+                    rhs.x().data());
         }
         return *this;
     }
 
+    // this += a*x, in one pass
+    Field<T,fD,mD,loc>& axpy(const T& a, const Field<T,fD,mD,loc>& x) {
+        checkCompatible(x.mesh());
+        for (size_t d=0; d<fD; d++) {
+            combine(d, [a](const T v, const T xv) { return v + a*xv; },
+                    x.component(d).data());
+        }
+        return *this;
+    }
+    // this += x*y elementwise, in one pass
+    Field<T,fD,mD,loc>& fma(const Field<T,fD,mD,loc>& x,
+                            const Field<T,fD,mD,loc>& y) {
+        checkCompatible(x.mesh());
+        checkCompatible(y.mesh());
+        for (size_t d=0; d<fD; d++) {
+            combine(d, [](const T v, const T xv, const T yv) {
+                        return v + xv*yv;
+                    },
+                    x.component(d).data(), y.component(d).data());
+        }
+        return *this;
+    }
+
+    // this += a*x on the active cells only; the rest keep their values
+    Field<T,fD,mD,loc>& axpy(const T& a, const Field<T,fD,mD,loc>& x,
+                             const ActiveCells<mD>& active) {
+        checkCompatible(x.mesh());
+        for (size_t d=0; d<fD; d++) {
+            combineActive(d, active,
+                          [a](const T v, const T xv) { return v + a*xv; },
+                          x.component(d).data());
+        }
+        return *this;
+    }
 
     // Set values unilaterally.
     void setZero() { setFixed(T()); }
     void setFixed(const T &val) {
-        for (size_t d = 0; d<mD; d++) {
-            std::fill(valueArray_[d].begin(), valueArray_[d].end(), val);
+        for (size_t d = 0; d<fD; d++) {
+            std::vector<T>& v = component(d);
+            std::fill(v.begin(), v.end(), val);
+        }
+    }
+    void setFixed(const T &val, const ActiveCells<mD>& active) {
+        for (size_t d = 0; d<fD; d++) {
+            combineActive(d, active, [val](const T) { return val; });
         }
     }
 
     // Test equality
-    bool operator==(const Field<T,fD,mD>& rhs) {
+    bool operator==(const Field<T,fD,mD,loc>& rhs) {
         if (*mesh_ != rhs.mesh()) {
             return false;
         }
         for (size_t d=0; d<fD; d++) {
-            if (valueArray_[d] != rhs.data()[d]) {
+            if (*valueArray_[d] != rhs.component(d)) {
                 return false;
             }
         }
         return true;
     }
-    bool equal_Val_Name(const Field<T,fD,mD>& rhs) {
+    bool equal_Val_Name(const Field<T,fD,mD,loc>& rhs) {
         if (name_ != rhs.name_) {
             return false;
         }
         return operator==(rhs);
     }
-    bool operator!=(const Field<T,fD,mD>& rhs) {
+    bool operator!=(const Field<T,fD,mD,loc>& rhs) {
         return ! operator==(rhs);
     }
-    bool strictlyEqual(const Field<T,fD,mD>& rhs) {
+    bool strictlyEqual(const Field<T,fD,mD,loc>& rhs) {
         return (this==(&rhs));
     }
 
     // Value lookup (every cell, one component)
-    const std::vector<T>& x() const { return valueArray_[0]; }
+    const std::vector<T>& x() const { return *valueArray_[0]; }
     template<size_t md=mD, EnableIf<md>=2>...>
-    const std::vector<T> &y() const { return valueArray_[1]; }
+    const std::vector<T> &y() const { return *valueArray_[1]; }
     template<size_t md=mD, EnableIf<md>=3>...>
-    const std::vector<T> &z() const { return valueArray_[2]; }
-    // Non-const
-    std::vector<T> &x() { return valueArray_[0]; }
+    const std::vector<T> &z() const { return *valueArray_[2]; }
+    // Non-const - detaches the component if it is shared
+    std::vector<T> &x() { return writable(0); }
     template<size_t md=mD, EnableIf<md>=2>...>
-    std::vector<T> &y() { return valueArray_[1]; }
+    std::vector<T> &y() { return writable(1); }
     template<size_t md=mD, EnableIf<md>=3>...>
-    std::vector<T> &z() { return valueArray_[2]; }
+    std::vector<T> &z() { return writable(2); }
+    // Lookup by component index (0 <= d < fD)
+    const std::vector<T> &component(const size_t d) const {
+        assert(d < fD);
+        return *valueArray_[d];
+    }
+    std::vector<T> &component(const size_t d) {
+        assert(d < fD);
+        return writable(d);
+    }
+
+    // Copy-on-write control
+    // Give every component a buffer of its own
+    void detach() {
+        for (size_t d=0; d<fD; d++) {
+            writable(d);
+        }
+    }
+    // Whether any component shares its buffer with another Field
+    bool isShared() const {
+        for (size_t d=0; d<fD; d++) {
+            if (valueArray_[d].use_count() > 1) {
+                return true;
+            }
+        }
+        return false;
+    }
+    bool sharesStorageWith(const Field<T,fD,mD,loc>& rhs, const size_t d) const {
+        return valueArray_[d] == rhs.valueArray_[d];
+    }
+
+    // Page placement. Shared buffers are detached first, so the policy
+    // never moves another Field's storage; buffers allocated later (eg
+    // detaching again) get the default policy.
+    // Returns false if the kernel refused any part of the request.
+    bool setMemoryPolicy(const Parallel::MemoryPolicy& policy) {
+        bool ok = true;
+        for (size_t d=0; d<fD; d++) {
+            std::vector<T>& v = writable(d);
+            ok = Parallel::Memory::place(v.data(), v.size()*sizeof(T),
+                                         policy) && ok;
+        }
+        return ok;
+    }
+    Parallel::MemoryReport placement(const size_t d) const {
+        const std::vector<T>& v = component(d);
+        return Parallel::Memory::report(v.data(), v.size()*sizeof(T));
+    }
+
+    // Component d in lexicographic cell order (eg for I/O), whatever the
+    // storage order of the Mesh
+    std::vector<T> lexicographic(const size_t d) const {
+        const std::vector<T>& v = component(d);
+        std::vector<T> out(v.size());
+        for (size_t i=0; i<v.size(); i++) {
+            out[i] = v[mesh_->storageIndex(i)];
+        }
+        return out;
+    }
+    void setLexicographic(const size_t d, const std::vector<T>& values) {
+        std::vector<T>& v = component(d);
+        assert(values.size() == v.size());
+        for (size_t i=0; i<v.size(); i++) {
+            v[mesh_->storageIndex(i)] = values[i];
+        }
+    }
 
     // Individual lookups (probably slow, mark deprecated?)
     // Should these check the type of Idxs?
     template<typename... Idxs, EnableIf<sizeof...(Idxs)==mD>...>
     [[deprecated]] const T x(const Idxs... idxs) const {
-        return valueArray_[0][getSingleIdx(idxs...)];
+        return x()[getSingleIdx(idxs...)];
     }
 
     // Other lookups
     size_t numCells() const { return numCells_; }
+    // Extent of component d's storage along each mesh dimension
+    std::array<size_t, mD> dims(const size_t d) const {
+        return locationDims(*mesh_, loc, d);
+    }
     const Mesh<mD> &mesh() const { return *mesh_; }
     MeshPtr meshPtr() const { return mesh_; }
     const std::string &name() const { return name_; }
-    std::array<std::vector<T>, fD> data() { return valueArray_; }
-    const std::array<std::vector<T>, fD> data() const { return valueArray_; }
+    // Copy of every component (prefer component(d))
+    std::array<std::vector<T>, fD> data() const {
+        std::array<std::vector<T>, fD> out;
+        for (size_t d=0; d<fD; d++) {
+            out[d] = *valueArray_[d];
+        }
+        return out;
+    }
 
 private:
     // Data members
@@ -157,15 +369,89 @@ private:
     /*const*/ size_t numCells_;
     size_t xCells_, yCells_, zCells_;
     std::string name_;
-    std::array<std::vector<T>, fD> valueArray_;
+    std::array<std::shared_ptr<std::vector<T>>, fD> valueArray_;
     // End data members
 
+    std::vector<T>& writable(const size_t d) {
+        std::shared_ptr<std::vector<T>>& p = valueArray_[d];
+        if (p.use_count() > 1) {
+            p = std::make_shared<std::vector<T>>(*p);
+            placeNew(*p);
+        }
+        return *p;
+    }
+
+    // Apply the default memory policy to a buffer just allocated
+    static void placeNew(std::vector<T>& v) {
+        const Parallel::MemoryPolicy& policy =
+            Parallel::Memory::defaultPolicy();
+        if (!policy.isDefault()) {
+            Parallel::Memory::place(v.data(), v.size()*sizeof(T), policy);
+        }
+    }
+
+    // Arithmetic needs both operands on the same Mesh. Only the Meshes are
+    // compared, once per operation - the sizes follow from the location.
+    void checkCompatible(const Mesh<mD>& rhsMesh) const {
+        assert(*mesh_ == rhsMesh);
+        (void)rhsMesh;
+    }
+
+    // Component d becomes op(value, src[i]...) elementwise. Sources are read
+    // before the result is written, so they may alias this Field. Large
+    // components are split across the global thread pool.
+    template<typename Op, typename... Src>
+    void combine(const size_t d, Op op, const Src*... src) {
+        std::shared_ptr<std::vector<T>>& p = valueArray_[d];
+        const size_t n = p->size();
+        const T* in = p->data();
+        T* out = nullptr;
+        std::shared_ptr<std::vector<T>> fresh;
+        if (p.use_count() > 1) {
+            fresh = std::make_shared<std::vector<T>>(n);
+            placeNew(*fresh);
+            out = fresh->data();
+        } else {
+            out = p->data();
+        }
+        auto kernel = [=](const size_t begin, const size_t end) {
+            for (size_t i=begin; i<end; i++) {
+                out[i] = op(in[i], src[i]...);
+            }
+        };
+        if (n <= Parallel::defaultGrain) {
+            kernel(0, n);
+        } else {
+            Parallel::parallelFor(Parallel::ThreadPool::global(), 0, n, kernel);
+        }
+        if (fresh) {
+            p = std::move(fresh);
+        }
+    }
+
+    // As combine, over the active cells only. The other cells are kept, so
+    // a shared component is copied first.
+    template<typename Op, typename... Src>
+    void combineActive(const size_t d, const ActiveCells<mD>& active, Op op,
+                       const Src*... src) {
+        static_assert(loc == FieldLocation::Cell,
+                      "Active cells are cell centred");
+        checkCompatible(active.mesh());
+        T* out = writable(d).data();
+        active.forRuns([=](const size_t begin, const size_t end) {
+            for (size_t i=begin; i<end; i++) {
+                out[i] = op(out[i], src[i]...);
+            }
+        });
+    }
+
     template<typename... Idxs, EnableIf<sizeof...(Idxs)==mD>...>
     [[deprecated]] size_t getSingleIdx(const Idxs... idxs) const {
         std::vector<size_t> idx { idxs... };
         // For <=3D meshes, will never cut out an index - just pad with 0s.
         idx.resize(3);
-        return idx[0] + (idx[1]*xCells_) + (idx[2]*xCells_*yCells_);
+        return mesh_->storageIndex(idx[0] + (idx[1]*xCells_)
+                                   + (idx[2]*xCells_*yCells_));
     }
 
 
@@ -179,69 +465,142 @@ private:
         yCells_(mesh->yCells()),
         zCells_(mesh->zCells()),
         name_(name),
-        valueArray_{ { std::vector<T>(((void)Is, numCells_))... } }
-    {}
-
-    // Default constructor with appropriate number of empty vector<T>s
-    Field():
-        Field(std::make_index_sequence<fD>{})
-    {}
-
-    // Delegated empty constructor
-    template<size_t... Is>
-    Field(std::index_sequence<Is...>):
-        mesh_(nullptr),
-        numCells_(),
-        xCells_(),
-        yCells_(),
-        zCells_(),
-        name_(""),
-        valueArray_{{ std::vector<T>(((void)Is, 0))... }}
-    {}
+        valueArray_{ { std::make_shared<std::vector<T>>(
+                          locationSize(*mesh, loc, Is))... } }
+    {
+        // Face and node storage is always lexicographic
+        assert(loc == FieldLocation::Cell
+            || mesh->ordering() == CellOrdering::Lexicographic);
+        for (std::shared_ptr<std::vector<T>>& p : valueArray_) {
+            placeNew(*p);
+        }
+    }
 // --------------- End delegated constructors ------------------------------ //
 };
 
-// Mathematical operators that don't change the Field
-template<typename T, size_t fD, size_t mD>
-const Field<T,fD,mD> operator+(Field<T,fD,mD> lhs,
-                               const typename std::common_type<T>::type &rhs)
+// Mathematical operators that don't change the Field. Each result needs
+// new storage; pass an rvalue as the Field argument (eg a + b + c) to reuse
+// its buffers, or use the compound operators, axpy and fma to avoid
+// allocating at all.
+template<typename T, size_t fD, size_t mD, FieldLocation loc>
+Field<T,fD,mD,loc> operator+(Field<T,fD,mD,loc> lhs,
+                             const typename std::common_type<T>::type &rhs)
+{
+    lhs += rhs;
+    return lhs;
+}
+
+template<typename T, size_t fD, size_t mD, FieldLocation loc>
+Field<T,fD,mD,loc> operator+(const typename std::common_type<T>::type &lhs,
+                             Field<T,fD,mD,loc> rhs)
+{
+    rhs += lhs;
+    return rhs;
+}
+
+template<typename T, size_t fD, size_t mD, FieldLocation loc>
+Field<T,fD,mD,loc> operator-(Field<T,fD,mD,loc> lhs,
+                             const typename std::common_type<T>::type &rhs)
+{
+    lhs -= rhs;
+    return lhs;
+}
+
+template<typename T, size_t fD, size_t mD, FieldLocation loc>
+Field<T,fD,mD,loc> operator-(const typename std::common_type<T>::type &lhs,
+                             Field<T,fD,mD,loc> rhs)
+{
+    for (size_t d=0; d<fD; d++) {
+        for (T& v : rhs.component(d)) {
+            v = lhs - v;
+        }
+    }
+    return rhs;
+}
+
+template<typename T, size_t fD, size_t mD, FieldLocation loc>
+Field<T,fD,mD,loc> operator*(Field<T,fD,mD,loc> lhs,
+                             const typename std::common_type<T>::type &rhs)
+{
+    lhs *= rhs;
+    return lhs;
+}
+
+template<typename T, size_t fD, size_t mD, FieldLocation loc>
+Field<T,fD,mD,loc> operator*(const typename std::common_type<T>::type &lhs,
+                             Field<T,fD,mD,loc> rhs)
+{
+    rhs *= lhs;
+    return rhs;
+}
+
+template<typename T, size_t fD, size_t mD, FieldLocation loc>
+Field<T,fD,mD,loc> operator/(Field<T,fD,mD,loc> lhs,
+                             const typename std::common_type<T>::type &rhs)
+{
+    lhs /= rhs;
+    return lhs;
+}
+
+// Elementwise operators between Fields on the same Mesh
+template<typename T, size_t fD, size_t mD, FieldLocation loc>
+Field<T,fD,mD,loc> operator+(Field<T,fD,mD,loc> lhs,
+                             const Field<T,fD,mD,loc>& rhs)
+{
+    lhs += rhs;
+    return lhs;
+}
+
+template<typename T, size_t fD, size_t mD, FieldLocation loc>
+Field<T,fD,mD,loc> operator-(Field<T,fD,mD,loc> lhs,
+                             const Field<T,fD,mD,loc>& rhs)
 {
-    return lhs += rhs;
+    lhs -= rhs;
+    return lhs;
 }
 
-template<typename T, size_t fD, size_t mD>
-const Field<T,fD,mD> operator+(const typename std::common_type<T>::type &lhs,
-                               Field<T,fD,mD> rhs)
+template<typename T, size_t fD, size_t mD, FieldLocation loc>
+Field<T,fD,mD,loc> operator*(Field<T,fD,mD,loc> lhs,
+                             const Field<T,fD,mD,loc>& rhs)
 {
-    return rhs += lhs;
+    lhs *= rhs;
+    return lhs;
 }
 
-template<typename T, size_t fD, size_t mD>
-const Field<T,fD,mD> operator-(Field<T,fD,mD> lhs,
-                               const typename std::common_type<T>::type &rhs)
+template<typename T, size_t fD, size_t mD, FieldLocation loc>
+Field<T,fD,mD,loc> operator/(Field<T,fD,mD,loc> lhs,
+                             const Field<T,fD,mD,loc>& rhs)
 {
-    return lhs -= rhs;
+    lhs /= rhs;
+    return lhs;
 }
 
-template<typename T, size_t fD, size_t mD>
-const Field<T,fD,mD> operator-(const typename std::common_type<T>::type &lhs,
-                               Field<T,fD,mD> rhs)
+// Vector Field scaled by a scalar Field
+template<typename T, size_t fD, size_t mD, FieldLocation loc,
+         EnableIf<(fD>1)>...>
+Field<T,fD,mD,loc> operator*(Field<T,fD,mD,loc> lhs,
+                             const Field<T,1,mD,loc>& rhs)
 {
-    return (-1 * rhs) += lhs;
+    lhs *= rhs;
+    return lhs;
 }
 
-template<typename T, size_t fD, size_t mD>
-const Field<T,fD,mD> operator*(Field<T,fD,mD> lhs,
-                               const typename std::common_type<T>::type &rhs)
+template<typename T, size_t fD, size_t mD, FieldLocation loc,
+         EnableIf<(fD>1)>...>
+Field<T,fD,mD,loc> operator*(const Field<T,1,mD,loc>& lhs,
+                             Field<T,fD,mD,loc> rhs)
 {
-    return lhs *= rhs;
+    rhs *= lhs;
+    return rhs;
 }
 
-template<typename T, size_t fD, size_t mD>
-const Field<T,fD,mD> operator*(const typename std::common_type<T>::type &lhs,
-                               Field<T,fD,mD> rhs)
+template<typename T, size_t fD, size_t mD, FieldLocation loc,
+         EnableIf<(fD>1)>...>
+Field<T,fD,mD,loc> operator/(Field<T,fD,mD,loc> lhs,
+                             const Field<T,1,mD,loc>& rhs)
 {
-    return rhs *= lhs;
+    lhs /= rhs;
+    return lhs;
 }
 
 #endif // DATASTRUCTURES_FIELD_TPP
@@ -0,0 +1,85 @@
+/* ---------------------------------------------------------------------------
+ * Where on the Mesh the values of a Field live.
+ *
+ * Cell      - cell centres, dimSize[d] values along every dimension
+ * FaceX/Y/Z - faces normal to one dimension (dimSize+1 values along it),
+ *             the same for every component
+ * Staggered - MAC arrangement: component d on the faces normal to dimension
+ *             d. Only meaningful for vector fields (fD == mD).
+ * Node      - cell vertices, dimSize[d]+1 values along every dimension
+ *
+ * Storage is lexicographic as for cell fields (dimension 0 fastest) using
+ * the per-component sizes given by locationDims().
+ * --------------------------------------------------------------------------*/
+
+#ifndef DATASTRUCTURES_FIELDLOCATION_H
+#define DATASTRUCTURES_FIELDLOCATION_H
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "Mesh.h"
+
+enum class FieldLocation {
+    Cell,
+    FaceX,
+    FaceY,
+    FaceZ,
+    Staggered,
+    Node
+};
+
+// Whether component 'comp' at 'loc' sits on the edges (rather than the
+// centres) along dimension d
+constexpr bool onEdgesAlong(const FieldLocation loc, const size_t comp,
+                            const size_t d)
+{
+    return (loc == FieldLocation::Node)
+        || (loc == FieldLocation::Staggered && comp == d)
+        || (loc == FieldLocation::FaceX && d == 0)
+        || (loc == FieldLocation::FaceY && d == 1)
+        || (loc == FieldLocation::FaceZ && d == 2);
+}
+
+// Smallest mesh dimension a location can be used with
+constexpr size_t locationMinDim(const FieldLocation loc)
+{
+    return loc == FieldLocation::FaceY ? 2
+         : (loc == FieldLocation::FaceZ ? 3 : 1);
+}
+
+template<size_t mD>
+std::array<size_t, mD> locationDims(const Mesh<mD>& mesh,
+                                    const FieldLocation loc,
+                                    const size_t comp)
+{
+    std::array<size_t, mD> dims;
+    for (size_t d=0; d<mD; d++) {
+        dims[d] = mesh.dimSizes()[d] + (onEdgesAlong(loc, comp, d) ? 1 : 0);
+    }
+    return dims;
+}
+
+template<size_t mD>
+size_t locationSize(const Mesh<mD>& mesh, const FieldLocation loc,
+                    const size_t comp)
+{
+    size_t n = 1;
+    for (size_t s : locationDims(mesh, loc, comp)) {
+        n *= s;
+    }
+    return n;
+}
+
+// Coordinates of the sample points along dimension d
+template<size_t mD>
+const std::vector<double>& locationPositions(const Mesh<mD>& mesh,
+                                             const FieldLocation loc,
+                                             const size_t comp,
+                                             const size_t d)
+{
+    return onEdgesAlong(loc, comp, d) ? mesh.edges(d) : mesh.centres(d);
+}
+
+#endif // DATASTRUCTURES_FIELDLOCATION_H
@@ -0,0 +1,137 @@
+/* ---------------------------------------------------------------------------
+ * Field-shaped array whose components live in memory-mapped files, for
+ * arrays larger than memory (see MappedStorage.h).
+ *
+ * Component d is the file <directory>/<name>.<d>, holding numCells()
+ * values in the same order as a Field. Access is through raw pointers;
+ * kernels that stream a MappedField (eg the slab-by-slab stencils in
+ * FieldOperations/Stencil.tpp) call prefetch() on the cells they will need
+ * next and release() on those they are done with, so the resident set
+ * stays a few slabs rather than the whole Mesh.
+ *
+ * A MappedField is not a Field, and the only kernels that take one are the
+ * stencil gradient, divergence and laplacian in Stencil.tpp. The solvers,
+ * the FieldOperations kernels (FieldOperations.h, Reconstruction, Fusion,
+ * TemporalBlocking, Interpolation, Probes), Particles and AMR all work on
+ * in-memory Fields only; to use them, copy in with toField(), which needs
+ * the whole Field in memory, and back with assign().
+ *
+ * Files are removed with the MappedField unless 'keep' is set, in which
+ * case existing files of the right size are reused as they are. Scratch
+ * files must not exist yet, and kept files of the wrong size are not
+ * resized; both leave the MappedField not good().
+ * --------------------------------------------------------------------------*/
+
+#ifndef DATASTRUCTURES_MAPPEDFIELD_TPP
+#define DATASTRUCTURES_MAPPEDFIELD_TPP
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "Field.tpp"
+#include "MappedStorage.h"
+
+template<typename T, size_t fD, size_t mD>
+class MappedField
+{
+    using MeshPtr = std::shared_ptr<const Mesh<mD>>;
+
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Mapped values are stored as raw bytes");
+
+public:
+    using Access = MappedStorage::Access;
+
+    MappedField(const MeshPtr mesh, const std::string& name,
+                const std::string& directory, const bool keep = false):
+        mesh_(mesh),
+        name_(name)
+    {
+        for (size_t d=0; d<fD; d++) {
+            storage_[d] = MappedStorage(
+                directory + "/" + name + "." + std::to_string(d),
+                mesh_->numCells()*sizeof(T), keep);
+        }
+    }
+
+    // Whether every component was mapped
+    bool good() const {
+        for (const MappedStorage& s : storage_) {
+            if (!s.isOpen()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Lookups
+    size_t numCells() const { return mesh_->numCells(); }
+    const Mesh<mD>& mesh() const { return *mesh_; }
+    MeshPtr meshPtr() const { return mesh_; }
+    const std::string& name() const { return name_; }
+    const std::string& path(const size_t d) const {
+        return storage_[d].path();
+    }
+
+    T* component(const size_t d) {
+        assert(d < fD);
+        return static_cast<T*>(storage_[d].data());
+    }
+    const T* component(const size_t d) const {
+        assert(d < fD);
+        return static_cast<const T*>(storage_[d].data());
+    }
+
+    // Hints, for every component, by range of cells [begin, end)
+    void advise(const Access access) const {
+        for (const MappedStorage& s : storage_) {
+            s.advise(access);
+        }
+    }
+    void prefetch(const size_t begin, const size_t end) const {
+        for (const MappedStorage& s : storage_) {
+            s.prefetch(begin*sizeof(T), (end - begin)*sizeof(T));
+        }
+    }
+    void release(const size_t begin, const size_t end) const {
+        for (const MappedStorage& s : storage_) {
+            s.release(begin*sizeof(T), (end - begin)*sizeof(T));
+        }
+    }
+    void flush() const {
+        for (const MappedStorage& s : storage_) {
+            s.flush();
+        }
+    }
+
+    // Copies to and from in-memory Fields
+    void assign(const Field<T, fD, mD>& f) {
+        assert(f.mesh() == *mesh_);
+        for (size_t d=0; d<fD; d++) {
+            const std::vector<T>& v = f.component(d);
+            std::copy(v.begin(), v.end(), component(d));
+        }
+    }
+    Field<T, fD, mD> toField() const {
+        Field<T, fD, mD> f(mesh_, name_);
+        for (size_t d=0; d<fD; d++) {
+            const T* p = component(d);
+            std::copy(p, p + numCells(), f.component(d).begin());
+        }
+        return f;
+    }
+
+private:
+    // Data members
+    MeshPtr mesh_;
+    std::string name_;
+    std::array<MappedStorage, fD> storage_;
+    // End data members
+};
+
+#endif // DATASTRUCTURES_MAPPEDFIELD_TPP
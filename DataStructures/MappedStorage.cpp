@@ -0,0 +1,143 @@
+#include "MappedStorage.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    size_t pageSize() {
+        static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return size;
+    }
+}
+
+MappedStorage::MappedStorage(const std::string& path, const size_t bytes,
+                             const bool keep):
+    path_(path),
+    keep_(keep)
+{
+    // A scratch file must be new, so an existing file is never taken over
+    // (or removed) by mistake
+    const int flags = keep ? O_RDWR | O_CREAT : O_RDWR | O_CREAT | O_EXCL;
+    fd_ = ::open(path.c_str(), flags, keep ? 0644 : 0600);
+    if (fd_ < 0) {
+        return;
+    }
+    struct stat st;
+    if (::fstat(fd_, &st) != 0) {
+        close();
+        return;
+    }
+    // An empty file is sized; a kept file with data must already be the
+    // requested size, as resizing would truncate or pad its contents
+    const off_t size = static_cast<off_t>(bytes);
+    if (st.st_size == 0) {
+        if (::ftruncate(fd_, size) != 0) {
+            close();
+            return;
+        }
+    } else if (st.st_size != size) {
+        close();
+        return;
+    }
+    if (bytes > 0) {
+        void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         fd_, 0);
+        if (p == MAP_FAILED) {
+            close();
+            return;
+        }
+        data_ = p;
+    }
+    bytes_ = bytes;
+}
+
+MappedStorage::~MappedStorage()
+{
+    close();
+}
+
+MappedStorage::MappedStorage(MappedStorage&& rhs) noexcept:
+    data_(rhs.data_),
+    bytes_(rhs.bytes_),
+    fd_(rhs.fd_),
+    path_(std::move(rhs.path_)),
+    keep_(rhs.keep_)
+{
+    rhs.data_ = nullptr;
+    rhs.bytes_ = 0;
+    rhs.fd_ = -1;
+}
+
+MappedStorage& MappedStorage::operator=(MappedStorage rhs) noexcept
+{
+    swap(*this, rhs);
+    return *this;
+}
+
+void swap(MappedStorage& first, MappedStorage& second) noexcept
+{
+    using std::swap;
+    swap(first.data_, second.data_);
+    swap(first.bytes_, second.bytes_);
+    swap(first.fd_, second.fd_);
+    swap(first.path_, second.path_);
+    swap(first.keep_, second.keep_);
+}
+
+void MappedStorage::advise(const Access access) const
+{
+    const int advice = (access == Access::Sequential) ? MADV_SEQUENTIAL
+                     : (access == Access::Random) ? MADV_RANDOM
+                     : MADV_NORMAL;
+    adviseRange(0, bytes_, advice);
+}
+
+void MappedStorage::prefetch(const size_t offset, const size_t bytes) const
+{
+    adviseRange(offset, bytes, MADV_WILLNEED);
+}
+
+void MappedStorage::release(const size_t offset, const size_t bytes) const
+{
+    adviseRange(offset, bytes, MADV_DONTNEED);
+}
+
+void MappedStorage::flush() const
+{
+    if (data_) {
+        ::msync(data_, bytes_, MS_SYNC);
+    }
+}
+
+void MappedStorage::close()
+{
+    if (data_) {
+        ::munmap(data_, bytes_);
+        data_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+        if (!keep_) {
+            ::unlink(path_.c_str());
+        }
+    }
+    bytes_ = 0;
+}
+
+void MappedStorage::adviseRange(const size_t offset, const size_t bytes,
+                                const int advice) const
+{
+    if (!data_ || offset >= bytes_ || bytes == 0) {
+        return;
+    }
+    const size_t page = pageSize();
+    const size_t begin = offset / page * page;
+    const size_t end = std::min(offset + bytes, bytes_);
+    ::madvise(static_cast<char*>(data_) + begin, end - begin, advice);
+}
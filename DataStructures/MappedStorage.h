@@ -0,0 +1,76 @@
+/* ---------------------------------------------------------------------------
+ * A file mapped into memory (POSIX mmap, shared), for arrays larger than
+ * RAM: the kernel pages the file in on access and writes dirty pages back,
+ * so only the part being worked on needs to be resident.
+ *
+ * The access hints map onto madvise:
+ *      advise(Sequential) - aggressive readahead, early reclaim behind
+ *      advise(Random)     - no readahead
+ *      prefetch(range)    - start reading a range in (MADV_WILLNEED) while
+ *                           the caller works on something else
+ *      release(range)     - drop a range from the process (MADV_DONTNEED);
+ *                           the data stays in the file and page cache
+ * Ranges are in bytes and rounded out to whole pages.
+ *
+ * Scratch files (keep == false) are created exclusively - an existing file
+ * at the path is an error - and removed when the mapping is destroyed.
+ * Kept files are created if missing and otherwise reused as they are, so
+ * an existing non-empty file must already be 'bytes' long; it is never
+ * resized. Failure to open, size or map the file leaves the storage
+ * closed - check isOpen().
+ * --------------------------------------------------------------------------*/
+
+#ifndef DATASTRUCTURES_MAPPEDSTORAGE_H
+#define DATASTRUCTURES_MAPPEDSTORAGE_H
+
+#include <cstddef>
+#include <string>
+
+class MappedStorage
+{
+public:
+    enum class Access {
+        Normal,
+        Sequential,
+        Random
+    };
+
+    MappedStorage() = default;
+    // Maps 'bytes' bytes of the file at path, creating it if needed
+    MappedStorage(const std::string& path, const size_t bytes,
+                  const bool keep);
+    ~MappedStorage();
+
+    MappedStorage(MappedStorage&& rhs) noexcept;
+    MappedStorage& operator=(MappedStorage rhs) noexcept;
+    friend void swap(MappedStorage& first, MappedStorage& second) noexcept;
+
+    MappedStorage(const MappedStorage&) = delete;
+
+    bool isOpen() const { return fd_ >= 0; }
+    void* data() const { return data_; }
+    size_t bytes() const { return bytes_; }
+    const std::string& path() const { return path_; }
+
+    void advise(const Access access) const;
+    void prefetch(const size_t offset, const size_t bytes) const;
+    void release(const size_t offset, const size_t bytes) const;
+    // Write dirty pages back to the file, waiting for them
+    void flush() const;
+
+private:
+    // Data members
+    void* data_ = nullptr;
+    size_t bytes_ = 0;
+    int fd_ = -1;
+    std::string path_;
+    bool keep_ = true;
+    // End data members
+
+    void close();
+    // madvise on [offset, offset+bytes) rounded out to pages
+    void adviseRange(const size_t offset, const size_t bytes,
+                     const int advice) const;
+};
+
+#endif // DATASTRUCTURES_MAPPEDSTORAGE_H
@@ -1,34 +1,32 @@
 #include "Mesh.h"
 
-#include <cmath>
+#include <algorithm>
+
 
 template<size_t meshDim>
 BoundingBox<meshDim> Mesh<meshDim>::bounds() const {
     std::vector<double> bnds;
     for (size_t d=0; d<meshDim; d++) {
-        bnds.push_back(dimMin_[d]);
-        bnds.push_back(dimMax_[d]);
+        bnds.push_back(geom_->dimMin_[d]);
+        bnds.push_back(geom_->dimMax_[d]);
     }
     return BoundingBox<meshDim>(std::move(bnds));
 }
 
 template<size_t meshDim>
 bool Mesh<meshDim>::operator==(const Mesh<meshDim> &rhs) const {
-    if (this == &rhs) {
-        return true;
-    }
-    if ((dimSize_ != rhs.dimSizes())
-      || (dimMin_ != rhs.dimMin())
-      || (dimMax_ != rhs.dimMax())) {
-        return false;
-    }
-    if (scalingType_ != rhs.scalingType()) {
-        return false;
-    }
-    if (numCells_ != rhs.numCells()) {
-        return false;
-    }
-    return true;
+    // Geometries are interned, so equal Meshes share one
+    return geom_ == rhs.geom_;
+}
+
+template<size_t meshDim>
+Mesh<meshDim> Mesh<meshDim>::reordered(const CellOrdering ordering,
+                                       const size_t tile) const
+{
+    Mesh<meshDim> m;
+    m.geom_ = MeshGeometry<meshDim>::intern(
+            MeshGeometry<meshDim>(*geom_, ordering, tile));
+    return m;
 }
 
 template<size_t meshDim>
@@ -40,115 +38,84 @@ bool Mesh<meshDim>::isSameMesh(const Mesh<meshDim> &rhs) const {
 }
 
 template<size_t meshDim>
-void Mesh<meshDim>::placeCentres(const int d) {
-    // Place the centres at the midpoints of the cells
-    const size_t N = dimSize_[d];
-    centrePosition_[d].reserve(N);
-    for (size_t n=0; n<N; n++) {
-        centrePosition_[d].push_back(0.5*(edgePosition_[d][n]+edgePosition_[d][n+1]));
+double Mesh<meshDim>::getCentre(const size_t d, const size_t i) const
+{
+    // Bounds checking if NDEBUG not defined
+    assert(i<geom_->dimSize_[d]);
+    return geom_->centrePosition_[d][i];
+}
+
+template<size_t meshDim>
+size_t Mesh<meshDim>::locate(const size_t d, const double x) const
+{
+    assert(d < meshDim);
+    const size_t N = geom_->dimSize_[d];
+    const std::vector<double>& e = geom_->edgePosition_[d];
+    size_t i = std::min(static_cast<size_t>(geom_->cellCoordinate(d, x)), N-1);
+    // The inverse and the edges can disagree in the last bit
+    if (i > 0 && x < e[i]) {
+        i--;
+    } else if (i < N-1 && x >= e[i+1]) {
+        i++;
     }
+    return i;
 }
 
 template<size_t meshDim>
-void Mesh<meshDim>::placeEdges(const int d) {
-    const unsigned int numEdges = dimSize_[d] + 1;
-    const double range = dimMax_[d] - dimMin_[d];
-
-    // Reserve to save time - requires .push_back later
-    edgePosition_[d].reserve(numEdges);
-
-    switch(scalingType_)
-    {
-        case MeshScalingType::Constant:
-        {
-            // Constant spacing
-            const double dx = range / dimSize_[d];
-            for (size_t i=0; i<numEdges-1; i++) {
-                edgePosition_[d].push_back(dimMin_[d] + (dx*static_cast<double>(i)));
-            }
-            // Force the edge on the last point (in case dx*N + min != max)
-            edgePosition_[d].push_back(dimMax_[d]);
-        }
-        break;
-
-        case MeshScalingType::Exponential:
-        {
-            // Exponential spacing
-            constexpr double b = 3;
-            constexpr double dom = exp(b)-1;
-            for (size_t i=0; i<dimSize_[d]; i++) {
-                const double u = static_cast<double>(i) / dimSize_[d];
-                const double x = ((exp(b*u) - 1)/dom);
-                edgePosition_[d].push_back((x*range) + dimMin_[d]);
-            }
-            edgePosition_[d].push_back(dimMax_[d]);
-        }
-        break;
-
-        case MeshScalingType::Hyperbolic:
-        {
-            // Hyperbolic tangent spacing
-            constexpr double b = 3;
-            constexpr double c = 0.5; // 1-c is the location of the 'attractor'
-            constexpr double A = tanh(b*-1*c);
-            constexpr double B = tanh(b*(1-c));
-            for (size_t i=0; i<dimSize_[d]; i++) {
-                const double u = static_cast<double>(i) / dimSize_[d];
-                const double x = (tanh(b*(u-c)) - A) / (B-A);
-                edgePosition_[d].push_back((x*range) + dimMin_[d]);
-            }
-            edgePosition_[d].push_back(dimMax_[d]);
-        }
-        break;
-
-        case MeshScalingType::Pivot:
-        {
-            edgePosition_[d].resize(numEdges);
-            // Pivoted spacing - requires an even number of cells
-            assert(dimSize_[d]%2==0);
-            constexpr double p=0.35;
-            constexpr double b = 2;
-            constexpr double dom = exp(b)-1;
-            const double mid = (range * p) + dimMin_[d];
-            const size_t dim2 = dimSize_[d]/2;
-            for (size_t i=0; i<dim2; i++) {
-                const double u = static_cast<double>(i) / dim2;
-                const double x = ((exp(b*u) - 1)/dom);
-                const double step_lower = x*range*(p < 0.5 ? p : 1-p);
-                const double step_upper = x*range*(p < 0.5 ? 1-p : p);
-                // Upper half
-                edgePosition_[d][i+dim2] = mid + step_upper;
-                // Lower half
-                edgePosition_[d][dim2-i-1] = mid - step_lower;
-            }
-        }
-        break;
+size_t Mesh<meshDim>::locate(const std::array<double, meshDim>& point) const
+{
+    size_t idx = 0;
+    size_t stride = 1;
+    for (size_t d=0; d<meshDim; d++) {
+        idx += stride * locate(d, point[d]);
+        stride *= geom_->dimSize_[d];
     }
+    return storageIndex(idx);
 }
 
 template<size_t meshDim>
-size_t Mesh<meshDim>::calcNumCells() const
+void Mesh<meshDim>::locate(const std::vector<std::array<double, meshDim>>& points,
+                           std::vector<size_t>& cells) const
 {
-    int numcells = 1;
+    // Dimension by dimension, so each sweep uses a single inverse mapping
+    cells.assign(points.size(), 0);
+    size_t stride = 1;
     for (size_t d=0; d<meshDim; d++) {
-        numcells *= dimSize_[d];
+        for (size_t p=0; p<points.size(); p++) {
+            cells[p] += stride * locate(d, points[p][d]);
+        }
+        stride *= geom_->dimSize_[d];
+    }
+    if (geom_->order_) {
+        for (size_t& c : cells) {
+            c = geom_->order_->toStorage(c);
+        }
     }
-    return numcells;
 }
 
 template<size_t meshDim>
-double Mesh<meshDim>::getCentre(const size_t d, const size_t i) const
+void Mesh<meshDim>::bracketCentres(const size_t d, const double x,
+                                   size_t& lo, double& w) const
 {
-    // Bounds checking if NDEBUG not defined
-    assert(i<dimSize_[d]);
-    return centrePosition_[d][i];
+    const size_t N = geom_->dimSize_[d];
+    const std::vector<double>& c = geom_->centrePosition_[d];
+    lo = locate(d, x);
+    if (lo > 0 && x < c[lo]) {
+        lo--;
+    }
+    w = 0;
+    if (N > 1) {
+        lo = std::min(lo, N-2);
+        const double inv = geom_->metrics(d).invCentreSpacing[lo+1];
+        w = std::min(std::max((x - c[lo])*inv, 0.0), 1.0);
+    }
 }
 
 template<size_t meshDim>
 void Mesh<meshDim>::checkBounds(std::vector<size_t> idxs) const
 {
     for (size_t d=0; d<meshDim; d++) {
-        assert(idxs[d] < dimSize_[d]);
+        assert(idxs[d] < geom_->dimSize_[d]);
     }
 }
 
@@ -157,7 +124,7 @@ template<size_t dim_n>
 void Mesh<meshDim>::getSubIdx(std::vector<size_t> &vec, const size_t &remainder, helper<dim_n>) const {
     size_t denom = 1;
     for (size_t d=0; d<dim_n-1; d++) {
-        denom *= dimSize_[d];
+        denom *= geom_->dimSize_[d];
     }
     vec[dim_n-1] = (remainder/denom);
     size_t new_rem = remainder % denom;
@@ -4,13 +4,21 @@
 |
 |   Once constructed (by main.cpp?) it should not be changed - it cannot be
 |       restructured, and cells cannot be moved or refined or unrefined
+|   (AMR/AMRHierarchy.h refines by composing patches of separate Meshes)
+|
+|   The geometry is held in an interned MeshGeometry, so Meshes built from
+|       the same parameters share it, compare equal by pointer and are
+|       cheap to copy
 |
 \* ------------------------------------------------------------------------- */
 
 #ifndef MESH_H
 #define MESH_H
 
+#include <array>
+#include <memory>
 #include <type_traits>
+#include <utility>
 #include <vector>
 #include <cstddef>
 
@@ -19,28 +27,8 @@
 
 #include "TemplateFunctions.H"
 #include "BoundingBox.h"
-
-struct MeshDimension
-{
-    constexpr MeshDimension(const int numCells, const double min, const double max):
-        numCells_(numCells),
-        minVal_(min),
-        maxVal_(max)
-    {}
-
-    // Prevent implicit cast from double to int for 'numCells'
-    MeshDimension(double, double, double) = delete;
-
-    const int numCells_;
-    const double minVal_, maxVal_;
-};
-
-enum class MeshScalingType {
-    Constant,
-    Pivot,
-    Hyperbolic,
-    Exponential
-};
+#include "CellOrdering.h"
+#include "MeshGeometry.h"
 
 template<size_t n>
 struct helper
@@ -59,66 +47,46 @@ public:
              EnableIf<areT<MeshDimension, Dims...>::value>...,
              EnableIf<sizeof...(Dims)==meshDim>...>
     Mesh(MeshScalingType scaling, Dims... dims):
-        scalingType_(scaling)
-    {
-        DimList dimList{dims...};
-        for (size_t i=0; i<meshDim; i++) {
-            dimSize_.push_back(dimList[i].numCells_);
-            dimMin_.push_back(dimList[i].minVal_);
-            dimMax_.push_back(dimList[i].maxVal_);
-            numCells_ = calcNumCells();
-            placeEdges(i);
-            placeCentres(i);
-        }
-    }
+        geom_(MeshGeometry<meshDim>::intern(
+                  MeshGeometry<meshDim>(scaling, DimList{dims...})))
+    {}
 
-    // Copy and move constructors
+    // Copy and move constructors - the geometry is shared
     Mesh(const Mesh<meshDim>& rhs):
-        dimMin_(rhs.dimMin()),
-        dimMax_(rhs.dimMax()),
-        dimSize_(rhs.dimSizes()),
-        numCells_(rhs.numCells()),
-        scalingType_(rhs.scalingType()),
-        centrePosition_(rhs.centrePosition_),
-        edgePosition_(rhs.edgePosition_)
+        geom_(rhs.geom_)
     {}
 
-    Mesh(Mesh<meshDim>&& rhs):
-        Mesh()
+    // Takes the geometry and leaves rhs as an empty Mesh, without allocating
+    Mesh(Mesh<meshDim>&& rhs) noexcept:
+        geom_(std::move(rhs.geom_))
     {
-        swap(*this, rhs);
+        rhs.geom_ = MeshGeometry<meshDim>::empty();
     }
 
     // Copy/move assignment operator
-    Mesh<meshDim>& operator=(Mesh<meshDim> rhs) {
+    Mesh<meshDim>& operator=(Mesh<meshDim> rhs) noexcept {
         swap(*this, rhs);
         return *this;
     }
 
-    friend void swap(Mesh<meshDim>& first, Mesh<meshDim>& second) {
+    friend void swap(Mesh<meshDim>& first, Mesh<meshDim>& second) noexcept {
         using std::swap;
-        swap(first.dimMin_, second.dimMin_);
-        swap(first.dimMax_, second.dimMax_);
-        swap(first.dimSize_, second.dimSize_);
-        swap(first.numCells_, second.numCells_);
-        swap(first.scalingType_, second.scalingType_);
-        swap(first.centrePosition_, second.centrePosition_);
-        swap(first.edgePosition_, second.edgePosition_);
+        swap(first.geom_, second.geom_);
     }
 
     static Mesh<meshDim> dummyMesh() { return Mesh(); }
 
-    size_t numCells() const { return numCells_; }
+    size_t numCells() const { return geom_->numCells_; }
     // Always defined (can't have a 0D mesh)
-    size_t xCells() const { return dimSize_[0]; }
+    size_t xCells() const { return geom_->dimSize_[0]; }
     // Get size if 2D or greater, return 0 otherwise
     template<size_t meshD = meshDim, EnableIf<meshD>=2>...>
-    size_t yCells() const { return dimSize_[1]; }
+    size_t yCells() const { return geom_->dimSize_[1]; }
     template<size_t meshD = meshDim, EnableIf<meshD<2>...>
     size_t yCells() const { return 0; }
     // Get size if 3D or greater, return 0 otherwise
     template<size_t meshD = meshDim, EnableIf<meshD>=3>...>
-    size_t zCells() const { return dimSize_[2]; }
+    size_t zCells() const { return geom_->dimSize_[2]; }
     template<size_t meshD = meshDim, EnableIf<meshD<3>...>
     size_t zCells() const { return 0; }
 
@@ -129,8 +97,8 @@ public:
     template<size_t mD = meshDim, EnableIf<mD==1>...>
     BoundingBox<meshDim> bounds(const size_t idx) const {
         std::vector<double> bnds;
-        bnds.push_back(edgePosition_[0][idx]);
-        bnds.push_back(edgePosition_[0][idx+1]);
+        bnds.push_back(geom_->edgePosition_[0][idx]);
+        bnds.push_back(geom_->edgePosition_[0][idx+1]);
         return BoundingBox<meshDim>(std::move(bnds));
     }
 
@@ -138,11 +106,11 @@ public:
     BoundingBox<meshDim> bounds(const size_t idx) const {
         // Convert single index to set of indices
         std::vector<size_t> idcs(meshDim);
-        getSubIdx(idcs, idx, helper<mD>());
+        getSubIdx(idcs, lexicographicIndex(idx), helper<mD>());
         std::vector<double> bnds;
         for (size_t d=0; d<meshDim; d++) {
-            bnds.push_back(edgePosition_[d][idcs[d]]);
-            bnds.push_back(edgePosition_[d][idcs[d]+1]);
+            bnds.push_back(geom_->edgePosition_[d][idcs[d]]);
+            bnds.push_back(geom_->edgePosition_[d][idcs[d]+1]);
         }
         return BoundingBox<meshDim>(std::move(bnds));
     }
@@ -155,8 +123,8 @@ public:
          std::vector<double> bnds;
          std::vector<size_t> idx { indices... };
          for (size_t d=0; d<meshDim; d++) {
-             bnds.push_back(edgePosition_[d][idx[d]]);
-             bnds.push_back(edgePosition_[d][idx[d]+1]);
+             bnds.push_back(geom_->edgePosition_[d][idx[d]]);
+             bnds.push_back(geom_->edgePosition_[d][idx[d]+1]);
          }
          return BoundingBox<meshDim>(std::move(bnds));
     }
@@ -183,38 +151,97 @@ public:
     template<size_t rhsDim>
     bool operator!=(const Mesh<rhsDim> &rhs) const { return ! operator==(rhs); }
 
-    const std::vector<double>& dimMin() const { return dimMin_; }
-    const std::vector<double>& dimMax() const { return dimMax_; }
-    const std::vector<size_t>& dimSizes() const { return dimSize_; }
-    const MeshScalingType& scalingType() const { return scalingType_; }
+    const std::vector<double>& dimMin() const { return geom_->dimMin_; }
+    const std::vector<double>& dimMax() const { return geom_->dimMax_; }
+    const std::vector<size_t>& dimSizes() const { return geom_->dimSize_; }
+    const MeshScalingType& scalingType() const { return geom_->scalingType_; }
+    // Interned geometry, shared by every equal Mesh
+    const std::shared_ptr<const MeshGeometry<meshDim>>& geometry() const {
+        return geom_;
+    }
+    size_t hash() const { return geom_->hash_; }
+    // Positions along a single dimension (dimSize+1 edges, dimSize centres)
+    const std::vector<double>& edges(const size_t d) const {
+        assert(d < meshDim);
+        return geom_->edgePosition_[d];
+    }
+    const std::vector<double>& centres(const size_t d) const {
+        assert(d < meshDim);
+        return geom_->centrePosition_[d];
+    }
+    // Cached widths, centre spacings, inverses and face weights along d
+    // (see MeshGeometry.h)
+    const MeshMetrics& metrics(const size_t d) const {
+        return geom_->metrics(d);
+    }
+
+    // Storage order of the cells (see CellOrdering.h). Cell indices taken
+    // and returned by the Mesh and Fields are storage indices.
+    CellOrdering ordering() const { return geom_->ordering(); }
+    // Copy of this Mesh with a different cell ordering
+    Mesh<meshDim> reordered(const CellOrdering ordering,
+                            const size_t tile = 8) const;
+
+    size_t storageIndex(const size_t lex) const {
+        return geom_->order_ ? geom_->order_->toStorage(lex) : lex;
+    }
+    size_t lexicographicIndex(const size_t idx) const {
+        return geom_->order_ ? geom_->order_->toLexicographic(idx) : idx;
+    }
+    // Storage index of a cell from its per-dimension indices, and back
+    size_t cellIndex(const std::array<size_t, meshDim>& idx) const {
+        size_t lex = 0;
+        for (size_t d=meshDim; d-->0;) {
+            lex = lex*geom_->dimSize_[d] + idx[d];
+        }
+        return storageIndex(lex);
+    }
+    std::array<size_t, meshDim> cellSubIndex(const size_t idx) const {
+        std::array<size_t, meshDim> sub;
+        size_t lex = lexicographicIndex(idx);
+        for (size_t d=0; d<meshDim; d++) {
+            sub[d] = lex % geom_->dimSize_[d];
+            lex /= geom_->dimSize_[d];
+        }
+        return sub;
+    }
+    // Storage index of the cell 'offset' cells away along d, or npos if
+    // that is outside the Mesh
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    size_t neighbour(const size_t idx, const size_t d, const long offset) const {
+        std::array<size_t, meshDim> sub = cellSubIndex(idx);
+        const long j = static_cast<long>(sub[d]) + offset;
+        if (j < 0 || j >= static_cast<long>(geom_->dimSize_[d])) {
+            return npos;
+        }
+        sub[d] = static_cast<size_t>(j);
+        return cellIndex(sub);
+    }
+
+    // Point location. The cell is found from the inverse of the scaling
+    // function used to place the edges, then corrected by at most one cell
+    // for rounding. Points outside the Mesh are clamped to the boundary
+    // cells.
+    // Cell index along dimension d containing coordinate x
+    size_t locate(const size_t d, const double x) const;
+    // Single index of the cell containing point
+    size_t locate(const std::array<double, meshDim>& point) const;
+    // Batched version, cells is resized to match points
+    void locate(const std::vector<std::array<double, meshDim>>& points,
+                std::vector<size_t>& cells) const;
+    // Lower of the two cell centres along d bracketing x, and the linear
+    // weight of the upper one (clamped to [0,1] beyond the outer centres)
+    void bracketCentres(const size_t d, const double x,
+                        size_t& lo, double& w) const;
 
 private:
     // Data members
-    std::vector<double> dimMin_;
-    std::vector<double> dimMax_;
-    std::vector<size_t> dimSize_;
-    size_t numCells_;
-    MeshScalingType scalingType_;
-    std::vector<double> centrePosition_[meshDim];
-    std::vector<double> edgePosition_[meshDim];
+    std::shared_ptr<const MeshGeometry<meshDim>> geom_;
     // End data members
 
     Mesh():
-        dimMin_(meshDim),
-        dimMax_(meshDim),
-        dimSize_(meshDim),
-        numCells_(),
-        scalingType_(MeshScalingType::Constant)
-    {
-        for (size_t d=0; d<meshDim; d++) {
-            centrePosition_[d] = std::vector<double>();
-            edgePosition_[d] = std::vector<double>();
-        }
-    }
-
-    void placeCentres(const int d);
-    void placeEdges(const int d);
-    size_t calcNumCells() const;
+        geom_(MeshGeometry<meshDim>::empty())
+    {}
 
     double getCentre(const size_t d, const size_t i) const;
 
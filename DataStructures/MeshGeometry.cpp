@@ -0,0 +1,337 @@
+#include "MeshGeometry.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+    // Parameters of the stretching functions, shared by placeEdges and the
+    // inverse mappings used by locate
+    constexpr double expB = 3;
+    constexpr double hypB = 3;
+    constexpr double hypC = 0.5; // 1-c is the location of the 'attractor'
+    constexpr double pivotP = 0.35;
+    constexpr double pivotB = 2;
+}
+
+namespace {
+    // Interned geometries of one dimension, keyed by hash. Entries are weak
+    // so a geometry is freed with its last Mesh; expired entries are pruned
+    // as the table grows.
+    template<size_t meshDim>
+    struct Registry
+    {
+        using Entry = std::weak_ptr<const MeshGeometry<meshDim>>;
+        std::mutex mutex;
+        std::unordered_multimap<size_t, Entry> table;
+        size_t pruneAt = 64;
+    };
+
+    template<size_t meshDim>
+    Registry<meshDim>& registry()
+    {
+        static Registry<meshDim> r;
+        return r;
+    }
+
+    void hashCombine(size_t& seed, const size_t h)
+    {
+        seed ^= h + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+    }
+}
+
+template<size_t meshDim>
+MeshGeometry<meshDim>::MeshGeometry():
+    dimMin_(meshDim),
+    dimMax_(meshDim),
+    dimSize_(meshDim),
+    numCells_(),
+    scalingType_(MeshScalingType::Constant),
+    hash_(),
+    metricCache_(std::make_shared<MetricCache>())
+{}
+
+template<size_t meshDim>
+MeshGeometry<meshDim>::MeshGeometry(const MeshScalingType scaling,
+                                    const std::vector<MeshDimension>& dims):
+    scalingType_(scaling),
+    metricCache_(std::make_shared<MetricCache>())
+{
+    for (size_t i=0; i<meshDim; i++) {
+        dimSize_.push_back(dims[i].numCells_);
+        dimMin_.push_back(dims[i].minVal_);
+        dimMax_.push_back(dims[i].maxVal_);
+        placeEdges(i);
+        placeCentres(i);
+    }
+    numCells_ = calcNumCells();
+    hash_ = calcHash();
+}
+
+template<size_t meshDim>
+MeshGeometry<meshDim>::MeshGeometry(const MeshGeometry<meshDim>& g,
+                                    const CellOrdering ordering,
+                                    const size_t tile):
+    MeshGeometry<meshDim>(g)
+{
+    if (ordering == CellOrdering::Lexicographic) {
+        order_.reset();
+    } else {
+        order_ = std::make_shared<const CellOrder<meshDim>>(dimSize_,
+                                                            ordering, tile);
+    }
+    hash_ = calcHash();
+}
+
+template<size_t meshDim>
+bool MeshGeometry<meshDim>::sameAs(const MeshGeometry<meshDim>& rhs) const
+{
+    if ((dimSize_ != rhs.dimSize_)
+      || (dimMin_ != rhs.dimMin_)
+      || (dimMax_ != rhs.dimMax_)
+      || (scalingType_ != rhs.scalingType_)) {
+        return false;
+    }
+    if (ordering() != rhs.ordering()) {
+        return false;
+    }
+    return ordering() != CellOrdering::Tiled
+        || order_->tile() == rhs.order_->tile();
+}
+
+template<size_t meshDim>
+typename MeshGeometry<meshDim>::Ptr
+MeshGeometry<meshDim>::intern(MeshGeometry<meshDim>&& g)
+{
+    Registry<meshDim>& reg = registry<meshDim>();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    auto range = reg.table.equal_range(g.hash_);
+    for (auto it = range.first; it != range.second; ++it) {
+        Ptr existing = it->second.lock();
+        if (existing && existing->sameAs(g)) {
+            return existing;
+        }
+    }
+    Ptr p = std::make_shared<const MeshGeometry<meshDim>>(std::move(g));
+    reg.table.emplace(p->hash_, p);
+    if (reg.table.size() >= reg.pruneAt) {
+        for (auto it = reg.table.begin(); it != reg.table.end();) {
+            it = it->second.expired() ? reg.table.erase(it) : std::next(it);
+        }
+        reg.pruneAt = std::max<size_t>(64, 2*reg.table.size());
+    }
+    return p;
+}
+
+namespace
+{
+    // Built during static initialisation, so that empty() (and so moving a
+    // Mesh) never allocates
+    template<size_t meshDim>
+    const typename MeshGeometry<meshDim>::Ptr emptyGeometry =
+        std::make_shared<const MeshGeometry<meshDim>>();
+}
+
+template<size_t meshDim>
+const typename MeshGeometry<meshDim>::Ptr& MeshGeometry<meshDim>::empty() noexcept
+{
+    return emptyGeometry<meshDim>;
+}
+
+template<size_t meshDim>
+const MeshMetrics& MeshGeometry<meshDim>::metrics(const size_t d) const
+{
+    assert(d < meshDim);
+    std::call_once(metricCache_->once, [this]() {
+        for (size_t k=0; k<meshDim; k++) {
+            const std::vector<double>& e = edgePosition_[k];
+            const std::vector<double>& x = centrePosition_[k];
+            const size_t N = dimSize_[k];
+            MeshMetrics& m = metricCache_->metrics[k];
+            m.width.resize(N);
+            m.invWidth.resize(N);
+            for (size_t i=0; i<N; i++) {
+                m.width[i] = e[i+1] - e[i];
+                m.invWidth[i] = 1.0/m.width[i];
+            }
+            m.centreSpacing.resize(N+1);
+            m.invCentreSpacing.resize(N+1);
+            m.faceWeight.resize(N+1);
+            for (size_t f=0; f<=N && N>0; f++) {
+                const double lo = (f == 0 ? e[0] : x[f-1]);
+                const double hi = (f == N ? e[N] : x[f]);
+                m.centreSpacing[f] = hi - lo;
+                m.invCentreSpacing[f] = 1.0/(hi - lo);
+                m.faceWeight[f] = (f == 0) ? 1.0
+                                : (f == N ? 0.0 : (e[f] - lo)/(hi - lo));
+            }
+        }
+    });
+    return metricCache_->metrics[d];
+}
+
+template<size_t meshDim>
+size_t MeshGeometry<meshDim>::calcHash() const
+{
+    size_t h = std::hash<int>()(static_cast<int>(scalingType_));
+    for (size_t d=0; d<meshDim; d++) {
+        hashCombine(h, std::hash<size_t>()(dimSize_[d]));
+        hashCombine(h, std::hash<double>()(dimMin_[d]));
+        hashCombine(h, std::hash<double>()(dimMax_[d]));
+    }
+    hashCombine(h, std::hash<int>()(static_cast<int>(ordering())));
+    if (order_) {
+        hashCombine(h, std::hash<size_t>()(order_->tile()));
+    }
+    return h;
+}
+
+template<size_t meshDim>
+void MeshGeometry<meshDim>::placeCentres(const int d) {
+    // Place the centres at the midpoints of the cells
+    const size_t N = dimSize_[d];
+    centrePosition_[d].reserve(N);
+    for (size_t n=0; n<N; n++) {
+        centrePosition_[d].push_back(0.5*(edgePosition_[d][n]+edgePosition_[d][n+1]));
+    }
+}
+
+template<size_t meshDim>
+void MeshGeometry<meshDim>::placeEdges(const int d) {
+    const unsigned int numEdges = dimSize_[d] + 1;
+    const double range = dimMax_[d] - dimMin_[d];
+
+    // Reserve to save time - requires .push_back later
+    edgePosition_[d].reserve(numEdges);
+
+    switch(scalingType_)
+    {
+        case MeshScalingType::Constant:
+        {
+            // Constant spacing
+            const double dx = range / dimSize_[d];
+            for (size_t i=0; i<numEdges-1; i++) {
+                edgePosition_[d].push_back(dimMin_[d] + (dx*static_cast<double>(i)));
+            }
+            // Force the edge on the last point (in case dx*N + min != max)
+            edgePosition_[d].push_back(dimMax_[d]);
+        }
+        break;
+
+        case MeshScalingType::Exponential:
+        {
+            // Exponential spacing
+            constexpr double b = expB;
+            constexpr double dom = exp(b)-1;
+            for (size_t i=0; i<dimSize_[d]; i++) {
+                const double u = static_cast<double>(i) / dimSize_[d];
+                const double x = ((exp(b*u) - 1)/dom);
+                edgePosition_[d].push_back((x*range) + dimMin_[d]);
+            }
+            edgePosition_[d].push_back(dimMax_[d]);
+        }
+        break;
+
+        case MeshScalingType::Hyperbolic:
+        {
+            // Hyperbolic tangent spacing
+            constexpr double b = hypB;
+            constexpr double c = hypC;
+            constexpr double A = tanh(b*-1*c);
+            constexpr double B = tanh(b*(1-c));
+            for (size_t i=0; i<dimSize_[d]; i++) {
+                const double u = static_cast<double>(i) / dimSize_[d];
+                const double x = (tanh(b*(u-c)) - A) / (B-A);
+                edgePosition_[d].push_back((x*range) + dimMin_[d]);
+            }
+            edgePosition_[d].push_back(dimMax_[d]);
+        }
+        break;
+
+        case MeshScalingType::Pivot:
+        {
+            edgePosition_[d].resize(numEdges);
+            // Pivoted spacing - requires an even number of cells
+            assert(dimSize_[d]%2==0);
+            constexpr double p = pivotP;
+            constexpr double b = pivotB;
+            constexpr double dom = exp(b)-1;
+            const double mid = (range * p) + dimMin_[d];
+            const size_t dim2 = dimSize_[d]/2;
+            for (size_t i=0; i<=dim2; i++) {
+                const double u = static_cast<double>(i) / dim2;
+                const double x = ((exp(b*u) - 1)/dom);
+                const double step_lower = x*range*p;
+                const double step_upper = x*range*(1-p);
+                // Upper half
+                edgePosition_[d][i+dim2] = mid + step_upper;
+                // Lower half
+                edgePosition_[d][dim2-i] = mid - step_lower;
+            }
+            // Force the end points (in case of rounding)
+            edgePosition_[d][0] = dimMin_[d];
+            edgePosition_[d][numEdges-1] = dimMax_[d];
+        }
+        break;
+    }
+}
+
+template<size_t meshDim>
+size_t MeshGeometry<meshDim>::calcNumCells() const
+{
+    int numcells = 1;
+    for (size_t d=0; d<meshDim; d++) {
+        numcells *= dimSize_[d];
+    }
+    return numcells;
+}
+
+template<size_t meshDim>
+double MeshGeometry<meshDim>::cellCoordinate(const size_t d, const double x) const
+{
+    const double N = static_cast<double>(dimSize_[d]);
+    const double range = dimMax_[d] - dimMin_[d];
+    // Fractional position in [0,1], clamped
+    const double s = std::min(std::max((x - dimMin_[d]) / range, 0.0), 1.0);
+
+    switch(scalingType_)
+    {
+        case MeshScalingType::Constant:
+            return s*N;
+
+        case MeshScalingType::Exponential:
+        {
+            const double dom = std::exp(expB)-1;
+            return N * std::log1p(s*dom) / expB;
+        }
+
+        case MeshScalingType::Hyperbolic:
+        {
+            const double A = std::tanh(hypB*-1*hypC);
+            const double B = std::tanh(hypB*(1-hypC));
+            return N * (hypC + std::atanh(s*(B-A) + A)/hypB);
+        }
+
+        case MeshScalingType::Pivot:
+        {
+            const double dom = std::exp(pivotB)-1;
+            const double dim2 = N/2;
+            if (s >= pivotP) {
+                const double t = (s - pivotP)/(1 - pivotP);
+                return dim2 + dim2*std::log1p(t*dom)/pivotB;
+            }
+            const double t = (pivotP - s)/pivotP;
+            return dim2 - dim2*std::log1p(t*dom)/pivotB;
+        }
+    }
+    return 0;
+}
+
+// Instantiate templates
+template struct MeshGeometry<1>;
+template struct MeshGeometry<2>;
+template struct MeshGeometry<3>;
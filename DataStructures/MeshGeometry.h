@@ -0,0 +1,121 @@
+/* ---------------------------------------------------------------------------
+ * The immutable geometry behind a Mesh: sizes, bounds, scaling, edge and
+ * centre positions and cell ordering.
+ *
+ * Geometries are interned. intern() returns the existing geometry when an
+ * identical one is alive (found through a hash of the defining parameters),
+ * so every Mesh built with the same parameters shares one refcounted
+ * object. Mesh equality is then a pointer comparison and copying a Mesh
+ * copies a shared_ptr.
+ *
+ * Metric arrays (cell widths, centre spacings and their inverses, face
+ * interpolation weights) are built on first use and cached with the
+ * geometry, so stencils can multiply by precomputed inverses instead of
+ * dividing in their inner loops.
+ * --------------------------------------------------------------------------*/
+
+#ifndef DATASTRUCTURES_MESHGEOMETRY_H
+#define DATASTRUCTURES_MESHGEOMETRY_H
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "AlignedAllocator.h"
+#include "CellOrdering.h"
+
+struct MeshDimension
+{
+    constexpr MeshDimension(const int numCells, const double min, const double max):
+        numCells_(numCells),
+        minVal_(min),
+        maxVal_(max)
+    {}
+
+    // Prevent implicit cast from double to int for 'numCells'
+    MeshDimension(double, double, double) = delete;
+
+    const int numCells_;
+    const double minVal_, maxVal_;
+};
+
+enum class MeshScalingType {
+    Constant,
+    Pivot,
+    Hyperbolic,
+    Exponential
+};
+
+// Metrics along one dimension of N cells. Face f lies between cells f-1
+// and f; the boundary faces (f = 0, N) use the distance from the edge to
+// the adjacent centre, and the weight of the only cell present
+struct MeshMetrics
+{
+    AlignedVector<double> width;            // N: edge to edge
+    AlignedVector<double> invWidth;         // N
+    AlignedVector<double> centreSpacing;    // N+1: centre to centre
+    AlignedVector<double> invCentreSpacing; // N+1
+    AlignedVector<double> faceWeight;       // N+1: weight of cell f at face f
+};
+
+template<size_t meshDim>
+struct MeshGeometry
+{
+    using Ptr = std::shared_ptr<const MeshGeometry<meshDim>>;
+
+    // Empty geometry (zero cells)
+    MeshGeometry();
+    // Place edges and centres for the given dimensions
+    MeshGeometry(const MeshScalingType scaling,
+                 const std::vector<MeshDimension>& dims);
+    // Copy of g with a different cell ordering
+    MeshGeometry(const MeshGeometry<meshDim>& g, const CellOrdering ordering,
+                 const size_t tile);
+
+    // The shared geometry identical to g
+    static Ptr intern(MeshGeometry<meshDim>&& g);
+    // Shared empty geometry, used by default constructed and moved-from
+    // Meshes
+    static const Ptr& empty() noexcept;
+
+    // Same defining parameters (and so the same positions)
+    bool sameAs(const MeshGeometry<meshDim>& rhs) const;
+
+    CellOrdering ordering() const {
+        return order_ ? order_->type() : CellOrdering::Lexicographic;
+    }
+
+    // Continuous cell coordinate (0 at dimMin, dimSize at dimMax) of x
+    double cellCoordinate(const size_t d, const double x) const;
+
+    // Metrics along d, built (once, thread safely) on first use
+    const MeshMetrics& metrics(const size_t d) const;
+
+    std::vector<double> dimMin_;
+    std::vector<double> dimMax_;
+    std::vector<size_t> dimSize_;
+    size_t numCells_;
+    MeshScalingType scalingType_;
+    std::vector<double> centrePosition_[meshDim];
+    std::vector<double> edgePosition_[meshDim];
+    // Null for lexicographic storage
+    std::shared_ptr<const CellOrder<meshDim>> order_;
+    size_t hash_;
+
+private:
+    // Shared with reordered copies, whose metrics are the same
+    struct MetricCache {
+        std::once_flag once;
+        std::array<MeshMetrics, meshDim> metrics;
+    };
+    std::shared_ptr<MetricCache> metricCache_;
+
+    void placeCentres(const int d);
+    void placeEdges(const int d);
+    size_t calcNumCells() const;
+    size_t calcHash() const;
+};
+
+#endif // DATASTRUCTURES_MESHGEOMETRY_H
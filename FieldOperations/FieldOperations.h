@@ -11,6 +11,26 @@ namespace FieldOps
     enum class divergenceType {
         Type1
     };
+
+    // Face value reconstruction for advection (see Reconstruction.h)
+    enum class reconstructionType {
+        Upwind,         // First order, piecewise constant
+        MUSCLMinmod,
+        MUSCLVanLeer,
+        WENO5
+    };
+
+    // Sampling of cell centred Fields at arbitrary points (see Probes.h)
+    enum class probeType {
+        Nearest,        // Value at the closest cell centre
+        Linear          // (Bi/tri)linear between the surrounding centres
+    };
+
+    // How ghost cells beyond the ends of a line are filled
+    enum class ghostType {
+        ZeroGradient,
+        Periodic
+    };
 }
 
 #endif // FIELD_OPERATIONS_H
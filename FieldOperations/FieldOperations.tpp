@@ -1,46 +1,53 @@
+#ifndef FIELD_OPERATIONS_TPP
+#define FIELD_OPERATIONS_TPP
+
 #include "DataStructures/Field.tpp"
 #include "TemplateFunctions.H"
 #include <cstddef>
 
 #include "FieldOperations.h"
+#include "Stencil.tpp"
 
 namespace FieldOps
 {
     // Template aliases
     template<size_t mD>
-    using vectorField<mD> = Field<double, mD, mD>;
+    using vectorField = Field<double, mD, mD>;
     template<size_t mD>
-    using scalarField<mD> = Field<double, 1, mD>;
-
-    // Gradient functions
-    template<typename gType, size_t mD,
-             EnableIf<gType==gradType::CentralDifferencing>...>
-    vectorField<mD>& ddx(const vectorField<mD>& f) {
-        const Mesh& mesh = f.mesh();
-        bool constSpacing =
-                mesh.scalingType() == MeshScalingType::Constant ? true : false;
-        if (constSpacing) {
-
-        } else {
-
-        }
-        return f;
+    using scalarField = Field<double, 1, mD>;
+
+    // Stencil used by each scheme (see Stencil.tpp)
+    template<gradType g>
+    struct gradStencil;
+    template<>
+    struct gradStencil<gradType::CentralDifferencing> {
+        using type = Stencils::CentralFirst;
+    };
+    template<>
+    struct gradStencil<gradType::Upwind> {
+        using type = Stencils::BackwardFirst;
+    };
+
+    template<divergenceType t>
+    struct divStencil;
+    template<>
+    struct divStencil<divergenceType::Type1> {
+        using type = Stencils::CentralFirst;
+    };
+
+    // Gradient of a scalar Field
+    template<gradType g, size_t mD>
+    vectorField<mD>& ddx(const scalarField<mD>& f, vectorField<mD>& grad) {
+        gradient<typename gradStencil<g>::type>(f, grad);
+        return grad;
     }
 
-    template<typename gType, size_t mD,
-             EnableIf<gType==gradType::Upwind>...>
-    vectorField<mD>& ddx(const vectorField<mD>& f) {
-        const Mesh& mesh = f.mesh();
-        bool constSpacing =
-                mesh.scalingType() == MeshScalingType::Constant ? true : false;
-
-        return f;
-    }
-
-    // Divergence of a flux field functions
-    template<typename divType, size_t mD,
-             EnableIf<divType==divergenceType::Type1>...>
-    scalarField<mD>& div(const vectorField<mD>& flux) {
-
+    // Divergence of a flux Field
+    template<divergenceType t, size_t mD>
+    scalarField<mD>& div(const vectorField<mD>& flux, scalarField<mD>& out) {
+        divergence<typename divStencil<t>::type>(flux, out);
+        return out;
     }
 }
+
+#endif // FIELD_OPERATIONS_TPP
@@ -0,0 +1,332 @@
+#include "Fusion.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace FieldOps
+{
+
+namespace {
+    // Cells per tile aimed for by the default tile shape
+    constexpr size_t targetTileCells = 4096;
+    // Longest default tile extent along dimension 0
+    constexpr size_t maxTileRow = 128;
+}
+
+template<size_t mD>
+FusedSweep<mD>::FusedSweep(const MeshPtr mesh,
+                           const std::array<size_t, mD>& tile,
+                           Parallel::ThreadPool& pool):
+    mesh_(mesh),
+    pool_(&pool)
+{
+    assert(mesh_->ordering() == CellOrdering::Lexicographic);
+    for (size_t d=0; d<mD; d++) {
+        dims_[d] = mesh_->dimSizes()[d];
+    }
+
+    // Default: rows along dimension 0, then roughly square across the rest
+    size_t side = targetTileCells;
+    if (mD > 1) {
+        const size_t row = std::min(dims_[0], maxTileRow);
+        side = static_cast<size_t>(std::pow(double(targetTileCells)/row,
+                                            1.0/(mD-1)));
+    }
+    for (size_t d=0; d<mD; d++) {
+        size_t t = tile[d];
+        if (t == 0) {
+            t = (d == 0 && mD > 1) ? maxTileRow : std::max<size_t>(side, 4);
+        }
+        tile_[d] = std::min(t, dims_[d]);
+    }
+
+    for (size_t d=0; d<mD; d++) {
+        const std::vector<double>& x = mesh_->centres(d);
+        const size_t N = dims_[d];
+        invSpan_[d].resize(N);
+        for (size_t i=0; i<N; i++) {
+            const size_t lo = (i == 0 ? 0 : i-1);
+            const size_t hi = (i+1 == N ? i : i+1);
+            invSpan_[d][i] = (hi == lo) ? 0.0 : 1.0/(x[hi] - x[lo]);
+        }
+    }
+}
+
+template<size_t mD>
+typename FusedSweep<mD>::Slot
+FusedSweep<mD>::input(const std::vector<double>& values)
+{
+    assert(values.size() == mesh_->numCells());
+    return newSlot([&values]() { return values.data(); });
+}
+
+template<size_t mD>
+typename FusedSweep<mD>::Slot
+FusedSweep<mD>::derivative(const Slot s, const size_t d)
+{
+    assert(d < mD);
+    const Slot out = newSlot(nullptr);
+    Stage stage;
+    stage.in = { s };
+    stage.out = { out };
+    stage.radius = 1;
+    stage.fn = [this, s, d, out](const Tile& t, const Box& box) {
+        differentiate(t, s, d, out, box, false);
+    };
+    stages_.push_back(std::move(stage));
+    return out;
+}
+
+template<size_t mD>
+std::array<typename FusedSweep<mD>::Slot, mD>
+FusedSweep<mD>::gradient(const Slot s)
+{
+    std::array<Slot, mD> out;
+    for (size_t d=0; d<mD; d++) {
+        out[d] = derivative(s, d);
+    }
+    return out;
+}
+
+template<size_t mD>
+typename FusedSweep<mD>::Slot
+FusedSweep<mD>::divergence(const std::array<Slot, mD>& flux)
+{
+    const Slot out = newSlot(nullptr);
+    Stage stage;
+    stage.in.assign(flux.begin(), flux.end());
+    stage.out = { out };
+    stage.radius = 1;
+    stage.fn = [this, flux, out](const Tile& t, const Box& box) {
+        for (size_t d=0; d<mD; d++) {
+            differentiate(t, flux[d], d, out, box, d > 0);
+        }
+    };
+    stages_.push_back(std::move(stage));
+    return out;
+}
+
+template<size_t mD>
+void FusedSweep<mD>::output(const Slot s, std::vector<double>& dst)
+{
+    dst.resize(mesh_->numCells());
+    addOutput(s, [&dst]() { return dst.data(); });
+}
+
+template<size_t mD>
+void FusedSweep<mD>::addOutput(const Slot s, std::function<double*()> target)
+{
+    assert(s < sources_.size() && !sources_[s]);
+    outputs_.push_back({ s, std::move(target), nullptr });
+}
+
+template<size_t mD>
+void FusedSweep<mD>::run()
+{
+    computeHalos();
+    // Current buffers - outputs first, detaching any that are shared
+    for (Output& o : outputs_) {
+        o.data = o.target();
+    }
+    for (Slot s=0; s<sources_.size(); s++) {
+        inputs_[s] = sources_[s] ? sources_[s]() : nullptr;
+    }
+
+    Parallel::ThreadPool& pool = *pool_;
+    Box tileGrid;
+    for (size_t d=0; d<mD; d++) {
+        tileGrid.begin[d] = 0;
+        tileGrid.end[d] = (dims_[d] + tile_[d] - 1) / tile_[d];
+    }
+
+    // Scratch for every slot, sized for the largest tile plus its halo
+    const size_t numSlots = sources_.size();
+    if (tiles_.size() != pool.numSlots()) {
+        tiles_.assign(pool.numSlots(), Tile());
+    }
+    for (Tile& t : tiles_) {
+        t.boxes.resize(numSlots);
+        t.data.assign(numSlots, nullptr);
+        t.buffers.resize(numSlots);
+        for (Slot s=0; s<numSlots; s++) {
+            if (sources_[s]) {
+                continue;
+            }
+            size_t n = 1;
+            for (size_t d=0; d<mD; d++) {
+                n *= std::min(tile_[d] + 2*halo_[s], dims_[d]);
+            }
+            if (t.buffers[s].size() < n) {
+                t.buffers[s].resize(n);
+            }
+            t.data[s] = t.buffers[s].data();
+        }
+    }
+
+    Parallel::parallelFor(pool, tileGrid, [this, &pool](const Box& piece) {
+        Tile& t = tiles_[pool.threadIndex()];
+        forRows(piece, [&](const Cell& first) {
+            Cell c = first;
+            for (; c[0]<piece.end[0]; c[0]++) {
+                for (size_t d=0; d<mD; d++) {
+                    t.cells.begin[d] = c[d]*tile_[d];
+                    t.cells.end[d] = std::min(dims_[d], (c[d]+1)*tile_[d]);
+                }
+                runTile(t);
+            }
+        });
+    }, 1);
+}
+
+template<size_t mD>
+typename FusedSweep<mD>::Slot
+FusedSweep<mD>::newSlot(std::function<const double*()> source)
+{
+    sources_.push_back(std::move(source));
+    inputs_.push_back(nullptr);
+    halo_.push_back(0);
+    return sources_.size() - 1;
+}
+
+template<size_t mD>
+void FusedSweep<mD>::computeHalos()
+{
+    std::fill(halo_.begin(), halo_.end(), 0);
+    // Stages only read slots made before them, so one backward pass settles
+    // every halo. All outputs of a stage share the widest one.
+    for (size_t k=stages_.size(); k-->0;) {
+        const Stage& stage = stages_[k];
+        size_t h = 0;
+        for (Slot s : stage.out) {
+            h = std::max(h, halo_[s]);
+        }
+        for (Slot s : stage.out) {
+            halo_[s] = h;
+        }
+        for (Slot s : stage.in) {
+            halo_[s] = std::max(halo_[s], h + stage.radius);
+        }
+    }
+}
+
+template<size_t mD>
+typename FusedSweep<mD>::Box
+FusedSweep<mD>::grown(const Box& cells, const size_t h) const
+{
+    Box b;
+    for (size_t d=0; d<mD; d++) {
+        b.begin[d] = cells.begin[d] > h ? cells.begin[d] - h : 0;
+        b.end[d] = std::min(cells.end[d] + h, dims_[d]);
+    }
+    return b;
+}
+
+template<size_t mD>
+void FusedSweep<mD>::runTile(Tile& t) const
+{
+    for (Slot s=0; s<sources_.size(); s++) {
+        t.boxes[s] = grown(t.cells, halo_[s]);
+    }
+    for (const Stage& stage : stages_) {
+        stage.fn(t, t.boxes[stage.out[0]]);
+    }
+    const size_t n = t.cells.end[0] - t.cells.begin[0];
+    for (const Output& o : outputs_) {
+        forRows(t.cells, [&](const Cell& c) {
+            const double* src = at(t, o.slot, c);
+            size_t idx = 0;
+            for (size_t d=mD; d-->0;) {
+                idx = idx*dims_[d] + c[d];
+            }
+            std::copy(src, src + n, o.data + idx);
+        });
+    }
+}
+
+template<size_t mD>
+const double* FusedSweep<mD>::at(const Tile& t, const Slot s,
+                                 const Cell& c) const
+{
+    size_t idx = 0;
+    if (inputs_[s]) {
+        for (size_t d=mD; d-->0;) {
+            idx = idx*dims_[d] + c[d];
+        }
+        return inputs_[s] + idx;
+    }
+    return scratchAt(t, s, c);
+}
+
+template<size_t mD>
+double* FusedSweep<mD>::scratchAt(const Tile& t, const Slot s,
+                                  const Cell& c) const
+{
+    const Box& b = t.boxes[s];
+    size_t idx = 0;
+    for (size_t d=mD; d-->0;) {
+        idx = idx*(b.end[d] - b.begin[d]) + (c[d] - b.begin[d]);
+    }
+    return t.data[s] + idx;
+}
+
+template<size_t mD>
+void FusedSweep<mD>::differentiate(const Tile& t, const Slot in,
+                                   const size_t d, const Slot out,
+                                   const Box& box, const bool accumulate) const
+{
+    const size_t n = box.end[0] - box.begin[0];
+    const double* inv = invSpan_[d].data();
+    // Separate loops for = and +=, with no clamping inside them
+    auto sweep = [&](auto store) {
+        forRows(box, [&](const Cell& c) {
+            double* o = scratchAt(t, out, c);
+            if (d == 0) {
+                // q[i] is cell x0+i; the cells either side of the row are
+                // in the input's halo unless the row reaches the boundary
+                const size_t x0 = c[0];
+                const size_t last = dims_[0] - 1;
+                Cell cl = c;
+                cl[0] = x0 > 0 ? x0-1 : 0;
+                const double* q = at(t, in, cl) + (x0 - cl[0]);
+                const double* w = inv + x0;
+                const size_t iBegin = (x0 == 0 ? 1 : 0);
+                const size_t iEnd = (x0 + n - 1 == last ? n-1 : n);
+                for (size_t i=iBegin; i<iEnd; i++) {
+                    store(o[i], (q[i+1] - q[i-1])*w[i]);
+                }
+                // Boundary cells, with the missing neighbour clamped
+                if (iBegin == 1) {
+                    store(o[0], (q[std::min<size_t>(1, last)] - q[0])*w[0]);
+                }
+                if (iEnd == n-1 && n-1 >= iBegin) {
+                    const size_t i = n-1;
+                    const double* qm = (x0 + i > 0) ? q + i - 1 : q + i;
+                    store(o[i], (q[i] - *qm)*w[i]);
+                }
+            } else if constexpr (mD > 1) {
+                Cell cm = c, cp = c;
+                cm[d] = c[d] > 0 ? c[d]-1 : 0;
+                cp[d] = std::min(c[d]+1, dims_[d]-1);
+                const double* qm = at(t, in, cm);
+                const double* qp = at(t, in, cp);
+                const double w = inv[c[d]];
+                for (size_t i=0; i<n; i++) {
+                    store(o[i], (qp[i] - qm[i])*w);
+                }
+            }
+        });
+    };
+    if (accumulate) {
+        sweep([](double& o, const double v) { o += v; });
+    } else {
+        sweep([](double& o, const double v) { o = v; });
+    }
+}
+
+// Instantiate templates
+template class FusedSweep<1>;
+template class FusedSweep<2>;
+template class FusedSweep<3>;
+
+}
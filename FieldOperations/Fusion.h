@@ -0,0 +1,227 @@
+/* ---------------------------------------------------------------------------
+ * Fused sweeps: several pointwise and stencil stages evaluated tile by tile
+ * in a single pass over the Mesh.
+ *
+ * Values are referred to by Slot. Inputs are full-size Field components;
+ * every stage writes new slots which only exist in tile-local scratch, so
+ * eg div(Rho*U) reads Rho and U once and writes only the result:
+ *
+ *      FusedSweep<2> sweep(mesh);
+ *      auto rho = sweep.input(Rho);
+ *      auto u = sweep.input(U, 0), v = sweep.input(U, 1);
+ *      auto F = sweep.pointwise<2>(std::array<Slot, 3>{{ rho, u, v }},
+ *          [](const std::array<double, 3>& a, std::array<double, 2>& f) {
+ *              f[0] = a[0]*a[1];
+ *              f[1] = a[0]*a[2];
+ *          });
+ *      sweep.output(sweep.divergence(F), divRhoU);
+ *      sweep.run();
+ *
+ * A stencil stage of radius r needs its inputs on r more cells around the
+ * tile than it produces, so the halo of each slot is worked out backwards
+ * from the outputs and intermediates are recomputed on the overlap between
+ * neighbouring tiles. Tiles keep whole rows along dimension 0 where the Mesh
+ * allows, and are shared out over a thread pool (the global one by
+ * default); each thread works in a Tile of its own, picked by its
+ * threadIndex(), so sweeps run at once from several threads on one pool
+ * do not share scratch. A sweep itself is run by one thread at a time.
+ *
+ * Derivatives are central differences between the neighbouring centres,
+ *      (q[i+1] - q[i-1]) / (x[i+1] - x[i-1]),
+ * one-sided at the Mesh boundary (the missing neighbour is the cell itself).
+ *
+ * The sweep keeps references to the Fields it reads and writes; build it
+ * once and run() it every step. Their buffers are looked up at the start of
+ * each run(), so copy-on-write is respected: an output Field sharing its
+ * buffer (eg with a copy taken between runs) is detached before it is
+ * written, and inputs are read from whatever buffer they hold by then.
+ * Needs lexicographic cell ordering.
+ * --------------------------------------------------------------------------*/
+
+#ifndef FIELDOPERATIONS_FUSION_H
+#define FIELDOPERATIONS_FUSION_H
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "DataStructures/Field.tpp"
+#include "DataStructures/Mesh.h"
+#include "Parallel/ParallelRange.h"
+
+namespace FieldOps
+{
+    template<size_t mD>
+    class FusedSweep
+    {
+        using MeshPtr = std::shared_ptr<const Mesh<mD>>;
+        using Box = Parallel::Range<mD>;
+        using Cell = std::array<size_t, mD>;
+
+    public:
+        using Slot = size_t;
+
+        // A tile extent of 0 along a dimension picks a default
+        explicit FusedSweep(const MeshPtr mesh,
+                            const std::array<size_t, mD>& tile
+                                = std::array<size_t, mD>(),
+                            Parallel::ThreadPool& pool =
+                                Parallel::ThreadPool::global());
+
+        // Component d of a Field
+        template<size_t fD>
+        Slot input(const Field<double, fD, mD>& f, const size_t d = 0) {
+            assert(d < fD && f.mesh() == *mesh_);
+            return newSlot([&f, d]() { return f.component(d).data(); });
+        }
+        // A full-size array of cell values that is not Field storage
+        Slot input(const std::vector<double>& values);
+
+        // out = fn(in) cell by cell, with
+        // fn(const std::array<double, nIn>&, std::array<double, nOut>&)
+        template<size_t nOut, size_t nIn, typename Fn>
+        std::array<Slot, nOut> pointwise(const std::array<Slot, nIn>& in,
+                                         Fn fn);
+
+        // Stencil stages (radius 1)
+        Slot derivative(const Slot s, const size_t d);
+        std::array<Slot, mD> gradient(const Slot s);
+        Slot divergence(const std::array<Slot, mD>& flux);
+
+        // Write slot s into component d of f on run()
+        template<size_t fD>
+        void output(const Slot s, Field<double, fD, mD>& f,
+                    const size_t d = 0) {
+            assert(d < fD && f.mesh() == *mesh_);
+            addOutput(s, [&f, d]() { return f.component(d).data(); });
+        }
+        // Write slot s into dst (resized to the number of cells) on run()
+        void output(const Slot s, std::vector<double>& dst);
+
+        void run();
+
+        const std::array<size_t, mD>& tileSize() const { return tile_; }
+        // Cells beyond the tile on which slot s is evaluated
+        size_t halo(const Slot s) const { return halo_[s]; }
+
+    private:
+        // Per-thread working space
+        struct Tile {
+            Box cells;
+            std::vector<Box> boxes;             // Per slot
+            std::vector<double*> data;          // Per slot, null for inputs
+            std::vector<std::vector<double>> buffers;
+        };
+        struct Stage {
+            std::vector<Slot> in;
+            std::vector<Slot> out;
+            size_t radius;
+            // fn(tile, region of the outputs to fill)
+            std::function<void(const Tile&, const Box&)> fn;
+        };
+
+        struct Output {
+            Slot slot;
+            std::function<double*()> target;
+            double* data;                       // Looked up by run()
+        };
+
+        // Data members
+        MeshPtr mesh_;
+        Parallel::ThreadPool* pool_;
+        Cell dims_;
+        Cell tile_;
+        // Where each input slot's values are, empty for intermediates
+        std::vector<std::function<const double*()>> sources_;
+        // Looked up by run(), null for intermediates
+        std::vector<const double*> inputs_;
+        std::vector<size_t> halo_;
+        std::vector<Stage> stages_;
+        std::vector<Output> outputs_;
+        // 1/(x[i+1] - x[i-1]) with clamped neighbours, per dimension
+        std::array<std::vector<double>, mD> invSpan_;
+        std::vector<Tile> tiles_;
+        // End data members
+
+        Slot newSlot(std::function<const double*()> source);
+        void addOutput(const Slot s, std::function<double*()> target);
+        void computeHalos();
+        Box grown(const Box& cells, const size_t h) const;
+        void runTile(Tile& t) const;
+
+        // Value of slot s at cell c, contiguous along dimension 0
+        const double* at(const Tile& t, const Slot s, const Cell& c) const;
+        double* scratchAt(const Tile& t, const Slot s, const Cell& c) const;
+
+        // out (+)= d(in)/dx_d over box
+        void differentiate(const Tile& t, const Slot in, const size_t d,
+                           const Slot out, const Box& box,
+                           const bool accumulate) const;
+
+        // fn(c) for the first cell c of every row of box along dimension 0
+        template<typename Fn>
+        static void forRows(const Box& box, Fn fn) {
+            Cell c = box.begin;
+            while (true) {
+                fn(c);
+                size_t d = 1;
+                for (; d<mD; d++) {
+                    if (++c[d] < box.end[d]) {
+                        break;
+                    }
+                    c[d] = box.begin[d];
+                }
+                if (d >= mD) {
+                    return;
+                }
+            }
+        }
+    };
+
+    template<size_t mD>
+    template<size_t nOut, size_t nIn, typename Fn>
+    std::array<typename FusedSweep<mD>::Slot, nOut>
+    FusedSweep<mD>::pointwise(const std::array<Slot, nIn>& in, Fn fn)
+    {
+        std::array<Slot, nOut> out;
+        for (Slot& s : out) {
+            s = newSlot(nullptr);
+        }
+        Stage stage;
+        stage.in.assign(in.begin(), in.end());
+        stage.out.assign(out.begin(), out.end());
+        stage.radius = 0;
+        stage.fn = [this, in, out, fn](const Tile& t, const Box& box) {
+            const size_t n = box.end[0] - box.begin[0];
+            forRows(box, [&](const Cell& c) {
+                std::array<const double*, nIn> ip;
+                std::array<double*, nOut> op;
+                for (size_t k=0; k<nIn; k++) {
+                    ip[k] = at(t, in[k], c);
+                }
+                for (size_t k=0; k<nOut; k++) {
+                    op[k] = scratchAt(t, out[k], c);
+                }
+                std::array<double, nIn> a;
+                std::array<double, nOut> b;
+                for (size_t i=0; i<n; i++) {
+                    for (size_t k=0; k<nIn; k++) {
+                        a[k] = ip[k][i];
+                    }
+                    fn(a, b);
+                    for (size_t k=0; k<nOut; k++) {
+                        op[k][i] = b[k];
+                    }
+                }
+            });
+        };
+        stages_.push_back(std::move(stage));
+        return out;
+    }
+}
+
+#endif // FIELDOPERATIONS_FUSION_H
@@ -0,0 +1,125 @@
+/* ---------------------------------------------------------------------------
+ * Interpolation of Fields between storage locations (cell centres, faces,
+ * MAC staggered faces and nodes - see DataStructures/FieldLocation.h).
+ *
+ * Moving between locations is separable: for each component, every
+ * dimension along which the source and destination disagree is handled by
+ * one 1D pass,
+ *      centres -> edges : linear interpolation using the centre spacing,
+ *                         boundary edges take the adjacent cell value
+ *      edges -> centres : mean of the two edges (centres are midpoints)
+ * so cell -> node is mD passes, and cell <-> staggered is one pass per
+ * component.
+ *
+ * Each pass walks (outer, position along d, inner) with the inner index
+ * contiguous in memory, so the inner loop is a unit-stride sweep. The
+ * (position, outer) rows are shared out over the global thread pool.
+ * --------------------------------------------------------------------------*/
+
+#ifndef FIELDOPERATIONS_INTERPOLATION_TPP
+#define FIELDOPERATIONS_INTERPOLATION_TPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "DataStructures/Field.tpp"
+#include "Parallel/ParallelRange.h"
+
+namespace FieldOps
+{
+    namespace detail
+    {
+        // One 1D pass along d. src has extents dims, and N+1 (toEdges false)
+        // or N (toEdges true) entries along d
+        template<typename T, size_t mD>
+        void locationPass(const Mesh<mD>& mesh, const size_t d,
+                          const bool toEdges,
+                          std::array<size_t, mD>& dims,
+                          const std::vector<T>& src, std::vector<T>& dst)
+        {
+            const size_t N = mesh.dimSizes()[d];
+            const size_t nIn = dims[d];
+            const size_t nOut = toEdges ? N+1 : N;
+            size_t inner = 1, outer = 1;
+            for (size_t k=0; k<d; k++) {
+                inner *= dims[k];
+            }
+            for (size_t k=d+1; k<mD; k++) {
+                outer *= dims[k];
+            }
+            dst.resize(outer*nOut*inner);
+
+            const std::vector<double>& e = mesh.edges(d);
+            const std::vector<double>& x = mesh.centres(d);
+            auto rows = [&](const Parallel::Range<2>& r) {
+                for (size_t o=r.begin[1]; o<r.end[1]; o++) {
+                    const T* in = src.data() + o*nIn*inner;
+                    T* out = dst.data() + o*nOut*inner;
+                    for (size_t j=r.begin[0]; j<r.end[0]; j++) {
+                        T* row = out + j*inner;
+                        if (toEdges) {
+                            // Weights of the cells either side of edge j
+                            const size_t lo = (j == 0 ? 0 : j-1);
+                            const size_t hi = (j == N ? N-1 : j);
+                            const double w = (lo == hi) ? 0.0
+                                    : (e[j] - x[lo])/(x[hi] - x[lo]);
+                            const T* a = in + lo*inner;
+                            const T* b = in + hi*inner;
+                            for (size_t i=0; i<inner; i++) {
+                                row[i] = (1-w)*a[i] + w*b[i];
+                            }
+                        } else {
+                            const T* a = in + j*inner;
+                            const T* b = a + inner;
+                            for (size_t i=0; i<inner; i++) {
+                                row[i] = 0.5*(a[i] + b[i]);
+                            }
+                        }
+                    }
+                }
+            };
+            // Grain in rows of 'inner' values
+            const size_t grain =
+                std::max<size_t>(1, Parallel::defaultGrain/inner);
+            Parallel::parallelFor(Parallel::ThreadPool::global(),
+                                  Parallel::fullRange<2>({{ nOut, outer }}),
+                                  rows, grain);
+            dims[d] = nOut;
+        }
+    }
+
+    template<typename T, size_t fD, size_t mD,
+             FieldLocation from, FieldLocation to>
+    void interpolate(const Field<T, fD, mD, from>& src,
+                     Field<T, fD, mD, to>& dst)
+    {
+        assert(src.mesh() == dst.mesh());
+        assert(src.mesh().ordering() == CellOrdering::Lexicographic);
+        const Mesh<mD>& mesh = src.mesh();
+        std::vector<T> a, b;
+        for (size_t c=0; c<fD; c++) {
+            std::array<size_t, mD> dims = src.dims(c);
+            const std::vector<T>* cur = &src.component(c);
+            std::vector<T>* last = nullptr;
+            for (size_t d=0; d<mD; d++) {
+                const bool fromEdges = onEdgesAlong(from, c, d);
+                const bool toEdges = onEdgesAlong(to, c, d);
+                if (fromEdges == toEdges) {
+                    continue;
+                }
+                last = (last == &a ? &b : &a);
+                detail::locationPass(mesh, d, toEdges, dims, *cur, *last);
+                cur = last;
+            }
+            if (last) {
+                dst.component(c).swap(*last);
+            } else {
+                dst.component(c) = *cur;
+            }
+        }
+    }
+}
+
+#endif // FIELDOPERATIONS_INTERPOLATION_TPP
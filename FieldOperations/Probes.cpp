@@ -0,0 +1,58 @@
+#include "Probes.h"
+
+namespace FieldOps {
+
+template<size_t mD>
+Probes<mD>::Probes(const MeshPtr mesh, const std::vector<Point>& points,
+                   const probeType type):
+    mesh_(mesh),
+    type_(type),
+    stencil_(type == probeType::Nearest ? 1 : (size_t(1) << mD)),
+    numProbes_(0)
+{
+    move(points);
+}
+
+template<size_t mD>
+void Probes<mD>::move(const std::vector<Point>& points)
+{
+    const Mesh<mD>& mesh = *mesh_;
+    numProbes_ = points.size();
+    cells_.assign(numProbes_*stencil_, 0);
+    weights_.assign(numProbes_*stencil_, 1.0);
+
+    size_t stride = 1;
+    for (size_t d=0; d<mD; d++) {
+        const size_t N = mesh.dimSizes()[d];
+        for (size_t p=0; p<numProbes_; p++) {
+            size_t lo;
+            double w;
+            mesh.bracketCentres(d, points[p][d], lo, w);
+            size_t* idx = &cells_[p*stencil_];
+            double* wt = &weights_[p*stencil_];
+            if (type_ == probeType::Nearest) {
+                idx[0] += stride * (w < 0.5 ? lo : lo+1);
+                continue;
+            }
+            // Corner s takes the upper centre along d if bit d is set
+            for (size_t s=0; s<stencil_; s++) {
+                const bool upper = (s >> d) & 1;
+                idx[s] += stride * (upper && N > 1 ? lo+1 : lo);
+                wt[s] *= (upper ? w : 1-w);
+            }
+        }
+        stride *= N;
+    }
+    if (mesh.ordering() != CellOrdering::Lexicographic) {
+        for (size_t& c : cells_) {
+            c = mesh.storageIndex(c);
+        }
+    }
+}
+
+// Instantiate templates
+template class Probes<1>;
+template class Probes<2>;
+template class Probes<3>;
+
+}
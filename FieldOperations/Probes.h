@@ -0,0 +1,101 @@
+/* ---------------------------------------------------------------------------
+ * Probes sample cell centred Fields at a set of physical points.
+ *
+ * The stencil of every probe (cell indices and weights) is computed once,
+ * when the probes are placed or moved, using Mesh::locate. Sampling is then
+ * a single gather pass over the stencils, reading every requested component
+ * of every Field while the stencil is in cache.
+ *
+ * Linear probes use the 2^mD cell centres surrounding the point. Beyond the
+ * outermost centres the value is held constant (no extrapolation).
+ *
+ * Sampled values are stored probe-major: values[p*nComponents + c], with the
+ * components of the Fields in the order they were passed.
+ * --------------------------------------------------------------------------*/
+
+#ifndef FIELDOPERATIONS_PROBES_H
+#define FIELDOPERATIONS_PROBES_H
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "DataStructures/Field.tpp"
+#include "FieldOperations.h"
+
+namespace FieldOps
+{
+    template<size_t mD>
+    class Probes
+    {
+        using MeshPtr = std::shared_ptr<const Mesh<mD>>;
+        using Point = std::array<double, mD>;
+
+    public:
+        Probes(const MeshPtr mesh, const std::vector<Point>& points,
+               const probeType type = probeType::Linear);
+
+        // Recompute the stencils for new positions (eg moving probes)
+        void move(const std::vector<Point>& points);
+
+        size_t size() const { return numProbes_; }
+        size_t stencilSize() const { return stencil_; }
+        probeType type() const { return type_; }
+
+        // Sample a list of cell centred components
+        template<typename T>
+        void gather(const std::vector<const std::vector<T>*>& sources,
+                    std::vector<T>& values) const
+        {
+            const size_t nC = sources.size();
+            values.assign(numProbes_*nC, T());
+            for (size_t p=0; p<numProbes_; p++) {
+                const size_t* idx = &cells_[p*stencil_];
+                const double* w = &weights_[p*stencil_];
+                T* out = &values[p*nC];
+                for (size_t s=0; s<stencil_; s++) {
+                    for (size_t c=0; c<nC; c++) {
+                        out[c] += w[s] * (*sources[c])[idx[s]];
+                    }
+                }
+            }
+        }
+
+        // Sample every component of each Field in one pass
+        template<typename T, size_t... fDs>
+        void sample(std::vector<T>& values,
+                    const Field<T, fDs, mD>&... fields) const
+        {
+            std::vector<const std::vector<T>*> sources;
+            addComponents(sources, fields...);
+            gather(sources, values);
+        }
+
+    private:
+        MeshPtr mesh_;
+        probeType type_;
+        size_t stencil_;
+        size_t numProbes_;
+        // Flattened stencils, stencil_ entries per probe
+        std::vector<size_t> cells_;
+        std::vector<double> weights_;
+
+        template<typename T>
+        static void addComponents(std::vector<const std::vector<T>*>&) {}
+
+        template<typename T, size_t fD, typename... Rest>
+        static void addComponents(std::vector<const std::vector<T>*>& sources,
+                                  const Field<T, fD, mD>& f,
+                                  const Rest&... rest)
+        {
+            assert(f.numCells() > 0);
+            for (size_t c=0; c<fD; c++) {
+                sources.push_back(&f.component(c));
+            }
+            addComponents(sources, rest...);
+        }
+    };
+}
+
+#endif // FIELDOPERATIONS_PROBES_H
@@ -0,0 +1,471 @@
+#include "Reconstruction.h"
+
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+#include "Parallel/ParallelRange.h"
+
+namespace FieldOps
+{
+
+namespace {
+    constexpr double wenoEps = 1e-6;
+
+    // Coefficients c_j such that sum_j c_j vbar_j reconstructs the value at z
+    // from the averages vbar_j over the k cells bounded by X[0..k]
+    // (derivative of the interpolant of the primitive function)
+    void reconstructionCoeffs(const double* X, const size_t k, const double z,
+                              double* c) {
+        std::array<double, 8> dL;
+        for (size_t m=0; m<=k; m++) {
+            double sum = 0;
+            for (size_t l=0; l<=k; l++) {
+                if (l == m) {
+                    continue;
+                }
+                double prod = 1.0/(X[m] - X[l]);
+                for (size_t q=0; q<=k; q++) {
+                    if (q != m && q != l) {
+                        prod *= (z - X[q])/(X[m] - X[q]);
+                    }
+                }
+                sum += prod;
+            }
+            dL[m] = sum;
+        }
+        for (size_t j=0; j<k; j++) {
+            double s = 0;
+            for (size_t m=j+1; m<=k; m++) {
+                s += dL[m];
+            }
+            c[j] = s * (X[j+1] - X[j]);
+        }
+    }
+
+    inline double minmod(const double a, const double b) {
+        return 0.5*(std::copysign(1.0, a) + std::copysign(1.0, b))
+                * std::min(std::fabs(a), std::fabs(b));
+    }
+
+    inline double vanLeer(const double a, const double b) {
+        return (a*std::fabs(b) + std::fabs(a)*b)
+                / (std::fabs(a) + std::fabs(b) + 1e-300);
+    }
+
+    // WENO5 value from cells i-2..i+2 with candidate coefficients c[r*3+j]
+    // (stencil r covering cells i-r..i-r+2) and linear weights g
+    inline double weno5(const double vm2, const double vm1, const double v0,
+                        const double vp1, const double vp2,
+                        const double* c, const double* g) {
+        const double p0 = c[0]*v0 + c[1]*vp1 + c[2]*vp2;
+        const double p1 = c[3]*vm1 + c[4]*v0 + c[5]*vp1;
+        const double p2 = c[6]*vm2 + c[7]*vm1 + c[8]*v0;
+        const double t0 = v0 - 2*vp1 + vp2, s0 = 3*v0 - 4*vp1 + vp2;
+        const double t1 = vm1 - 2*v0 + vp1, s1 = vm1 - vp1;
+        const double t2 = vm2 - 2*vm1 + v0, s2 = vm2 - 4*vm1 + 3*v0;
+        const double b0 = (13.0/12.0)*t0*t0 + 0.25*s0*s0;
+        const double b1 = (13.0/12.0)*t1*t1 + 0.25*s1*s1;
+        const double b2 = (13.0/12.0)*t2*t2 + 0.25*s2*s2;
+        const double a0 = g[0]/((wenoEps + b0)*(wenoEps + b0));
+        const double a1 = g[1]/((wenoEps + b1)*(wenoEps + b1));
+        const double a2 = g[2]/((wenoEps + b2)*(wenoEps + b2));
+        return (a0*p0 + a1*p1 + a2*p2)/(a0 + a1 + a2);
+    }
+}
+
+LineReconstruction::LineReconstruction(const std::vector<double>& edges,
+                                       const std::vector<double>& centres,
+                                       const reconstructionType type,
+                                       const ghostType ghost):
+    N_(centres.size()),
+    type_(type),
+    ghost_(ghost)
+{
+    assert(edges.size() == N_+1);
+    // Extended edges, E[k] is edge k-ghosts, with ghost cell widths copied
+    // from the interior cells that supply their values
+    const long N = static_cast<long>(N_);
+    auto widthOf = [&](long c) {
+        if (ghost_ == ghostType::Periodic) {
+            c = ((c % N) + N) % N;
+        } else {
+            c = (c < 0 ? -c-1 : (c >= N ? 2*N-1-c : c));
+            c = std::max(0L, std::min(N-1, c));
+        }
+        return edges[c+1] - edges[c];
+    };
+    std::vector<double> E(N_ + 1 + 2*ghosts);
+    for (size_t j=0; j<=N_; j++) {
+        E[j+ghosts] = edges[j];
+    }
+    for (long g=1; g<=long(ghosts); g++) {
+        E[ghosts-g] = E[ghosts-g+1] - widthOf(-g);
+        E[N_+ghosts+g] = E[N_+ghosts+g-1] + widthOf(N-1+g);
+    }
+
+    faceWeight_.resize(N_+1);
+    for (size_t f=0; f<=N_; f++) {
+        const double xm = 0.5*(E[f+ghosts-1] + E[f+ghosts]);
+        const double xp = 0.5*(E[f+ghosts] + E[f+ghosts+1]);
+        faceWeight_[f] = (E[f+ghosts] - xm)/(xp - xm);
+    }
+
+    buildWENO(E);
+    buildMUSCL(E);
+}
+
+void LineReconstruction::buildWENO(const std::vector<double>& E)
+{
+    // Cells -1..N, those adjacent to at least one face
+    const size_t M = N_+2;
+    for (size_t m=0; m<9; m++) {
+        cRight_[m].resize(M);
+        cLeft_[m].resize(M);
+    }
+    for (size_t r=0; r<3; r++) {
+        gRight_[r].resize(M);
+        gLeft_[r].resize(M);
+    }
+    for (size_t k=0; k<M; k++) {
+        // Cell c = k-1 occupies E[c+ghosts], E[c+ghosts+1]
+        const size_t e0 = k - 1 + ghosts;
+        const double zR = E[e0+1];
+        const double zL = E[e0];
+        double cr[3], cl[3];
+        std::array<double, 9> right, left;
+        for (size_t r=0; r<3; r++) {
+            // Stencil r covers cells c-r..c-r+2
+            const double* X = E.data() + e0 - r;
+            reconstructionCoeffs(X, 3, zR, cr);
+            reconstructionCoeffs(X, 3, zL, cl);
+            for (size_t j=0; j<3; j++) {
+                right[r*3+j] = cr[j];
+                left[r*3+j] = cl[j];
+            }
+        }
+        // Fifth order stencil c-2..c+2; its outermost coefficients are
+        // contributed by a single candidate each
+        double bigR[5], bigL[5];
+        reconstructionCoeffs(E.data() + e0 - 2, 5, zR, bigR);
+        reconstructionCoeffs(E.data() + e0 - 2, 5, zL, bigL);
+        const double g2R = bigR[0]/right[6], g0R = bigR[4]/right[2];
+        const double g2L = bigL[0]/left[6], g0L = bigL[4]/left[2];
+        for (size_t m=0; m<9; m++) {
+            cRight_[m][k] = right[m];
+            cLeft_[m][k] = left[m];
+        }
+        gRight_[0][k] = g0R;
+        gRight_[1][k] = 1 - g0R - g2R;
+        gRight_[2][k] = g2R;
+        gLeft_[0][k] = g0L;
+        gLeft_[1][k] = 1 - g0L - g2L;
+        gLeft_[2][k] = g2L;
+    }
+}
+
+void LineReconstruction::buildMUSCL(const std::vector<double>& E)
+{
+    const size_t M = N_+2;
+    invDxM_.resize(M);
+    invDxP_.resize(M);
+    hLeft_.resize(M);
+    hRight_.resize(M);
+    auto centre = [&E](const size_t e) { return 0.5*(E[e] + E[e+1]); };
+    for (size_t k=0; k<M; k++) {
+        const size_t e0 = k - 1 + ghosts;
+        const double x = centre(e0);
+        invDxM_[k] = 1.0/(x - centre(e0-1));
+        invDxP_[k] = 1.0/(centre(e0+1) - x);
+        hLeft_[k] = x - E[e0];
+        hRight_[k] = E[e0+1] - x;
+    }
+}
+
+void LineReconstruction::fillGhosts(double* pad, const size_t lanes) const
+{
+    const long N = static_cast<long>(N_);
+    for (long g=1; g<=long(ghosts); g++) {
+        long lo = -g, hi = N-1+g;
+        if (ghost_ == ghostType::Periodic) {
+            lo = ((lo % N) + N) % N;
+            hi = hi % N;
+        } else {
+            lo = 0;
+            hi = N-1;
+        }
+        std::copy(pad + (lo+ghosts)*lanes, pad + (lo+ghosts+1)*lanes,
+                  pad + (ghosts-g)*lanes);
+        std::copy(pad + (hi+ghosts)*lanes, pad + (hi+ghosts+1)*lanes,
+                  pad + (N_+ghosts-1+g)*lanes);
+    }
+}
+
+void LineReconstruction::reconstruct(const double* pad, double* qL,
+                                     double* qR, const size_t lanes) const
+{
+    const size_t B = lanes;
+    // Row of cell c in pad
+    auto row = [pad, B](const size_t c) { return pad + (c + ghosts)*B; };
+
+    switch (type_)
+    {
+        case reconstructionType::Upwind:
+        {
+            for (size_t f=0; f<=N_; f++) {
+                std::copy(row(f-1), row(f-1)+B, qL + f*B);
+                std::copy(row(f), row(f)+B, qR + f*B);
+            }
+        }
+        break;
+
+        case reconstructionType::MUSCLMinmod:
+        case reconstructionType::MUSCLVanLeer:
+        {
+            const bool mm = (type_ == reconstructionType::MUSCLMinmod);
+            for (size_t f=0; f<=N_; f++) {
+                // Upper face of cell f-1 (coefficient index f) and lower
+                // face of cell f (index f+1)
+                const double* am = row(f-2);
+                const double* a0 = row(f-1);
+                const double* b0 = row(f);
+                const double* bp = row(f+1);
+                const double iM_a = invDxM_[f], iP_a = invDxP_[f];
+                const double iM_b = invDxM_[f+1], iP_b = invDxP_[f+1];
+                const double hR = hRight_[f], hL = hLeft_[f+1];
+                double* l = qL + f*B;
+                double* r = qR + f*B;
+                if (mm) {
+                    for (size_t b=0; b<B; b++) {
+                        const double dAB = b0[b] - a0[b];
+                        const double sa = minmod((a0[b]-am[b])*iM_a, dAB*iP_a);
+                        const double sb = minmod(dAB*iM_b, (bp[b]-b0[b])*iP_b);
+                        l[b] = a0[b] + sa*hR;
+                        r[b] = b0[b] - sb*hL;
+                    }
+                } else {
+                    for (size_t b=0; b<B; b++) {
+                        const double dAB = b0[b] - a0[b];
+                        const double sa = vanLeer((a0[b]-am[b])*iM_a, dAB*iP_a);
+                        const double sb = vanLeer(dAB*iM_b, (bp[b]-b0[b])*iP_b);
+                        l[b] = a0[b] + sa*hR;
+                        r[b] = b0[b] - sb*hL;
+                    }
+                }
+            }
+        }
+        break;
+
+        case reconstructionType::WENO5:
+        {
+            double cR[9], cL[9], gR[3], gL[3];
+            for (size_t f=0; f<=N_; f++) {
+                for (size_t m=0; m<9; m++) {
+                    cR[m] = cRight_[m][f];
+                    cL[m] = cLeft_[m][f+1];
+                }
+                for (size_t r=0; r<3; r++) {
+                    gR[r] = gRight_[r][f];
+                    gL[r] = gLeft_[r][f+1];
+                }
+                // Cells f-3..f+2
+                const double* v[6] = { row(f-3), row(f-2), row(f-1),
+                                       row(f), row(f+1), row(f+2) };
+                double* l = qL + f*B;
+                double* r = qR + f*B;
+                for (size_t b=0; b<B; b++) {
+                    l[b] = weno5(v[0][b], v[1][b], v[2][b], v[3][b], v[4][b],
+                                 cR, gR);
+                    r[b] = weno5(v[1][b], v[2][b], v[3][b], v[4][b], v[5][b],
+                                 cL, gL);
+                }
+            }
+        }
+        break;
+    }
+}
+
+void LineReconstruction::interpolate(const double* pad, double* qF,
+                                     const size_t lanes) const
+{
+    const size_t B = lanes;
+    for (size_t f=0; f<=N_; f++) {
+        const double* a = pad + (f + ghosts - 1)*B;
+        const double* b = pad + (f + ghosts)*B;
+        const double w = faceWeight_[f];
+        double* out = qF + f*B;
+        for (size_t l=0; l<B; l++) {
+            out[l] = (1-w)*a[l] + w*b[l];
+        }
+    }
+}
+
+
+template<size_t mD>
+Reconstructor<mD>::Reconstructor(const MeshPtr mesh, const size_t dim,
+                                 const reconstructionType type,
+                                 const ghostType ghost,
+                                 Parallel::ThreadPool& pool):
+    mesh_(mesh),
+    dim_(dim),
+    N_(mesh->dimSizes()[dim]),
+    stride_(1),
+    pool_(&pool),
+    line_(mesh->edges(dim), mesh->centres(dim), type, ghost)
+{
+    assert(mesh_->ordering() == CellOrdering::Lexicographic);
+    for (size_t d=0; d<dim_; d++) {
+        stride_ *= mesh_->dimSizes()[d];
+    }
+}
+
+template<size_t mD>
+template<typename Fn>
+void Reconstructor<mD>::forEachBatch(const std::vector<double>& cells,
+                                     Fn&& fn) const
+{
+    assert(cells.size() == mesh_->numCells());
+    const size_t g = LineReconstruction::ghosts;
+    const size_t numLines = cells.size() / N_;
+    const size_t numOuter = numLines / stride_;
+    const bool alongX = (stride_ == 1);
+    const size_t blocksPerOuter = (stride_ + lineBatch - 1) / lineBatch;
+    const size_t numUnits = alongX ? (numLines + lineBatch - 1) / lineBatch
+                                   : numOuter * blocksPerOuter;
+    // Position of lane b, row j: base + b*laneStep + j*rowStride
+    const size_t cellLaneStep = alongX ? N_ : 1;
+    const size_t faceLaneStep = alongX ? N_+1 : 1;
+    const size_t rowStride = alongX ? 1 : stride_;
+
+    const size_t padSize = (N_ + 2*g)*lineBatch;
+    std::vector<double> scratch(pool_->numSlots()*padSize);
+    // Units per piece, so that a piece holds about defaultGrain cells
+    const size_t grain = std::max<size_t>(1,
+        Parallel::defaultGrain/(N_*lineBatch));
+
+    Parallel::parallelFor(*pool_, 0, numUnits,
+        [&](const size_t begin, const size_t end) {
+        const size_t t = pool_->threadIndex();
+        double* pad = scratch.data() + t*padSize;
+        for (size_t u=begin; u<end; u++) {
+            size_t cellBase, faceBase, nb;
+            if (alongX) {
+                const size_t l0 = u*lineBatch;
+                nb = std::min(lineBatch, numLines - l0);
+                cellBase = l0*N_;
+                faceBase = l0*(N_+1);
+            } else {
+                const size_t outer = u / blocksPerOuter;
+                const size_t i0 = (u % blocksPerOuter)*lineBatch;
+                nb = std::min(lineBatch, stride_ - i0);
+                cellBase = outer*N_*stride_ + i0;
+                faceBase = outer*(N_+1)*stride_ + i0;
+            }
+            for (size_t j=0; j<N_; j++) {
+                double* r = pad + (j+g)*nb;
+                const double* c = cells.data() + cellBase + j*rowStride;
+                for (size_t b=0; b<nb; b++) {
+                    r[b] = c[b*cellLaneStep];
+                }
+            }
+            line_.fillGhosts(pad, nb);
+            // fn computes face rows into its buffers, then this scatters them
+            fn(pad, nb, t, [&](const double* faceRows, std::vector<double>& out) {
+                for (size_t f=0; f<=N_; f++) {
+                    double* o = out.data() + faceBase + f*rowStride;
+                    const double* in = faceRows + f*nb;
+                    for (size_t b=0; b<nb; b++) {
+                        o[b*faceLaneStep] = in[b];
+                    }
+                }
+            });
+        }
+    }, grain);
+}
+
+template<size_t mD>
+void Reconstructor<mD>::faces(const std::vector<double>& cells,
+                              std::vector<double>& qL,
+                              std::vector<double>& qR) const
+{
+    const size_t nF = numFaces(*mesh_, dim_);
+    qL.resize(nF);
+    qR.resize(nF);
+    const size_t rows = (N_+1)*lineBatch;
+    std::vector<double> buf(2*rows*pool_->numSlots());
+    forEachBatch(cells, [&](const double* pad, const size_t nb, const size_t t,
+                            auto&& scatter) {
+        double* l = buf.data() + 2*rows*t;
+        double* r = l + rows;
+        line_.reconstruct(pad, l, r, nb);
+        scatter(l, qL);
+        scatter(r, qR);
+    });
+}
+
+template<size_t mD>
+void Reconstructor<mD>::interpolate(const std::vector<double>& cells,
+                                    std::vector<double>& qF) const
+{
+    qF.resize(numFaces(*mesh_, dim_));
+    const size_t rows = (N_+1)*lineBatch;
+    std::vector<double> buf(rows*pool_->numSlots());
+    forEachBatch(cells, [&](const double* pad, const size_t nb, const size_t t,
+                            auto&& scatter) {
+        double* f = buf.data() + rows*t;
+        line_.interpolate(pad, f, nb);
+        scatter(f, qF);
+    });
+}
+
+
+template<size_t mD>
+AdvectionOperator<mD>::AdvectionOperator(const MeshPtr mesh,
+                                         const reconstructionType type,
+                                         const ghostType ghost,
+                                         Parallel::ThreadPool& pool):
+    mesh_(mesh)
+{
+    for (size_t d=0; d<mD; d++) {
+        recon_.emplace_back(new Reconstructor<mD>(mesh, d, type, ghost, pool));
+    }
+}
+
+template<size_t mD>
+void AdvectionOperator<mD>::apply(const scalarField& q, const vectorField& U,
+                                  scalarField& dqdt) const
+{
+    assert(q.mesh() == *mesh_ && U.mesh() == *mesh_ && dqdt.mesh() == *mesh_);
+    std::vector<double>& out = dqdt.x();
+    std::fill(out.begin(), out.end(), 0.0);
+    std::vector<double> qL, qR, flux;
+    size_t stride = 1;
+    for (size_t d=0; d<mD; d++) {
+        const size_t N = mesh_->dimSizes()[d];
+        const double* invW = mesh_->metrics(d).invWidth.data();
+        recon_[d]->faces(q.x(), qL, qR);
+        recon_[d]->interpolate(U.component(d), flux);
+        for (size_t f=0; f<flux.size(); f++) {
+            const double u = flux[f];
+            flux[f] = std::max(u, 0.0)*qL[f] + std::min(u, 0.0)*qR[f];
+        }
+        for (size_t c=0; c<out.size(); c++) {
+            const size_t inner = c % stride;
+            const size_t i = (c / stride) % N;
+            const size_t outer = c / (stride*N);
+            const size_t f = outer*(N+1)*stride + i*stride + inner;
+            out[c] -= (flux[f+stride] - flux[f])*invW[i];
+        }
+        stride *= N;
+    }
+}
+
+// Instantiate templates
+template class Reconstructor<1>;
+template class Reconstructor<2>;
+template class Reconstructor<3>;
+template class AdvectionOperator<1>;
+template class AdvectionOperator<2>;
+template class AdvectionOperator<3>;
+
+}
@@ -0,0 +1,604 @@
+/* ---------------------------------------------------------------------------
+ * Compile-time stencil descriptions and the kernels generated from them.
+ *
+ * A 1D finite difference stencil is just its derivative order and tap
+ * offsets:
+ *      using CentralFirst  = Stencil<1, -1, 1>;
+ *      using CentralSecond = Stencil<2, -1, 0, 1>;
+ * The unit-spacing coefficients are computed at compile time (Fornberg's
+ * algorithm), so a new scheme is one line.
+ *
+ * StencilOperator<S, mD> applies S along any dimension of a Mesh. The
+ * coefficients come from a provider per dimension:
+ *      Constant meshes : the compile-time coefficients times h^-order
+ *      otherwise       : Fornberg weights per position along the dimension,
+ *                        from the actual centre positions
+ * Values beyond the boundary are reflections of the interior (zero
+ * gradient), at mirrored positions, so boundary cells use the same
+ * weights formula. Interior cells take a path with the taps unrolled and
+ * no index checks; the inner loop runs along dimension 0 for d == 0 and
+ * across the contiguous lower dimensions otherwise, so it vectorises.
+ *
+ * gradient, divergence and laplacian build on StencilOperator for any mD,
+ * for Fields and for EnsembleFields (all members in one sweep - the only
+ * FieldOps kernels with an ensemble path, see EnsembleField.tpp). The
+ * MappedField overloads stream the Mesh in slabs of planes along the last
+ * dimension: while a slab is computed the next one (plus the stencil's
+ * reach) is prefetched, and the planes no longer needed are released, so
+ * the resident set stays a few slabs however big the MappedFields are.
+ * These three are the only out-of-core kernels (see MappedField.tpp).
+ * The Field overloads take an optional ActiveCells to evaluate only the
+ * active cells, leaving the rest of the output untouched. Needs
+ * lexicographic cell ordering.
+ * --------------------------------------------------------------------------*/
+
+#ifndef FIELDOPERATIONS_STENCIL_TPP
+#define FIELDOPERATIONS_STENCIL_TPP
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "DataStructures/EnsembleField.tpp"
+#include "DataStructures/Field.tpp"
+#include "DataStructures/MappedField.tpp"
+#include "Parallel/ParallelRange.h"
+
+namespace FieldOps
+{
+    namespace detail
+    {
+        // Weights of the order m derivative at x0 from values at x[0..n)
+        // (Fornberg 1988). Usable at compile time.
+        template<size_t n, size_t m>
+        constexpr std::array<double, n> fornberg(const std::array<double, n>& x,
+                                                 const double x0)
+        {
+            std::array<std::array<double, m+1>, n> C{};
+            double c1 = 1;
+            double c4 = x[0] - x0;
+            C[0][0] = 1;
+            for (size_t i=1; i<n; i++) {
+                const size_t mn = (i < m ? i : m);
+                double c2 = 1;
+                const double c5 = c4;
+                c4 = x[i] - x0;
+                for (size_t j=0; j<i; j++) {
+                    const double c3 = x[i] - x[j];
+                    c2 *= c3;
+                    if (j == i-1) {
+                        for (size_t k=mn; k>0; k--) {
+                            C[i][k] = c1*(k*C[i-1][k-1] - c5*C[i-1][k])/c2;
+                        }
+                        C[i][0] = -c1*c5*C[i-1][0]/c2;
+                    }
+                    for (size_t k=mn; k>0; k--) {
+                        C[j][k] = (c4*C[j][k] - k*C[j][k-1])/c3;
+                    }
+                    C[j][0] = c4*C[j][0]/c3;
+                }
+                c1 = c2;
+            }
+            std::array<double, n> w{};
+            for (size_t k=0; k<n; k++) {
+                w[k] = C[k][m];
+            }
+            return w;
+        }
+
+        constexpr int absInt(const int i) { return i < 0 ? -i : i; }
+
+        // Cells per slab aimed for by the default slab of MappedField
+        // kernels (32MB of doubles per array)
+        constexpr size_t targetSlabCells = size_t(1) << 22;
+
+        // fn(p0, p1) for slabs of planes along the last dimension, with
+        // the prefetching and releasing of in and out around each (see
+        // above). fn reads in up to 'reach' planes beyond its slab.
+        template<typename In, typename Out, typename Fn>
+        void streamSlabs(const In& in, const Out& out, const size_t reach,
+                         size_t slabPlanes, Fn fn)
+        {
+            const auto& dims = in.mesh().dimSizes();
+            const size_t nPlanes = dims.back();
+            const size_t planeCells = nPlanes ? in.numCells()/nPlanes : 0;
+            if (slabPlanes == 0) {
+                slabPlanes = std::max<size_t>(
+                    1, targetSlabCells/std::max<size_t>(1, planeCells));
+            }
+            auto cells = [planeCells, nPlanes](const size_t p) {
+                return std::min(p, nPlanes)*planeCells;
+            };
+            // Input planes are requested up to 'fetched', released below
+            // 'released'
+            size_t fetched = std::min(slabPlanes + reach, nPlanes);
+            size_t released = 0;
+            in.prefetch(0, cells(fetched));
+            out.prefetch(0, cells(slabPlanes));
+            for (size_t p0=0; p0<nPlanes; p0+=slabPlanes) {
+                const size_t p1 = std::min(p0 + slabPlanes, nPlanes);
+                const size_t next = std::min(p1 + slabPlanes + reach, nPlanes);
+                if (next > fetched) {
+                    in.prefetch(cells(fetched), cells(next));
+                    fetched = next;
+                }
+                out.prefetch(cells(p1), cells(p1 + slabPlanes));
+                fn(p0, p1);
+                out.release(cells(p0), cells(p1));
+                const size_t keep = p1 > reach ? p1 - reach : 0;
+                if (keep > released) {
+                    in.release(cells(released), cells(keep));
+                    released = keep;
+                }
+            }
+        }
+
+        // Index of the cell holding the value of (possibly ghost) cell j on
+        // a line of N cells, reflecting across the ends
+        inline size_t reflect(long j, const long N) {
+            while (j < 0 || j >= N) {
+                j = (j < 0) ? -j-1 : 2*N-j-1;
+            }
+            return static_cast<size_t>(j);
+        }
+
+        // Position of (possibly ghost) cell j, mirrored across the edges
+        inline double reflectedPosition(const long j,
+                                        const std::vector<double>& x,
+                                        const std::vector<double>& e) {
+            const long N = static_cast<long>(x.size());
+            if (j < 0) {
+                return 2*e.front() - reflectedPosition(-j-1, x, e);
+            }
+            if (j >= N) {
+                return 2*e.back() - reflectedPosition(2*N-j-1, x, e);
+            }
+            return x[j];
+        }
+    }
+
+    // Derivative of order 'deriv' from values at the given cell offsets
+    template<size_t deriv, int... offs>
+    struct Stencil
+    {
+        static constexpr size_t order = deriv;
+        static constexpr size_t size = sizeof...(offs);
+        static constexpr std::array<int, size> offsets {{ offs... }};
+        // Coefficients for unit spacing
+        static constexpr std::array<double, size> coeffs =
+            detail::fornberg<size, deriv>({{ double(offs)... }}, 0.0);
+        // Furthest tap from the centre
+        static constexpr int reach = std::max({ detail::absInt(offs)... });
+
+        static_assert(size > deriv, "Too few taps for the derivative order");
+    };
+
+    namespace Stencils
+    {
+        using CentralFirst = Stencil<1, -1, 1>;
+        using BackwardFirst = Stencil<1, -1, 0>;
+        using ForwardFirst = Stencil<1, 0, 1>;
+        using CentralFirst4 = Stencil<1, -2, -1, 1, 2>;
+        using CentralSecond = Stencil<2, -1, 0, 1>;
+        using CentralSecond4 = Stencil<2, -2, -1, 0, 1, 2>;
+    }
+
+    template<typename S, size_t mD>
+    class StencilOperator
+    {
+        using MeshPtr = std::shared_ptr<const Mesh<mD>>;
+        static constexpr size_t nTaps = S::size;
+
+    public:
+        explicit StencilOperator(const MeshPtr mesh):
+            mesh_(mesh)
+        {
+            assert(mesh_->ordering() == CellOrdering::Lexicographic);
+            const bool uniform =
+                mesh_->scalingType() == MeshScalingType::Constant;
+            for (size_t d=0; d<mD; d++) {
+                const std::vector<double>& x = mesh_->centres(d);
+                const std::vector<double>& e = mesh_->edges(d);
+                const long N = static_cast<long>(x.size());
+                if (uniform) {
+                    double scale = 1;
+                    for (size_t k=0; k<S::order; k++) {
+                        scale *= (N > 0 ? N/(e.back() - e.front()) : 0.0);
+                    }
+                    scale_[d] = scale;
+                    continue;
+                }
+                weights_[d].resize(N*nTaps);
+                for (long i=0; i<N; i++) {
+                    std::array<double, nTaps> pos;
+                    for (size_t k=0; k<nTaps; k++) {
+                        pos[k] = detail::reflectedPosition(
+                                     i + S::offsets[k], x, e);
+                    }
+                    const std::array<double, nTaps> w =
+                        detail::fornberg<nTaps, S::order>(pos, x[i]);
+                    std::copy(w.begin(), w.end(),
+                              weights_[d].begin() + i*nTaps);
+                }
+            }
+        }
+
+        // out (+)= the stencil applied to in along dimension d. With
+        // members > 1, in holds that many values per cell, interleaved
+        // (see EnsembleField.tpp), and each cell's weights serve them all.
+        void apply(const size_t d, const std::vector<double>& in,
+                   std::vector<double>& out, const bool accumulate,
+                   const size_t members = 1) const {
+            assert(d < mD);
+            assert(in.size() == mesh_->numCells()*members);
+            out.resize(in.size());
+            apply(d, in.data(), out.data(), accumulate, 0,
+                  mesh_->dimSizes()[mD-1], members);
+        }
+
+        // Same on raw arrays of numCells()*members values, for the cells
+        // of planes [planeBegin, planeEnd) along the last dimension only.
+        // in is read up to S::reach planes beyond them.
+        void apply(const size_t d, const double* in, double* out,
+                   const bool accumulate, const size_t planeBegin,
+                   const size_t planeEnd, const size_t members = 1) const {
+            assert(d < mD);
+            assert(planeBegin <= planeEnd
+                   && planeEnd <= mesh_->dimSizes()[mD-1]);
+            if (weights_[d].empty()) {
+                sweep(d, in, out, accumulate, members, planeBegin, planeEnd,
+                      [this, d](size_t) {
+                          return UniformWeights{ scale_[d] };
+                      });
+            } else {
+                const double* w = weights_[d].data();
+                sweep(d, in, out, accumulate, members, planeBegin, planeEnd,
+                      [w](const size_t i) {
+                          return MeshWeights{ w + i*nTaps };
+                      });
+            }
+        }
+
+        // Same, on the active cells only
+        void apply(const size_t d, const std::vector<double>& in,
+                   std::vector<double>& out, const bool accumulate,
+                   const ActiveCells<mD>& active) const {
+            assert(d < mD);
+            assert(in.size() == mesh_->numCells());
+            assert(active.mesh() == *mesh_);
+            out.resize(in.size());
+            if (weights_[d].empty()) {
+                sweepActive(d, in, out, accumulate, active, [this, d](size_t) {
+                    return UniformWeights{ scale_[d] };
+                });
+            } else {
+                const double* w = weights_[d].data();
+                sweepActive(d, in, out, accumulate, active,
+                            [w](const size_t i) {
+                    return MeshWeights{ w + i*nTaps };
+                });
+            }
+        }
+
+    private:
+        // Coefficient providers: weight of tap K at the current position
+        struct UniformWeights {
+            double scale;
+            template<size_t K>
+            double get() const { return scale*S::coeffs[K]; }
+        };
+        struct MeshWeights {
+            const double* w;
+            template<size_t K>
+            double get() const { return w[K]; }
+        };
+
+        MeshPtr mesh_;
+        std::array<double, mD> scale_{};
+        std::array<std::vector<double>, mD> weights_;
+
+        // Unrolled sum over the taps, p[offset*stride] for each
+        template<typename W, size_t... K>
+        static double taps(const W& w, const double* p, const long stride,
+                           std::index_sequence<K...>) {
+            return ((w.template get<K>()*p[S::offsets[K]*stride]) + ...);
+        }
+        // Same with reflected indices, for cells near the boundary
+        template<typename W, size_t... K>
+        static double reflectedTaps(const W& w, const double* line,
+                                    const long i, const long N,
+                                    const size_t stride,
+                                    std::index_sequence<K...>) {
+            return ((w.template get<K>()
+                     *line[detail::reflect(i + S::offsets[K], N)*stride])
+                    + ...);
+        }
+
+        // Planes [planeBegin, planeEnd) along the last dimension, over a
+        // 2D range of (position along d, line) so that every dimension
+        // shares out over the pool
+        template<typename Provider>
+        void sweep(const size_t d, const double* in, double* out,
+                   const bool accumulate, const size_t members,
+                   const size_t planeBegin, const size_t planeEnd,
+                   Provider weightsAt) const {
+            const std::vector<size_t>& dims = mesh_->dimSizes();
+            const long N = static_cast<long>(dims[d]);
+            size_t inner = members, outer = 1;
+            for (size_t k=0; k<d; k++) {
+                inner *= dims[k];
+            }
+            for (size_t k=d+1; k<mD; k++) {
+                outer *= dims[k];
+            }
+            Parallel::Range<2> r;
+            if (d + 1 == mD) {
+                r.begin = {{ planeBegin, 0 }};
+                r.end = {{ planeEnd, 1 }};
+            } else {
+                const size_t perPlane = outer / dims[mD-1];
+                r.begin = {{ 0, planeBegin*perPlane }};
+                r.end = {{ dims[d], planeEnd*perPlane }};
+            }
+            const long lo = std::min<long>(S::reach, N);
+            const long hi = std::max<long>(lo, N - S::reach);
+            const auto seq = std::make_index_sequence<nTaps>{};
+            auto store = [accumulate](double& o, const double v) {
+                o = accumulate ? o + v : v;
+            };
+
+            auto piece = [&](const Parallel::Range<2>& p) {
+                const long iBegin = static_cast<long>(p.begin[0]);
+                const long iEnd = static_cast<long>(p.end[0]);
+                for (size_t o=p.begin[1]; o<p.end[1]; o++) {
+                    const double* src = in + o*N*inner;
+                    double* dst = out + o*N*inner;
+                    for (long i=iBegin; i<iEnd; i++) {
+                        const auto w = weightsAt(i);
+                        const bool interior = (i >= lo && i < hi);
+                        const double* q0 = src + i*inner;
+                        double* q = dst + i*inner;
+                        if (!interior) {
+                            for (size_t j=0; j<inner; j++) {
+                                store(q[j], reflectedTaps(w, src + j, i, N,
+                                                          inner, seq));
+                            }
+                        } else if (inner == 1 && !accumulate) {
+                            // Along dimension 0 - run along the line
+                            // instead, with the weights fetched per cell
+                            const long stop = std::min(hi, iEnd);
+                            for (long ii=i; ii<stop; ii++) {
+                                dst[ii] = taps(weightsAt(ii), src + ii, 1,
+                                               seq);
+                            }
+                            i = stop - 1;
+                        } else if (inner == 1) {
+                            const long stop = std::min(hi, iEnd);
+                            for (long ii=i; ii<stop; ii++) {
+                                dst[ii] += taps(weightsAt(ii), src + ii, 1,
+                                                seq);
+                            }
+                            i = stop - 1;
+                        } else if (accumulate) {
+                            for (size_t j=0; j<inner; j++) {
+                                q[j] += taps(w, q0 + j, inner, seq);
+                            }
+                        } else {
+                            for (size_t j=0; j<inner; j++) {
+                                q[j] = taps(w, q0 + j, inner, seq);
+                            }
+                        }
+                    }
+                }
+            };
+            // Grain in (position, line) pairs of inner values each
+            const size_t grain = std::max<size_t>(
+                1, Parallel::defaultGrain/inner);
+            Parallel::parallelFor(Parallel::ThreadPool::global(), r, piece,
+                                  grain);
+        }
+
+        // Cells in runs of the active set; the position along d is stepped
+        // rather than divided out for every cell
+        template<typename Provider>
+        void sweepActive(const size_t d, const std::vector<double>& in,
+                         std::vector<double>& out, const bool accumulate,
+                         const ActiveCells<mD>& active,
+                         Provider weightsAt) const {
+            const std::vector<size_t>& dims = mesh_->dimSizes();
+            const long N = static_cast<long>(dims[d]);
+            size_t inner = 1;
+            for (size_t k=0; k<d; k++) {
+                inner *= dims[k];
+            }
+            const long lo = std::min<long>(S::reach, N);
+            const long hi = std::max<long>(lo, N - S::reach);
+            const auto seq = std::make_index_sequence<nTaps>{};
+            const double* src = in.data();
+            double* dst = out.data();
+
+            active.forRuns([&](const size_t begin, const size_t end) {
+                size_t j = begin % inner;
+                long i = static_cast<long>((begin / inner) % N);
+                for (size_t c=begin; c<end; c++) {
+                    const auto w = weightsAt(i);
+                    const double v = (i >= lo && i < hi)
+                        ? taps(w, src + c, inner, seq)
+                        : reflectedTaps(w, src + c - i*inner, i, N, inner,
+                                        seq);
+                    dst[c] = accumulate ? dst[c] + v : v;
+                    if (++j == inner) {
+                        j = 0;
+                        if (++i == N) {
+                            i = 0;
+                        }
+                    }
+                }
+            });
+        }
+    };
+
+    // grad = (dS/dx_0, ..., dS/dx_mD-1) of a scalar Field
+    template<typename S, size_t mD>
+    void gradient(const Field<double, 1, mD>& f, Field<double, mD, mD>& grad)
+    {
+        assert(f.mesh() == grad.mesh());
+        const StencilOperator<S, mD> op(f.meshPtr());
+        for (size_t d=0; d<mD; d++) {
+            op.apply(d, f.x(), grad.component(d), false);
+        }
+    }
+
+    // Sum over d of the stencil along d applied to component d
+    template<typename S, size_t mD>
+    void divergence(const Field<double, mD, mD>& f, Field<double, 1, mD>& div)
+    {
+        assert(f.mesh() == div.mesh());
+        const StencilOperator<S, mD> op(f.meshPtr());
+        for (size_t d=0; d<mD; d++) {
+            op.apply(d, f.component(d), div.x(), d > 0);
+        }
+    }
+
+    template<typename S, size_t mD>
+    void gradient(const Field<double, 1, mD>& f, Field<double, mD, mD>& grad,
+                  const ActiveCells<mD>& active)
+    {
+        assert(f.mesh() == grad.mesh());
+        const StencilOperator<S, mD> op(f.meshPtr());
+        for (size_t d=0; d<mD; d++) {
+            op.apply(d, f.x(), grad.component(d), false, active);
+        }
+    }
+
+    template<typename S, size_t mD>
+    void divergence(const Field<double, mD, mD>& f, Field<double, 1, mD>& div,
+                    const ActiveCells<mD>& active)
+    {
+        assert(f.mesh() == div.mesh());
+        const StencilOperator<S, mD> op(f.meshPtr());
+        for (size_t d=0; d<mD; d++) {
+            op.apply(d, f.component(d), div.x(), d > 0, active);
+        }
+    }
+
+    // The same for every member of an ensemble at once
+    template<typename S, size_t mD>
+    void gradient(const EnsembleField<double, 1, mD>& f,
+                  EnsembleField<double, mD, mD>& grad)
+    {
+        assert(f.mesh() == grad.mesh());
+        assert(f.numMembers() == grad.numMembers());
+        const StencilOperator<S, mD> op(f.meshPtr());
+        for (size_t d=0; d<mD; d++) {
+            op.apply(d, f.component(0), grad.component(d), false,
+                     f.numMembers());
+        }
+    }
+
+    template<typename S, size_t mD>
+    void divergence(const EnsembleField<double, mD, mD>& f,
+                    EnsembleField<double, 1, mD>& div)
+    {
+        assert(f.mesh() == div.mesh());
+        assert(f.numMembers() == div.numMembers());
+        const StencilOperator<S, mD> op(f.meshPtr());
+        for (size_t d=0; d<mD; d++) {
+            op.apply(d, f.component(d), div.component(0), d > 0,
+                     f.numMembers());
+        }
+    }
+
+    // Sum over d of a second derivative stencil along d
+    template<typename S, size_t mD>
+    void laplacian(const Field<double, 1, mD>& f, Field<double, 1, mD>& lap)
+    {
+        static_assert(S::order == 2, "Laplacian needs a second derivative");
+        assert(f.mesh() == lap.mesh() && &f != &lap);
+        const StencilOperator<S, mD> op(f.meshPtr());
+        for (size_t d=0; d<mD; d++) {
+            op.apply(d, f.x(), lap.x(), d > 0);
+        }
+    }
+
+    template<typename S, size_t mD>
+    void laplacian(const Field<double, 1, mD>& f, Field<double, 1, mD>& lap,
+                   const ActiveCells<mD>& active)
+    {
+        static_assert(S::order == 2, "Laplacian needs a second derivative");
+        assert(f.mesh() == lap.mesh() && &f != &lap);
+        const StencilOperator<S, mD> op(f.meshPtr());
+        for (size_t d=0; d<mD; d++) {
+            op.apply(d, f.x(), lap.x(), d > 0, active);
+        }
+    }
+
+    template<typename S, size_t mD>
+    void laplacian(const EnsembleField<double, 1, mD>& f,
+                   EnsembleField<double, 1, mD>& lap)
+    {
+        static_assert(S::order == 2, "Laplacian needs a second derivative");
+        assert(f.mesh() == lap.mesh() && &f != &lap);
+        assert(f.numMembers() == lap.numMembers());
+        const StencilOperator<S, mD> op(f.meshPtr());
+        for (size_t d=0; d<mD; d++) {
+            op.apply(d, f.component(0), lap.component(0), d > 0,
+                     f.numMembers());
+        }
+    }
+
+    // Out of core, slab by slab. slabPlanes == 0 picks a default.
+    template<typename S, size_t mD>
+    void gradient(const MappedField<double, 1, mD>& f,
+                  MappedField<double, mD, mD>& grad,
+                  const size_t slabPlanes = 0)
+    {
+        assert(f.mesh() == grad.mesh());
+        const StencilOperator<S, mD> op(f.meshPtr());
+        detail::streamSlabs(f, grad, S::reach, slabPlanes,
+            [&](const size_t p0, const size_t p1) {
+                for (size_t d=0; d<mD; d++) {
+                    op.apply(d, f.component(0), grad.component(d), false,
+                             p0, p1);
+                }
+            });
+    }
+
+    template<typename S, size_t mD>
+    void divergence(const MappedField<double, mD, mD>& f,
+                    MappedField<double, 1, mD>& div,
+                    const size_t slabPlanes = 0)
+    {
+        assert(f.mesh() == div.mesh());
+        const StencilOperator<S, mD> op(f.meshPtr());
+        detail::streamSlabs(f, div, S::reach, slabPlanes,
+            [&](const size_t p0, const size_t p1) {
+                for (size_t d=0; d<mD; d++) {
+                    op.apply(d, f.component(d), div.component(0), d > 0,
+                             p0, p1);
+                }
+            });
+    }
+
+    template<typename S, size_t mD>
+    void laplacian(const MappedField<double, 1, mD>& f,
+                   MappedField<double, 1, mD>& lap,
+                   const size_t slabPlanes = 0)
+    {
+        static_assert(S::order == 2, "Laplacian needs a second derivative");
+        assert(f.mesh() == lap.mesh() && &f != &lap);
+        const StencilOperator<S, mD> op(f.meshPtr());
+        detail::streamSlabs(f, lap, S::reach, slabPlanes,
+            [&](const size_t p0, const size_t p1) {
+                for (size_t d=0; d<mD; d++) {
+                    op.apply(d, f.component(0), lap.component(0), d > 0,
+                             p0, p1);
+                }
+            });
+    }
+}
+
+#endif // FIELDOPERATIONS_STENCIL_TPP
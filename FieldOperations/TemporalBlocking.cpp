@@ -0,0 +1,75 @@
+#include "TemporalBlocking.h"
+
+#include <cmath>
+
+namespace FieldOps
+{
+
+namespace {
+    // Cells per tile aimed for by the default tile shape
+    constexpr size_t targetTileCells = 4096;
+}
+
+template<size_t mD>
+TemporalBlocking<mD>::TemporalBlocking(const MeshPtr mesh,
+                                       const size_t stepsPerBlock,
+                                       const std::array<size_t, mD>& tile,
+                                       Parallel::ThreadPool& pool):
+    mesh_(mesh),
+    pool_(&pool),
+    stepsPerBlock_(std::max<size_t>(1, stepsPerBlock))
+{
+    assert(mesh_->ordering() == CellOrdering::Lexicographic);
+    // Default: roughly square tiles, so the halo overhead is smallest
+    const size_t side = static_cast<size_t>(
+        std::pow(double(targetTileCells), 1.0/mD));
+    for (size_t d=0; d<mD; d++) {
+        dims_[d] = mesh_->dimSizes()[d];
+        const size_t t = (tile[d] == 0 ? side : tile[d]);
+        tile_[d] = std::min(t, dims_[d]);
+    }
+}
+
+template<size_t mD>
+typename TemporalBlocking<mD>::Box
+TemporalBlocking<mD>::grown(const Box& cells, const size_t h) const
+{
+    Box b;
+    for (size_t d=0; d<mD; d++) {
+        b.begin[d] = cells.begin[d] > h ? cells.begin[d] - h : 0;
+        b.end[d] = std::min(cells.end[d] + h, dims_[d]);
+    }
+    return b;
+}
+
+template<size_t mD>
+size_t TemporalBlocking<mD>::globalIndex(const Cell& c) const
+{
+    size_t idx = 0;
+    for (size_t d=mD; d-->0;) {
+        idx = idx*dims_[d] + c[d];
+    }
+    return idx;
+}
+
+template<size_t mD>
+UpwindAdvectionStep<mD>::UpwindAdvectionStep(const Field<double, mD, mD>& U,
+                                             const double dt):
+    dt_(dt)
+{
+    assert(U.mesh().ordering() == CellOrdering::Lexicographic);
+    for (size_t d=0; d<mD; d++) {
+        U_[d] = U.component(d).data();
+        invSpacing_[d] = U.mesh().metrics(d).invCentreSpacing.data();
+    }
+}
+
+// Instantiate templates
+template class TemporalBlocking<1>;
+template class TemporalBlocking<2>;
+template class TemporalBlocking<3>;
+template class UpwindAdvectionStep<1>;
+template class UpwindAdvectionStep<2>;
+template class UpwindAdvectionStep<3>;
+
+}
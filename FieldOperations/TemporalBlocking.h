@@ -0,0 +1,284 @@
+/* ---------------------------------------------------------------------------
+ * Temporal blocking of explicit stencil time loops.
+ *
+ * advance() applies an explicit update q' = step(q) nSteps times, but
+ * instead of sweeping the whole Mesh once per step it takes each tile
+ * several steps at once: the tile plus a halo of k cells is copied into a
+ * per-thread buffer, advanced k steps there (each step valid on one cell
+ * less of halo), and the tile's cells written back. Global memory is then
+ * read and written once per k steps rather than every step, at the cost of
+ * recomputing the halo cells that neighbouring tiles share (overlapped
+ * tiling - simpler than diamond or wavefront schedules, and tiles stay
+ * independent so they spread over the thread pool). The buffers belong to
+ * the thread's threadIndex() in the pool, so advance() calls on separate
+ * objects from several threads sharing a pool do not touch each other's
+ * halos; one object is advanced by one thread at a time.
+ *
+ * Steps see one cell at a time through a StencilPoint: the centre value,
+ * the neighbours one cell away along each dimension (the cell itself beyond
+ * the Mesh boundary, ie zero gradient), the cell coordinates and its
+ * lexicographic index for reading coefficient Fields. The result does not
+ * depend on the tile size or the number of steps per block.
+ *
+ * Blocks alternate between q and an internal buffer, and q keeps its own
+ * storage (and so its memory placement, see Parallel/MemoryPolicy.h): if
+ * the last block writes to the internal buffer, the result is copied back
+ * into q once at the end.
+ *
+ * Needs lexicographic cell ordering.
+ * --------------------------------------------------------------------------*/
+
+#ifndef FIELDOPERATIONS_TEMPORALBLOCKING_H
+#define FIELDOPERATIONS_TEMPORALBLOCKING_H
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "DataStructures/Field.tpp"
+#include "Parallel/ParallelRange.h"
+
+namespace FieldOps
+{
+    template<size_t mD>
+    class TemporalBlocking;
+
+    // One cell of the working buffer, as seen by a step function
+    template<size_t mD>
+    class StencilPoint
+    {
+    public:
+        double centre() const { return q_[0]; }
+        // Neighbours along d (the cell itself beyond the boundary)
+        double minus(const size_t d) const { return *(q_ - lo_[d]); }
+        double plus(const size_t d) const { return q_[hi_[d]]; }
+        const std::array<size_t, mD>& cell() const { return cell_; }
+        // Lexicographic index of the cell in the Mesh
+        size_t index() const { return index_; }
+
+    private:
+        friend class TemporalBlocking<mD>;
+
+        const double* q_;
+        std::array<size_t, mD> lo_, hi_;
+        std::array<size_t, mD> cell_;
+        size_t index_;
+    };
+
+    template<size_t mD>
+    class TemporalBlocking
+    {
+        using MeshPtr = std::shared_ptr<const Mesh<mD>>;
+        using Box = Parallel::Range<mD>;
+        using Cell = std::array<size_t, mD>;
+
+    public:
+        // A tile extent of 0 along a dimension picks a default
+        TemporalBlocking(const MeshPtr mesh, const size_t stepsPerBlock,
+                         const std::array<size_t, mD>& tile
+                             = std::array<size_t, mD>(),
+                         Parallel::ThreadPool& pool =
+                             Parallel::ThreadPool::global());
+
+        // q (one value per cell) is advanced nSteps times, with
+        // step(const StencilPoint<mD>&) returning the new value of a cell
+        template<typename Step>
+        void advance(std::vector<double>& q, const size_t nSteps,
+                     const Step& step);
+
+        size_t stepsPerBlock() const { return stepsPerBlock_; }
+        const std::array<size_t, mD>& tileSize() const { return tile_; }
+
+    private:
+        // Per-thread working space
+        struct Work {
+            std::vector<double> a, b;
+        };
+
+        // Data members
+        MeshPtr mesh_;
+        Parallel::ThreadPool* pool_;
+        Cell dims_;
+        Cell tile_;
+        size_t stepsPerBlock_;
+        std::vector<double> next_;
+        std::vector<Work> work_;
+        // End data members
+
+        Box grown(const Box& cells, const size_t h) const;
+        size_t globalIndex(const Cell& c) const;
+
+        template<typename Step>
+        void advanceTile(const std::vector<double>& q,
+                         std::vector<double>& out, const Box& tile,
+                         const size_t k, const Step& step, Work& w);
+
+        // fn(c) for the first cell c of every row of box along dimension 0
+        template<typename Fn>
+        static void forRows(const Box& box, Fn fn) {
+            Cell c = box.begin;
+            while (true) {
+                fn(c);
+                size_t d = 1;
+                for (; d<mD; d++) {
+                    if (++c[d] < box.end[d]) {
+                        break;
+                    }
+                    c[d] = box.begin[d];
+                }
+                if (d >= mD) {
+                    return;
+                }
+            }
+        }
+    };
+
+    // First order upwind step of dq/dt + U.grad(q) = 0 with the velocity at
+    // the cell centres, for use with TemporalBlocking. Reads U's storage
+    // directly, so U must not be modified while the step is in use.
+    template<size_t mD>
+    class UpwindAdvectionStep
+    {
+    public:
+        UpwindAdvectionStep(const Field<double, mD, mD>& U, const double dt);
+
+        double operator()(const StencilPoint<mD>& p) const {
+            const double q = p.centre();
+            double dqdt = 0;
+            for (size_t d=0; d<mD; d++) {
+                const double u = U_[d][p.index()];
+                const size_t i = p.cell()[d];
+                dqdt -= (u > 0) ? u*(q - p.minus(d))*invSpacing_[d][i]
+                                : u*(p.plus(d) - q)*invSpacing_[d][i+1];
+            }
+            return q + dt_*dqdt;
+        }
+
+    private:
+        std::array<const double*, mD> U_;
+        std::array<const double*, mD> invSpacing_;
+        double dt_;
+    };
+
+
+    template<size_t mD>
+    template<typename Step>
+    void TemporalBlocking<mD>::advance(std::vector<double>& q,
+                                       const size_t nSteps, const Step& step)
+    {
+        assert(q.size() == mesh_->numCells());
+        Parallel::ThreadPool& pool = *pool_;
+        if (work_.size() != pool.numSlots()) {
+            work_.resize(pool.numSlots());
+        }
+        next_.resize(q.size());
+        Box tileGrid;
+        for (size_t d=0; d<mD; d++) {
+            tileGrid.begin[d] = 0;
+            tileGrid.end[d] = (dims_[d] + tile_[d] - 1) / tile_[d];
+        }
+
+        std::vector<double>* src = &q;
+        std::vector<double>* dst = &next_;
+        for (size_t done=0; done<nSteps;) {
+            const size_t k = std::min(stepsPerBlock_, nSteps - done);
+            Parallel::parallelFor(pool, tileGrid, [&](const Box& piece) {
+                Work& w = work_[pool.threadIndex()];
+                forRows(piece, [&](const Cell& first) {
+                    Cell c = first;
+                    for (; c[0]<piece.end[0]; c[0]++) {
+                        Box tile;
+                        for (size_t d=0; d<mD; d++) {
+                            tile.begin[d] = c[d]*tile_[d];
+                            tile.end[d] = std::min(dims_[d],
+                                                   (c[d]+1)*tile_[d]);
+                        }
+                        advanceTile(*src, *dst, tile, k, step, w);
+                    }
+                });
+            }, 1);
+            std::swap(src, dst);
+            done += k;
+        }
+        if (src != &q) {
+            Parallel::parallelFor(pool, 0, q.size(),
+                [&](const size_t b, const size_t e) {
+                    std::copy(next_.data() + b, next_.data() + e,
+                              q.data() + b);
+                });
+        }
+    }
+
+    template<size_t mD>
+    template<typename Step>
+    void TemporalBlocking<mD>::advanceTile(const std::vector<double>& q,
+                                           std::vector<double>& out,
+                                           const Box& tile, const size_t k,
+                                           const Step& step, Work& w)
+    {
+        // Working buffers span the tile plus k cells of halo
+        const Box outer = grown(tile, k);
+        Cell stride;
+        size_t volume = 1;
+        for (size_t d=0; d<mD; d++) {
+            stride[d] = volume;
+            volume *= outer.end[d] - outer.begin[d];
+        }
+        if (w.a.size() < volume) {
+            w.a.resize(volume);
+            w.b.resize(volume);
+        }
+        auto local = [&](const Cell& c) {
+            size_t idx = 0;
+            for (size_t d=0; d<mD; d++) {
+                idx += (c[d] - outer.begin[d])*stride[d];
+            }
+            return idx;
+        };
+        const size_t outerRow = outer.end[0] - outer.begin[0];
+        forRows(outer, [&](const Cell& c) {
+            const double* src = q.data() + globalIndex(c);
+            std::copy(src, src + outerRow, w.a.data() + local(c));
+        });
+
+        // Step s is valid on the tile plus k-s cells
+        StencilPoint<mD> p;
+        const size_t last = dims_[0] - 1;
+        for (size_t s=1; s<=k; s++) {
+            const Box region = grown(tile, k-s);
+            const double* a = w.a.data();
+            double* b = w.b.data();
+            const size_t n = region.end[0] - region.begin[0];
+            forRows(region, [&](const Cell& c) {
+                p.cell_ = c;
+                for (size_t d=1; d<mD; d++) {
+                    p.lo_[d] = (c[d] > 0 ? stride[d] : 0);
+                    p.hi_[d] = (c[d]+1 < dims_[d] ? stride[d] : 0);
+                }
+                const size_t l0 = local(c);
+                const size_t g0 = globalIndex(c);
+                for (size_t i=0; i<n; i++) {
+                    const size_t x = c[0] + i;
+                    p.cell_[0] = x;
+                    p.lo_[0] = (x > 0 ? 1 : 0);
+                    p.hi_[0] = (x < last ? 1 : 0);
+                    p.q_ = a + l0 + i;
+                    p.index_ = g0 + i;
+                    b[l0 + i] = step(p);
+                }
+            });
+            std::swap(w.a, w.b);
+        }
+
+        const size_t tileRow = tile.end[0] - tile.begin[0];
+        forRows(tile, [&](const Cell& c) {
+            const double* src = w.a.data() + local(c);
+            std::copy(src, src + tileRow, out.data() + globalIndex(c));
+        });
+    }
+}
+
+#endif // FIELDOPERATIONS_TEMPORALBLOCKING_H
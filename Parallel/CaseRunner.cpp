@@ -0,0 +1,98 @@
+#include "CaseRunner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Runner whose case the calling thread is in, if any
+    thread_local const Parallel::CaseRunner* runningCaseOf = nullptr;
+
+    double secondsSince(const Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+}
+
+Parallel::CaseRunner::CaseRunner(ThreadPool& pool, const size_t concurrency):
+    pool_(pool),
+    concurrency_(concurrency == 0 ? pool.size() : concurrency)
+{}
+
+void Parallel::CaseRunner::add(const std::string& name, const double cost,
+                               std::function<void()> fn)
+{
+    cases_.push_back({ std::move(fn), results_.size() });
+    results_.push_back({ name, cost, 0.0, 0, 0 });
+}
+
+double Parallel::CaseRunner::run()
+{
+    const Clock::time_point start = Clock::now();
+    // In the pool throughout, so the slots go on this thread's own deque
+    ThreadPool::Participant participant(pool_);
+    // Largest first; ties keep the order they were added in
+    std::stable_sort(cases_.begin(), cases_.end(),
+        [this](const Case& a, const Case& b) {
+            return results_[a.index].cost > results_[b.index].cost;
+        });
+
+    std::atomic<size_t> next(0);
+    const size_t nSlots = std::min(concurrency_, cases_.size());
+    std::atomic<size_t> slotsLeft(nSlots);
+    // Slots picked up by threads inside one of our cases
+    std::mutex parkedMutex;
+    std::vector<size_t> parked;
+    auto takeParked = [&parkedMutex, &parked]() {
+        std::lock_guard<std::mutex> lock(parkedMutex);
+        return std::move(parked);
+    };
+
+    std::function<void(size_t)> slot = [&](const size_t s) {
+        // A thread waiting in one of our cases' loops must not start a
+        // whole case - park the slot until a thread is free
+        if (runningCaseOf == this) {
+            std::lock_guard<std::mutex> lock(parkedMutex);
+            parked.push_back(s);
+            return;
+        }
+        const CaseRunner* outer = runningCaseOf;
+        runningCaseOf = this;
+        for (size_t k=next++; k<cases_.size(); k=next++) {
+            Result& r = results_[cases_[k].index];
+            const Clock::time_point t0 = Clock::now();
+            cases_[k].fn();
+            r.seconds = secondsSince(t0);
+            r.slot = s;
+            r.startOrder = k;
+            // Between cases, so idle threads may take the parked slots
+            for (const size_t p : takeParked()) {
+                pool_.submit([&slot, p]() { slot(p); });
+            }
+        }
+        runningCaseOf = outer;
+        slotsLeft--;
+    };
+    for (size_t s=1; s<nSlots; s++) {
+        pool_.submit([&slot, s]() { slot(s); });
+    }
+    if (nSlots > 0) {
+        slot(0);
+    }
+    // This thread is free now: it runs the slots still parked itself
+    while (slotsLeft > 0) {
+        const std::vector<size_t> mine = takeParked();
+        for (const size_t p : mine) {
+            slot(p);
+        }
+        if (mine.empty() && !pool_.runOne()) {
+            std::this_thread::yield();
+        }
+    }
+    cases_.clear();
+    return secondsSince(start);
+}
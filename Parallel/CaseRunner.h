@@ -0,0 +1,84 @@
+/* ---------------------------------------------------------------------------
+ * Runs many independent cases (eg the points of a parameter sweep) in one
+ * process, sharing a ThreadPool.
+ *
+ * Cases are started largest estimated cost first, each by whichever thread
+ * is free next (longest-processing-time list scheduling), with at most
+ * 'concurrency' cases in flight - by default one per pool thread. The
+ * parallel loops inside a case (Field, FieldOps, solvers, particles) run on
+ * the global pool, so when that is the runner's pool, once there are fewer
+ * cases left than threads the idle threads help with the loops of the cases
+ * still running. A case is only ever started by a free thread, never by a
+ * thread waiting inside another case's loop, so a short loop is not held up
+ * behind a whole case: a slot picked up by such a thread is parked, and
+ * handed back to the pool when a case finishes.
+ *
+ * With a pool of its own, the threads running cases are outside threads
+ * of the global pool. Each takes a slot of its own there for the length of
+ * a loop (see ThreadPool::Participant), so concurrent cases never share
+ * per-thread scratch; with more than global().size() cases inside loops at
+ * once, the others wait for a slot.
+ *
+ * Cases share whatever immutable data they are given: a
+ * std::shared_ptr<const Mesh> built once and captured by every case, or
+ * Meshes each case builds itself, which share their geometry anyway (see
+ * MeshGeometry::intern). Cases must not otherwise share mutable state.
+ *
+ * After run(), results() gives each case's wall time and the slot that ran
+ * it, in the order the cases were added.
+ * --------------------------------------------------------------------------*/
+
+#ifndef PARALLEL_CASERUNNER_H
+#define PARALLEL_CASERUNNER_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.h"
+
+namespace Parallel
+{
+    class CaseRunner
+    {
+    public:
+        struct Result {
+            std::string name;
+            double cost;            // Estimate given to add()
+            double seconds;         // Measured wall time
+            size_t slot;            // Which of the concurrent slots ran it
+            size_t startOrder;      // 0 for the first case started
+        };
+
+        // concurrency == 0 runs up to pool.size() cases at once
+        explicit CaseRunner(ThreadPool& pool = ThreadPool::global(),
+                            const size_t concurrency = 0);
+
+        // cost is any estimate proportional to run time (eg cells * steps)
+        void add(const std::string& name, const double cost,
+                 std::function<void()> fn);
+
+        size_t numCases() const { return cases_.size(); }
+
+        // Run every case added since the last run, returning the wall time
+        double run();
+
+        const std::vector<Result>& results() const { return results_; }
+
+    private:
+        struct Case {
+            std::function<void()> fn;
+            size_t index;
+        };
+
+        // Data members
+        ThreadPool& pool_;
+        size_t concurrency_;
+        std::vector<Case> cases_;
+        std::vector<Result> results_;
+        // End data members
+    };
+}
+
+#endif // PARALLEL_CASERUNNER_H
@@ -0,0 +1,223 @@
+#include "MemoryPolicy.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    Parallel::MemoryPolicy defaultMemoryPolicy;
+
+#if defined(__linux__)
+    // From linux/mempolicy.h, to avoid depending on libnuma
+    constexpr int mpolPreferred = 1;
+    constexpr int mpolBind = 2;
+    constexpr int mpolInterleave = 3;
+    constexpr unsigned mpolMfMove = 1u << 1;
+    constexpr size_t maxNodes = 1024;
+#ifndef MADV_COLLAPSE
+    constexpr int madvCollapse = 25;
+#else
+    constexpr int madvCollapse = MADV_COLLAPSE;
+#endif
+
+    size_t pageSize() {
+        static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return size;
+    }
+
+    // Whole pages inside [p, p+bytes)
+    bool pageRange(const void* p, const size_t bytes, uintptr_t& begin,
+                   uintptr_t& end) {
+        const uintptr_t page = pageSize();
+        const uintptr_t a = reinterpret_cast<uintptr_t>(p);
+        begin = (a + page - 1) / page * page;
+        end = (a + bytes) / page * page;
+        return end > begin;
+    }
+
+    long mbind(const uintptr_t begin, const uintptr_t end, const int mode,
+               const std::vector<unsigned long>& mask) {
+        return syscall(SYS_mbind, begin, end - begin, mode, mask.data(),
+                       mask.size()*8*sizeof(unsigned long), mpolMfMove);
+    }
+
+    std::vector<unsigned long> nodeMask(const int node) {
+        std::vector<unsigned long> mask(maxNodes/(8*sizeof(unsigned long)));
+        const size_t bits = 8*sizeof(unsigned long);
+        mask[node / bits] |= 1ul << (node % bits);
+        return mask;
+    }
+#endif
+}
+
+size_t Parallel::Memory::numNodes()
+{
+#if defined(__linux__)
+    // "0" or "0-3" or "0,2-3": one past the highest node
+    std::ifstream online("/sys/devices/system/node/has_memory");
+    std::string list;
+    if (!(online >> list)) {
+        return 1;
+    }
+    std::replace(list.begin(), list.end(), ',', ' ');
+    std::replace(list.begin(), list.end(), '-', ' ');
+    std::istringstream in(list);
+    size_t n = 0, highest = 0;
+    while (in >> n) {
+        highest = std::max(highest, n);
+    }
+    return highest + 1;
+#else
+    return 1;
+#endif
+}
+
+int Parallel::Memory::nodeOfCpu(const int cpu)
+{
+#if defined(__linux__)
+    if (cpu < 0) {
+        return 0;
+    }
+    const std::string dir = "/sys/devices/system/cpu/cpu"
+                          + std::to_string(cpu) + "/node";
+    for (size_t node=0; node<numNodes(); node++) {
+        if (access((dir + std::to_string(node)).c_str(), F_OK) == 0) {
+            return static_cast<int>(node);
+        }
+    }
+#endif
+    (void)cpu;
+    return 0;
+}
+
+bool Parallel::Memory::place(void* p, const size_t bytes,
+                             const MemoryPolicy& policy, ThreadPool& pool)
+{
+#if defined(__linux__)
+    uintptr_t begin, end;
+    if (policy.isDefault() || !pageRange(p, bytes, begin, end)) {
+        return true;
+    }
+    bool ok = true;
+    if (policy.pages == MemoryPolicy::Pages::Huge) {
+        void* a = reinterpret_cast<void*>(begin);
+        ok = madvise(a, end - begin, MADV_HUGEPAGE) == 0;
+        // Best effort: fails on older kernels, or with no huge page free
+        madvise(a, end - begin, madvCollapse);
+    }
+
+    const size_t nNodes = numNodes();
+    switch (policy.placement) {
+    case MemoryPolicy::Placement::Default:
+        break;
+    case MemoryPolicy::Placement::Interleave: {
+        std::vector<unsigned long> mask = nodeMask(0);
+        for (size_t node=1; node<nNodes; node++) {
+            const std::vector<unsigned long> m = nodeMask(int(node));
+            for (size_t k=0; k<mask.size(); k++) {
+                mask[k] |= m[k];
+            }
+        }
+        ok = mbind(begin, end, mpolInterleave, mask) == 0 && ok;
+        break;
+    }
+    case MemoryPolicy::Placement::Bind:
+        ok = mbind(begin, end, mpolBind, nodeMask(policy.node)) == 0 && ok;
+        break;
+    case MemoryPolicy::Placement::LocalPartitions: {
+        const size_t page = pageSize();
+        const size_t nPages = (end - begin) / page;
+        for (size_t i=0; i<pool.size(); i++) {
+            size_t b, e;
+            chunkRange(nPages, pool.size(), i, b, e);
+            if (b == e) {
+                continue;
+            }
+            const int cpu = (i == 0 ? sched_getcpu() : pool.cpu(i));
+            // Preferred rather than bound, so a full node is not fatal
+            ok = mbind(begin + b*page, begin + e*page, mpolPreferred,
+                       nodeMask(nodeOfCpu(cpu))) == 0 && ok;
+        }
+        break;
+    }
+    }
+    return ok;
+#else
+    (void)p; (void)bytes; (void)policy; (void)pool;
+    return policy.isDefault();
+#endif
+}
+
+Parallel::MemoryReport Parallel::Memory::report(const void* p,
+                                                const size_t bytes)
+{
+    MemoryReport r;
+    r.pagesPerNode.assign(numNodes(), 0);
+#if defined(__linux__)
+    uintptr_t begin, end;
+    if (!pageRange(p, bytes, begin, end)) {
+        return r;
+    }
+    const size_t page = pageSize();
+    r.pages = (end - begin) / page;
+
+    // move_pages with no target nodes only reports where pages are
+    std::vector<void*> pages(r.pages);
+    std::vector<int> status(r.pages, 0);
+    for (size_t i=0; i<r.pages; i++) {
+        pages[i] = reinterpret_cast<void*>(begin + i*page);
+    }
+    if (syscall(SYS_move_pages, 0, r.pages, pages.data(), nullptr,
+                status.data(), 0) == 0) {
+        for (int s : status) {
+            if (s >= 0 && size_t(s) < r.pagesPerNode.size()) {
+                r.pagesPerNode[s]++;
+            } else {
+                r.notPresent++;
+            }
+        }
+    }
+
+    // AnonHugePages of every mapping overlapping the range
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    bool inRange = false;
+    while (std::getline(smaps, line)) {
+        uintptr_t lo, hi;
+        char dash;
+        std::istringstream in(line);
+        if (line.find("AnonHugePages:") == 0) {
+            if (inRange) {
+                std::string key;
+                size_t kB;
+                in >> key >> kB;
+                r.hugeBytes += kB*1024;
+            }
+        } else if (in >> std::hex >> lo >> dash >> hi && dash == '-') {
+            inRange = lo < end && hi > begin;
+        }
+    }
+#endif
+    return r;
+}
+
+const Parallel::MemoryPolicy& Parallel::Memory::defaultPolicy()
+{
+    return defaultMemoryPolicy;
+}
+
+void Parallel::Memory::setDefaultPolicy(const MemoryPolicy& policy)
+{
+    defaultMemoryPolicy = policy;
+}
@@ -0,0 +1,90 @@
+/* ---------------------------------------------------------------------------
+ * Page size and NUMA placement of large arrays (Linux only; elsewhere the
+ * requests do nothing and report nothing).
+ *
+ * A MemoryPolicy asks for
+ *      pages      Default | Huge - transparent huge pages: the range is
+ *                 marked MADV_HUGEPAGE and the pages already present are
+ *                 collapsed (MADV_COLLAPSE, Linux 6.1+) rather than waiting
+ *                 for khugepaged
+ *      placement  Default         - wherever the pages were first touched
+ *                 Interleave      - round robin over every node
+ *                 Bind            - all on 'node'
+ *                 LocalPartitions - the range split into pool.size() equal
+ *                                   parts, part i on the node of the CPU
+ *                                   pool thread i is bound to (the calling
+ *                                   thread's node for part 0). parallelFor
+ *                                   hands chunks to whichever thread is
+ *                                   free, so only loops that split work by
+ *                                   threadIndex() touch their own part
+ * Pages already present are migrated (mbind with MPOL_MF_MOVE); later
+ * faults follow the same policy. Only whole pages inside the range are
+ * affected.
+ *
+ * place() applies a policy to an existing range, and report() says where
+ * the range's pages actually are: per node, not yet present, and how much
+ * of the mappings holding them is in huge pages.
+ *
+ * Fields apply defaultPolicy() to every buffer they allocate, so setting
+ * it at start-up places all Field storage (see Field.tpp).
+ * --------------------------------------------------------------------------*/
+
+#ifndef PARALLEL_MEMORYPOLICY_H
+#define PARALLEL_MEMORYPOLICY_H
+
+#include <cstddef>
+#include <vector>
+
+#include "ThreadPool.h"
+
+namespace Parallel
+{
+    struct MemoryPolicy
+    {
+        enum class Pages {
+            Default,
+            Huge
+        };
+        enum class Placement {
+            Default,
+            Interleave,
+            Bind,
+            LocalPartitions
+        };
+
+        Pages pages = Pages::Default;
+        Placement placement = Placement::Default;
+        int node = 0;                   // For Bind
+
+        bool isDefault() const {
+            return pages == Pages::Default
+                && placement == Placement::Default;
+        }
+    };
+
+    struct MemoryReport
+    {
+        size_t pages = 0;                   // Whole pages in the range
+        std::vector<size_t> pagesPerNode;
+        size_t notPresent = 0;              // Not touched yet
+        size_t hugeBytes = 0;               // In the mappings of the range
+    };
+
+    namespace Memory
+    {
+        // Nodes with memory (1 without NUMA), and the node of a CPU
+        size_t numNodes();
+        int nodeOfCpu(const int cpu);
+
+        // Returns false if the kernel refused any part of the request
+        bool place(void* p, const size_t bytes, const MemoryPolicy& policy,
+                   ThreadPool& pool = ThreadPool::global());
+        MemoryReport report(const void* p, const size_t bytes);
+
+        // Applied by Field to new buffers - set it before making Fields
+        const MemoryPolicy& defaultPolicy();
+        void setDefaultPolicy(const MemoryPolicy& policy);
+    }
+}
+
+#endif // PARALLEL_MEMORYPOLICY_H
@@ -0,0 +1,36 @@
+/* ---------------------------------------------------------------------------
+ * Helpers for splitting work between threads.
+ *
+ * Loops run on a ThreadPool through parallelFor (ParallelRange.h); callers
+ * needing per-thread scratch size it by ThreadPool::numSlots() and index
+ * it by ThreadPool::threadIndex(), which is unique among the threads
+ * running the loop however many outside threads share the pool.
+ * chunkRange gives the near-equal contiguous blocks used where a fixed
+ * split is wanted (tiles of a task graph, memory placement).
+ * --------------------------------------------------------------------------*/
+
+#ifndef PARALLEL_PARALLELFOR_H
+#define PARALLEL_PARALLELFOR_H
+
+#include <cstddef>
+#include <thread>
+#include <algorithm>
+
+namespace Parallel
+{
+    inline size_t defaultThreads() {
+        const unsigned int n = std::thread::hardware_concurrency();
+        return n == 0 ? 1 : n;
+    }
+
+    // Bounds of chunk i of nChunks near-equal contiguous chunks of [0, n)
+    inline void chunkRange(const size_t n, const size_t nChunks,
+                           const size_t i, size_t& begin, size_t& end) {
+        const size_t chunk = n / nChunks;
+        const size_t extra = n % nChunks;
+        begin = i*chunk + std::min(i, extra);
+        end = begin + chunk + (i < extra ? 1 : 0);
+    }
+}
+
+#endif // PARALLEL_PARALLELFOR_H
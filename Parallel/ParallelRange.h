@@ -0,0 +1,126 @@
+/* ---------------------------------------------------------------------------
+ * parallelFor over 1D, 2D and 3D index ranges on a ThreadPool.
+ *
+ * The range is bisected until a piece holds at most 'grain' indices. Each
+ * split keeps the lower half and hands the upper half to the pool, so idle
+ * threads steal large pieces first and uneven work (boundary tiles, masked
+ * cells) is rebalanced. The outermost dimension with more than one index is
+ * split first, so pieces stay whole rows along dimension 0 for as long as
+ * possible and inner loops remain unit stride.
+ *
+ * Ranges no bigger than grain, or pools of one thread, run inline on the
+ * calling thread without queueing any task. Either way the calling thread
+ * is in the pool for the loop (see ThreadPool::Participant), so fn may pick
+ * per-thread scratch by threadIndex().
+ * --------------------------------------------------------------------------*/
+
+#ifndef PARALLEL_PARALLELRANGE_H
+#define PARALLEL_PARALLELRANGE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+#include "ThreadPool.h"
+
+namespace Parallel
+{
+    // Default number of indices below which a range is not split
+    constexpr size_t defaultGrain = 4096;
+
+    // [begin[d], end[d]) along each dimension, dimension 0 fastest
+    template<size_t D>
+    struct Range
+    {
+        std::array<size_t, D> begin;
+        std::array<size_t, D> end;
+
+        size_t size() const {
+            size_t n = 1;
+            for (size_t d=0; d<D; d++) {
+                n *= end[d] - begin[d];
+            }
+            return n;
+        }
+
+        // Move the upper half of the outermost splittable dimension into
+        // upper. False if every dimension has a single index.
+        bool split(Range<D>& upper) {
+            for (size_t d=D; d-->0;) {
+                if (end[d] - begin[d] > 1) {
+                    upper = *this;
+                    const size_t mid = begin[d] + (end[d] - begin[d])/2;
+                    upper.begin[d] = mid;
+                    end[d] = mid;
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    namespace detail
+    {
+        template<size_t D, typename Fn>
+        void runRange(ThreadPool& pool, Range<D> r, const size_t grain,
+                      const Fn& fn, std::atomic<size_t>& left)
+        {
+            Range<D> upper;
+            while (r.size() > grain && r.split(upper)) {
+                pool.submit([&pool, upper, grain, &fn, &left]() {
+                    runRange(pool, upper, grain, fn, left);
+                });
+            }
+            const size_t n = r.size();
+            fn(r);
+            left -= n;
+        }
+    }
+
+    // fn(const Range<D>& piece), for disjoint pieces covering r
+    template<size_t D, typename Fn>
+    void parallelFor(ThreadPool& pool, const Range<D>& r, const Fn& fn,
+                     const size_t grain = defaultGrain)
+    {
+        const size_t n = r.size();
+        if (n == 0) {
+            return;
+        }
+        ThreadPool::Participant participant(pool);
+        if (n <= grain || pool.size() == 1) {
+            fn(r);
+            return;
+        }
+        std::atomic<size_t> left(n);
+        detail::runRange(pool, r, grain, fn, left);
+        pool.helpUntil([&left]() { return left == 0; });
+    }
+
+    // fn(pieceBegin, pieceEnd) over [begin, end)
+    template<typename Fn>
+    void parallelFor(ThreadPool& pool, const size_t begin, const size_t end,
+                     const Fn& fn, const size_t grain = defaultGrain)
+    {
+        if (end <= begin) {
+            return;
+        }
+        const Range<1> r{{{ begin }}, {{ end }}};
+        parallelFor(pool, r, [&fn](const Range<1>& p) {
+            fn(p.begin[0], p.end[0]);
+        }, grain);
+    }
+
+    // Whole extents, eg Range over the cells of a Mesh
+    template<size_t D>
+    Range<D> fullRange(const std::array<size_t, D>& dims)
+    {
+        Range<D> r;
+        for (size_t d=0; d<D; d++) {
+            r.begin[d] = 0;
+            r.end[d] = dims[d];
+        }
+        return r;
+    }
+}
+
+#endif // PARALLEL_PARALLELRANGE_H
@@ -0,0 +1,106 @@
+#include "TaskGraph.h"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+size_t Parallel::TaskGraph::add(TileFn fn, const size_t nTiles,
+                                const std::vector<Resource>& reads,
+                                const std::vector<Resource>& writes)
+{
+    assert(nTiles > 0);
+    const size_t k = kernels_.size();
+    std::vector<size_t> preds;
+    for (Resource r : reads) {
+        const Access& a = accesses_[r];
+        if (a.lastWriter >= 0) {
+            preds.push_back(static_cast<size_t>(a.lastWriter));
+        }
+    }
+    for (Resource r : writes) {
+        const Access& a = accesses_[r];
+        if (a.lastWriter >= 0) {
+            preds.push_back(static_cast<size_t>(a.lastWriter));
+        }
+        preds.insert(preds.end(), a.readers.begin(), a.readers.end());
+    }
+    std::sort(preds.begin(), preds.end());
+    preds.erase(std::unique(preds.begin(), preds.end()), preds.end());
+
+    // Update the accesses after finding the dependencies, so reading and
+    // writing the same resource depends only on earlier kernels
+    for (Resource r : reads) {
+        accesses_[r].readers.push_back(k);
+    }
+    for (Resource r : writes) {
+        Access& a = accesses_[r];
+        a.lastWriter = static_cast<long>(k);
+        a.readers.clear();
+    }
+
+    for (size_t p : preds) {
+        kernels_[p].successors.push_back(k);
+    }
+    kernels_.push_back(Kernel{std::move(fn), nTiles, std::move(preds), {}});
+    return k;
+}
+
+size_t Parallel::TaskGraph::add(std::function<void()> fn,
+                                const std::vector<Resource>& reads,
+                                const std::vector<Resource>& writes)
+{
+    return add([fn](size_t) { fn(); }, 1, reads, writes);
+}
+
+void Parallel::TaskGraph::run(ThreadPool& pool)
+{
+    const size_t n = kernels_.size();
+    if (n == 0) {
+        return;
+    }
+    if (numCounters_ != n) {
+        tilesLeft_.reset(new std::atomic<size_t>[n]);
+        predsLeft_.reset(new std::atomic<size_t>[n]);
+        numCounters_ = n;
+    }
+    for (size_t k=0; k<n; k++) {
+        tilesLeft_[k] = kernels_[k].nTiles;
+        predsLeft_[k] = kernels_[k].predecessors.size();
+    }
+    kernelsLeft_ = n;
+    for (size_t k=0; k<n; k++) {
+        if (kernels_[k].predecessors.empty()) {
+            launch(pool, k);
+        }
+    }
+    pool.helpUntil([this]() { return kernelsLeft_ == 0; });
+}
+
+void Parallel::TaskGraph::clear()
+{
+    kernels_.clear();
+    accesses_.clear();
+}
+
+void Parallel::TaskGraph::launch(ThreadPool& pool, const size_t k)
+{
+    for (size_t t=0; t<kernels_[k].nTiles; t++) {
+        pool.submit([this, &pool, k, t]() {
+            kernels_[k].fn(t);
+            finishTile(pool, k);
+        });
+    }
+}
+
+void Parallel::TaskGraph::finishTile(ThreadPool& pool, const size_t k)
+{
+    if (--tilesLeft_[k] != 0) {
+        return;
+    }
+    for (size_t s : kernels_[k].successors) {
+        if (--predsLeft_[s] == 0) {
+            launch(pool, s);
+        }
+    }
+    kernelsLeft_--;
+}
@@ -0,0 +1,91 @@
+/* ---------------------------------------------------------------------------
+ * Task graph of the kernels making up a step, run on a ThreadPool.
+ *
+ * Kernels are added in program order with the resources (usually Fields,
+ * identified by address) they read and write. Each kernel depends on
+ *      the last writer of anything it reads           (read after write)
+ *      the last writer and the readers since then of
+ *          anything it writes                         (write after read/write)
+ * so running the graph gives the same result as running the kernels one
+ * after another, while independent kernels run concurrently.
+ *
+ * A kernel may be split into tiles, fn(tile) for tile in [0, nTiles), which
+ * must be independent of each other (eg disjoint ranges of cells - see
+ * chunkRange in ParallelFor.h). Its successors start once every tile is
+ * done.
+ *
+ * The graph is built once and run() replays it: the kernels capture their
+ * Fields by reference, so each step only resets the dependency counters.
+ * --------------------------------------------------------------------------*/
+
+#ifndef PARALLEL_TASKGRAPH_H
+#define PARALLEL_TASKGRAPH_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "ThreadPool.h"
+
+namespace Parallel
+{
+    class TaskGraph
+    {
+    public:
+        using Resource = const void*;
+        using TileFn = std::function<void(size_t)>;
+
+        // Returns the index of the new kernel
+        size_t add(TileFn fn, const size_t nTiles,
+                   const std::vector<Resource>& reads,
+                   const std::vector<Resource>& writes);
+        size_t add(std::function<void()> fn,
+                   const std::vector<Resource>& reads,
+                   const std::vector<Resource>& writes);
+
+        size_t numKernels() const { return kernels_.size(); }
+        // Kernels which wait for kernel k
+        const std::vector<size_t>& successors(const size_t k) const {
+            return kernels_[k].successors;
+        }
+        const std::vector<size_t>& predecessors(const size_t k) const {
+            return kernels_[k].predecessors;
+        }
+
+        // Run every kernel once, returning when all are done
+        void run(ThreadPool& pool);
+
+        void clear();
+
+    private:
+        struct Kernel {
+            TileFn fn;
+            size_t nTiles;
+            std::vector<size_t> predecessors;
+            std::vector<size_t> successors;
+        };
+        // Accesses to one resource since its last writer
+        struct Access {
+            long lastWriter = -1;
+            std::vector<size_t> readers;
+        };
+
+        // Data members
+        std::vector<Kernel> kernels_;
+        std::unordered_map<Resource, Access> accesses_;
+        // Per-run counters, reallocated only when kernels are added
+        std::unique_ptr<std::atomic<size_t>[]> tilesLeft_;
+        std::unique_ptr<std::atomic<size_t>[]> predsLeft_;
+        size_t numCounters_ = 0;
+        std::atomic<size_t> kernelsLeft_{0};
+        // End data members
+
+        void launch(ThreadPool& pool, const size_t k);
+        void finishTile(ThreadPool& pool, const size_t k);
+    };
+}
+
+#endif // PARALLEL_TASKGRAPH_H
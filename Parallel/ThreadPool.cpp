@@ -0,0 +1,226 @@
+#include "ThreadPool.h"
+#include "ParallelFor.h"
+
+#include <utility>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+thread_local Parallel::ThreadPool::Membership*
+    Parallel::ThreadPool::memberships_ = nullptr;
+
+Parallel::ThreadPool::Participant::Participant(ThreadPool& pool):
+    pool_(pool),
+    membership_{ &pool, 0, nullptr },
+    joined_(membershipOf(&pool) == nullptr)
+{
+    if (joined_) {
+        membership_.slot = pool.acquireSlot();
+        membership_.outer = memberships_;
+        memberships_ = &membership_;
+    }
+}
+
+Parallel::ThreadPool::Participant::~Participant()
+{
+    if (joined_) {
+        memberships_ = membership_.outer;
+        pool_.releaseSlot(membership_.slot);
+    }
+}
+
+Parallel::ThreadPool::ThreadPool(const size_t nThreads, const bool pin):
+    size_(nThreads == 0 ? defaultThreads() : nThreads),
+    pending_(0),
+    stop_(false),
+    pinned_(false)
+{
+    const size_t n = size_;
+    // Slot 0, the workers, then one slot per outside thread
+    cpus_.assign(2*n, -1);
+    for (size_t i=0; i<2*n; i++) {
+        queues_.emplace_back(new Queue());
+    }
+    // Handed out lowest first
+    for (size_t i=2*n; i-->n;) {
+        freeSlots_.push_back(i);
+    }
+    workers_.reserve(n-1);
+    for (size_t i=1; i<n; i++) {
+        workers_.emplace_back([this, i]() { workerLoop(i); });
+    }
+    if (pin && n > 1) {
+        pinned_ = true;
+        for (size_t i=1; i<n; i++) {
+            pinned_ = pinWorker(i) && pinned_;
+        }
+    }
+}
+
+Parallel::ThreadPool& Parallel::ThreadPool::global()
+{
+    static ThreadPool pool(0, true);
+    return pool;
+}
+
+Parallel::ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& w : workers_) {
+        w.join();
+    }
+}
+
+void Parallel::ThreadPool::submit(Task task)
+{
+    Queue& q = *queues_[self()];
+    {
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.tasks.push_back(std::move(task));
+    }
+    {
+        // Counted under the sleep lock so a worker can't miss the wake up
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        pending_++;
+    }
+    wake_.notify_one();
+}
+
+bool Parallel::ThreadPool::runOne()
+{
+    Participant participant(*this);
+    return runOneAs(self());
+}
+
+bool Parallel::ThreadPool::runOneAs(const size_t me)
+{
+    Task task;
+    if (!pop(me, task)) {
+        bool found = false;
+        for (size_t k=1; k<queues_.size() && !found; k++) {
+            found = steal((me + k) % queues_.size(), task);
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    pending_--;
+    task();
+    return true;
+}
+
+size_t Parallel::ThreadPool::self() const
+{
+    const Membership* m = membershipOf(this);
+    return m ? m->slot : 0;
+}
+
+const Parallel::ThreadPool::Membership*
+Parallel::ThreadPool::membershipOf(const ThreadPool* pool)
+{
+    for (const Membership* m = memberships_; m; m = m->outer) {
+        if (m->pool == pool) {
+            return m;
+        }
+    }
+    return nullptr;
+}
+
+size_t Parallel::ThreadPool::acquireSlot()
+{
+    std::unique_lock<std::mutex> lock(slotMutex_);
+    slotFreed_.wait(lock, [this]() { return !freeSlots_.empty(); });
+    const size_t slot = freeSlots_.back();
+    freeSlots_.pop_back();
+    return slot;
+}
+
+void Parallel::ThreadPool::releaseSlot(const size_t slot)
+{
+    {
+        std::lock_guard<std::mutex> lock(slotMutex_);
+        freeSlots_.push_back(slot);
+    }
+    slotFreed_.notify_one();
+}
+
+bool Parallel::ThreadPool::pop(const size_t q, Task& task)
+{
+    Queue& queue = *queues_[q];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool Parallel::ThreadPool::steal(const size_t q, Task& task)
+{
+    Queue& queue = *queues_[q];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = std::move(queue.tasks.front());
+    queue.tasks.pop_front();
+    return true;
+}
+
+void Parallel::ThreadPool::workerLoop(const size_t idx)
+{
+    Membership self{ this, idx, nullptr };
+    memberships_ = &self;
+    while (true) {
+        if (runOneAs(idx)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        wake_.wait(lock, [this]() { return stop_ || pending_ > 0; });
+        if (stop_ && pending_ == 0) {
+            return;
+        }
+    }
+}
+
+bool Parallel::ThreadPool::pinWorker(const size_t i)
+{
+#if defined(__linux__)
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return false;
+    }
+    const size_t numAllowed = CPU_COUNT(&allowed);
+    if (numAllowed == 0) {
+        return false;
+    }
+    // The (i % numAllowed)-th allowed CPU
+    size_t want = i % numAllowed;
+    int cpu = 0;
+    for (; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed) && want-- == 0) {
+            break;
+        }
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(workers_[i-1].native_handle(),
+                               sizeof(set), &set) != 0) {
+        return false;
+    }
+    cpus_[i] = cpu;
+    return true;
+#else
+    (void)i;
+    return false;
+#endif
+}
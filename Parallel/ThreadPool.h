@@ -0,0 +1,162 @@
+/* ---------------------------------------------------------------------------
+ * Work-stealing thread pool.
+ *
+ * A pool of n threads is n-1 background workers plus whichever thread is
+ * waiting on it: helpUntil() runs queued tasks on the calling thread until
+ * its condition holds, so a pool of one thread runs everything inline.
+ *
+ * Each thread in the pool has a slot of its own: workers 1 to n-1, and
+ * threads from outside one of n more slots, held while they are inside
+ * the pool (see Participant). Slot 0 belongs to no thread, so several
+ * outside threads may wait on one pool - eg cases of a CaseRunner, or
+ * threads of the caller's own - and threadIndex() still tells apart every
+ * thread that can run a task at the same time. Per-thread scratch is sized
+ * by numSlots() and indexed by threadIndex().
+ *
+ * Each slot has its own deque. Tasks submitted from a thread in the pool go
+ * on the back of its own deque and are popped from the back (most recent
+ * first, while their data is still in cache); idle threads steal from the
+ * front of the others' deques. Tasks submitted from a thread not in the
+ * pool go to the deque of slot 0.
+ *
+ * With pinning, worker i is bound to the i-th CPU the process may run on
+ * (Linux only; elsewhere the request is ignored), so a worker keeps its
+ * caches, and on NUMA machines its memory, between parallel loops. Outside
+ * threads are left where the OS put them.
+ *
+ * global() is a shared pinned pool with one thread per hardware thread,
+ * used by the Field and FieldOps loops (see ParallelRange.h).
+ * --------------------------------------------------------------------------*/
+
+#ifndef PARALLEL_THREADPOOL_H
+#define PARALLEL_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Parallel
+{
+    class ThreadPool
+    {
+    public:
+        using Task = std::function<void()>;
+
+        // nThreads == 0 uses one thread per hardware thread
+        explicit ThreadPool(const size_t nThreads = 0, const bool pin = false);
+        ~ThreadPool();
+
+        static ThreadPool& global();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // The calling thread holds a slot of its own in the pool for the
+        // lifetime of the Participant, waiting for one if every outside
+        // slot is taken. Does nothing on a worker, or on a thread already
+        // in the pool. parallelFor, helpUntil and runOne take one, so only
+        // code reading threadIndex() outside them needs its own.
+        class Participant;
+
+        // Threads running tasks, including the waiting thread
+        size_t size() const { return size_; }
+        // Bound on threadIndex(): the workers, and a slot for each of up to
+        // size() outside threads in the pool at once
+        size_t numSlots() const { return queues_.size(); }
+        // Slot of the calling thread, unique among the threads in the pool
+        // - 0 for a thread that isn't
+        size_t threadIndex() const { return self(); }
+        // Whether the workers were bound to CPUs
+        bool pinned() const { return pinned_; }
+        // CPU worker i is bound to, or -1 (always -1 for slot 0 and the
+        // outside slots)
+        int cpu(const size_t i) const { return cpus_[i]; }
+
+        void submit(Task task);
+
+        // Run one queued task on the calling thread, if there is one
+        bool runOne();
+
+        // Run queued tasks on the calling thread until done() is true
+        template<typename Pred>
+        void helpUntil(Pred done);
+
+    private:
+        struct Queue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        // A pool the calling thread is in, and its slot there
+        struct Membership {
+            const ThreadPool* pool;
+            size_t slot;
+            Membership* outer;
+        };
+        // Innermost first
+        static thread_local Membership* memberships_;
+        static const Membership* membershipOf(const ThreadPool* pool);
+
+        // Data members
+        size_t size_;
+        std::vector<std::unique_ptr<Queue>> queues_;
+        std::vector<std::thread> workers_;
+        std::atomic<size_t> pending_;
+        std::mutex sleepMutex_;
+        std::condition_variable wake_;
+        bool stop_;
+        bool pinned_;
+        std::vector<int> cpus_;
+        // Outside slots not held by a thread
+        std::mutex slotMutex_;
+        std::condition_variable slotFreed_;
+        std::vector<size_t> freeSlots_;
+        // End data members
+
+        // Slot of the calling thread (0 outside the pool)
+        size_t self() const;
+        size_t acquireSlot();
+        void releaseSlot(const size_t slot);
+        bool runOneAs(const size_t me);
+        bool pop(const size_t q, Task& task);
+        bool steal(const size_t q, Task& task);
+        void workerLoop(const size_t idx);
+        // Bind worker i to a CPU, returning false if that isn't possible
+        bool pinWorker(const size_t i);
+    };
+
+    class ThreadPool::Participant
+    {
+    public:
+        explicit Participant(ThreadPool& pool);
+        ~Participant();
+
+        Participant(const Participant&) = delete;
+        Participant& operator=(const Participant&) = delete;
+
+    private:
+        // Data members
+        ThreadPool& pool_;
+        Membership membership_;
+        bool joined_;
+        // End data members
+    };
+
+    template<typename Pred>
+    void ThreadPool::helpUntil(Pred done) {
+        Participant participant(*this);
+        while (!done()) {
+            if (!runOne()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+}
+
+#endif // PARALLEL_THREADPOOL_H
@@ -0,0 +1,252 @@
+#include "Particles.h"
+#include "Parallel/ParallelRange.h"
+
+#include <algorithm>
+
+namespace Particles {
+
+template<size_t mD>
+ParticleSet<mD>::ParticleSet(const MeshPtr mesh, Parallel::ThreadPool& pool):
+    mesh_(mesh),
+    pool_(&pool),
+    nextId_(0),
+    sorted_(false),
+    sortInterval_(10),
+    stepsSinceSort_(0)
+{}
+
+template<size_t mD>
+void ParticleSet<mD>::add(const Point& p)
+{
+    for (size_t d=0; d<mD; d++) {
+        position_[d].push_back(p[d]);
+    }
+    ids_.push_back(nextId_++);
+    cells_.push_back(mesh_->locate(p));
+    sorted_ = false;
+}
+
+template<size_t mD>
+void ParticleSet<mD>::add(const std::vector<Point>& points)
+{
+    for (size_t d=0; d<mD; d++) {
+        position_[d].reserve(size() + points.size());
+    }
+    ids_.reserve(size() + points.size());
+    cells_.reserve(size() + points.size());
+    for (const Point& p : points) {
+        add(p);
+    }
+}
+
+template<size_t mD>
+void ParticleSet<mD>::sort()
+{
+    const Mesh<mD>& mesh = *mesh_;
+    const size_t nCells = mesh.numCells();
+    const size_t n = size();
+
+    // Cells, with nCells marking particles that have left the Mesh
+    Parallel::parallelFor(*pool_, 0, n,
+        [&](const size_t begin, const size_t end) {
+            for (size_t p=begin; p<end; p++) {
+                size_t idx = 0;
+                size_t stride = 1;
+                bool inside = true;
+                for (size_t d=0; d<mD; d++) {
+                    const double x = position_[d][p];
+                    inside = inside && x >= mesh.dimMin()[d]
+                                    && x <= mesh.dimMax()[d];
+                    idx += stride * mesh.locate(d, x);
+                    stride *= mesh.dimSizes()[d];
+                }
+                cells_[p] = inside ? mesh.storageIndex(idx) : nCells;
+            }
+        });
+
+    // Counting sort - stable, so the order within a cell is kept
+    binStart_.assign(nCells+2, 0);
+    for (size_t p=0; p<n; p++) {
+        binStart_[cells_[p]+1]++;
+    }
+    for (size_t c=0; c<=nCells; c++) {
+        binStart_[c+1] += binStart_[c];
+    }
+    std::vector<size_t> dest(n);
+    {
+        std::vector<size_t> next(binStart_.begin(), binStart_.end()-1);
+        for (size_t p=0; p<n; p++) {
+            dest[p] = next[cells_[p]]++;
+        }
+    }
+    const size_t kept = binStart_[nCells];
+
+    auto permute = [&](auto& v) {
+        std::remove_reference_t<decltype(v)> tmp(kept);
+        for (size_t p=0; p<n; p++) {
+            if (dest[p] < kept) {
+                tmp[dest[p]] = v[p];
+            }
+        }
+        v.swap(tmp);
+    };
+    for (size_t d=0; d<mD; d++) {
+        permute(position_[d]);
+    }
+    permute(ids_);
+    permute(cells_);
+    binStart_.pop_back();
+
+    sorted_ = true;
+    stepsSinceSort_ = 0;
+}
+
+template<size_t mD>
+void ParticleSet<mD>::blockVelocity(const vectorField& U,
+                                    const double* const* x, const size_t n,
+                                    double* const* vel) const
+{
+    constexpr size_t corners = size_t(1) << mD;
+    const Mesh<mD>& mesh = *mesh_;
+
+    // Bracketing centres and upper weights, per dimension across the block
+    size_t lo[mD][block];
+    double w[mD][block];
+    size_t base[block];
+    std::fill(base, base+n, 0);
+    std::array<size_t, mD> stride;
+    size_t s = 1;
+    for (size_t d=0; d<mD; d++) {
+        stride[d] = (mesh.dimSizes()[d] > 1 ? s : 0);
+        for (size_t k=0; k<n; k++) {
+            mesh.bracketCentres(d, x[d][k], lo[d][k], w[d][k]);
+            base[k] += s * lo[d][k];
+        }
+        s *= mesh.dimSizes()[d];
+    }
+
+    // Corners are found in lexicographic order and mapped to storage
+    std::array<std::array<size_t, block>, corners> cornerCell;
+    for (size_t corner=0; corner<corners; corner++) {
+        size_t offset = 0;
+        for (size_t d=0; d<mD; d++) {
+            offset += ((corner >> d) & 1) * stride[d];
+        }
+        for (size_t k=0; k<n; k++) {
+            cornerCell[corner][k] = base[k] + offset;
+        }
+        if (mesh.ordering() != CellOrdering::Lexicographic) {
+            for (size_t k=0; k<n; k++) {
+                cornerCell[corner][k] = mesh.storageIndex(cornerCell[corner][k]);
+            }
+        }
+    }
+
+    for (size_t c=0; c<mD; c++) {
+        const double* u = U.component(c).data();
+        double* out = vel[c];
+        std::fill(out, out+n, 0.0);
+        for (size_t corner=0; corner<corners; corner++) {
+            const size_t* cell = cornerCell[corner].data();
+            for (size_t k=0; k<n; k++) {
+                double wt = 1;
+                for (size_t d=0; d<mD; d++) {
+                    wt *= ((corner >> d) & 1) ? w[d][k] : 1 - w[d][k];
+                }
+                out[k] += wt * u[cell[k]];
+            }
+        }
+    }
+}
+
+template<size_t mD>
+void ParticleSet<mD>::interpolate(const vectorField& U, Components& vel) const
+{
+    const size_t n = size();
+    for (size_t d=0; d<mD; d++) {
+        vel[d].resize(n);
+    }
+    const size_t nBlocks = (n + block - 1)/block;
+    Parallel::parallelFor(*pool_, 0, nBlocks,
+        [&](const size_t begin, const size_t end) {
+            for (size_t b=begin; b<end; b++) {
+                const size_t p0 = b*block;
+                const double* xp[mD];
+                double* vp[mD];
+                for (size_t d=0; d<mD; d++) {
+                    xp[d] = position_[d].data() + p0;
+                    vp[d] = vel[d].data() + p0;
+                }
+                blockVelocity(U, xp, std::min(block, n-p0), vp);
+            }
+        }, Parallel::defaultGrain/block);
+}
+
+template<size_t mD>
+void ParticleSet<mD>::advect(const vectorField& U, const double dt,
+                             const integratorType type)
+{
+    // Classical explicit schemes where stage i is evaluated at
+    // x0 + c[i]*dt*k[i-1], and the update is x0 + dt*sum(b[i]*k[i])
+    static const std::vector<double> cEuler{0}, bEuler{1};
+    static const std::vector<double> cRK2{0, 0.5}, bRK2{0, 1};
+    static const std::vector<double> cRK4{0, 0.5, 0.5, 1},
+                                     bRK4{1./6, 1./3, 1./3, 1./6};
+    const std::vector<double>& c = (type == integratorType::Euler ? cEuler
+                                 : (type == integratorType::RK2 ? cRK2 : cRK4));
+    const std::vector<double>& b = (type == integratorType::Euler ? bEuler
+                                 : (type == integratorType::RK2 ? bRK2 : bRK4));
+
+    const size_t n = size();
+    const size_t nBlocks = (n + block - 1)/block;
+    Parallel::parallelFor(*pool_, 0, nBlocks,
+        [&](const size_t begin, const size_t end) {
+            double stage[mD][block], k[mD][block], acc[mD][block];
+            const double* sp[mD];
+            double* kp[mD];
+            for (size_t d=0; d<mD; d++) {
+                sp[d] = stage[d];
+                kp[d] = k[d];
+            }
+            for (size_t blk=begin; blk<end; blk++) {
+                const size_t p0 = blk*block;
+                const size_t m = std::min(block, n-p0);
+                for (size_t d=0; d<mD; d++) {
+                    std::fill(acc[d], acc[d]+m, 0.0);
+                    std::fill(k[d], k[d]+m, 0.0);
+                }
+                for (size_t i=0; i<c.size(); i++) {
+                    for (size_t d=0; d<mD; d++) {
+                        const double* x0 = position_[d].data() + p0;
+                        for (size_t q=0; q<m; q++) {
+                            stage[d][q] = x0[q] + c[i]*dt*k[d][q];
+                        }
+                    }
+                    blockVelocity(U, sp, m, kp);
+                    for (size_t d=0; d<mD; d++) {
+                        for (size_t q=0; q<m; q++) {
+                            acc[d][q] += b[i]*k[d][q];
+                        }
+                    }
+                }
+                for (size_t d=0; d<mD; d++) {
+                    double* x = position_[d].data() + p0;
+                    for (size_t q=0; q<m; q++) {
+                        x[q] += dt*acc[d][q];
+                    }
+                }
+            }
+        }, Parallel::defaultGrain/block);
+
+    sorted_ = false;
+    if (++stepsSinceSort_ >= sortInterval_) {
+        sort();
+    }
+}
+
+// Instantiate templates
+template class ParticleSet<1>;
+template class ParticleSet<2>;
+template class ParticleSet<3>;
+
+}
@@ -0,0 +1,108 @@
+/* ---------------------------------------------------------------------------
+ * Lagrangian tracer particles on a Mesh.
+ *
+ * Particles are stored as a structure of arrays (one position vector per
+ * dimension, plus a persistent id and the containing cell). sort() bins the
+ * particles by cell with a counting sort, so particles in the same cell are
+ * contiguous and interpolating a Field walks the cells in storage order.
+ * binBegin(c)..binBegin(c+1) is then the range of particles in cell c.
+ *
+ * Velocities are interpolated (bi/trilinearly, between cell centres) for
+ * blocks of particles at a time: the bracketing centres and weights are
+ * computed per dimension across the block, then each component is gathered
+ * from the 2^mD corners with the block index innermost.
+ *
+ * advect() integrates dx/dt = U(x) with the velocity Field frozen over the
+ * step, in parallel over blocks on a ThreadPool (the global one unless
+ * given), and re-sorts every sortInterval() steps.
+ * Particles which leave the Mesh are removed at the next sort.
+ * --------------------------------------------------------------------------*/
+
+#ifndef PARTICLES_PARTICLES_H
+#define PARTICLES_PARTICLES_H
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "DataStructures/Field.tpp"
+#include "Parallel/ThreadPool.h"
+
+namespace Particles
+{
+    enum class integratorType {
+        Euler,
+        RK2,            // Midpoint
+        RK4
+    };
+
+    template<size_t mD>
+    class ParticleSet
+    {
+        using MeshPtr = std::shared_ptr<const Mesh<mD>>;
+        using vectorField = Field<double, mD, mD>;
+
+    public:
+        using Point = std::array<double, mD>;
+        using Components = std::array<std::vector<double>, mD>;
+
+        // Particles are processed in blocks of this size
+        static constexpr size_t block = 64;
+
+        ParticleSet(const MeshPtr mesh,
+                    Parallel::ThreadPool& pool =
+                        Parallel::ThreadPool::global());
+
+        void add(const Point& p);
+        void add(const std::vector<Point>& points);
+
+        size_t size() const { return ids_.size(); }
+        const std::vector<double>& position(const size_t d) const {
+            assert(d < mD);
+            return position_[d];
+        }
+        // Ids are assigned in order of addition and follow the particles
+        // through sorting
+        const std::vector<size_t>& ids() const { return ids_; }
+        // Cell of every particle, up to date after sort()
+        const std::vector<size_t>& cells() const { return cells_; }
+
+        // Drop particles outside the Mesh, then bin the rest by cell
+        void sort();
+        bool isSorted() const { return sorted_; }
+        // First particle in cell c (c == numCells gives size()). Needs sort()
+        size_t binBegin(const size_t c) const {
+            assert(sorted_);
+            return binStart_[c];
+        }
+
+        size_t sortInterval() const { return sortInterval_; }
+        void setSortInterval(const size_t n) { sortInterval_ = n; }
+
+        // Velocity at every particle, vel[d][p]
+        void interpolate(const vectorField& U, Components& vel) const;
+
+        // Move every particle by one step of length dt
+        void advect(const vectorField& U, const double dt,
+                    const integratorType type = integratorType::RK2);
+
+    private:
+        MeshPtr mesh_;
+        Parallel::ThreadPool* pool_;
+        Components position_;
+        std::vector<size_t> ids_;
+        std::vector<size_t> cells_;
+        std::vector<size_t> binStart_;
+        size_t nextId_;
+        bool sorted_;
+        size_t sortInterval_;
+        size_t stepsSinceSort_;
+
+        // Velocity for n <= block particles with positions x[d][0..n)
+        void blockVelocity(const vectorField& U, const double* const* x,
+                           const size_t n, double* const* vel) const;
+    };
+}
+
+#endif // PARTICLES_PARTICLES_H
@@ -0,0 +1,310 @@
+#include "FFT.h"
+
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+#ifdef CFD_HAVE_FFTW3
+#include <fftw3.h>
+#endif
+
+namespace FFT
+{
+
+namespace {
+    constexpr double pi = 3.141592653589793238463;
+
+    size_t nextPow2(const size_t n) {
+        size_t m = 1;
+        while (m < n) {
+            m <<= 1;
+        }
+        return m;
+    }
+}
+
+Plan::Plan(const size_t n):
+    n_(n),
+    m_(n),
+    pow2_(n == nextPow2(n)),
+    fftwForward_(nullptr),
+    fftwBackward_(nullptr)
+{
+    assert(n > 0);
+#ifdef CFD_HAVE_FFTW3
+    {
+        // The planner is not thread safe, but plans are only built up front.
+        // FFTW_UNALIGNED allows execution on arbitrary caller buffers.
+        fftw_complex* tmp = fftw_alloc_complex(n_);
+        const unsigned flags = FFTW_ESTIMATE | FFTW_UNALIGNED;
+        fftwForward_ = fftw_plan_dft_1d(n_, tmp, tmp, FFTW_FORWARD, flags);
+        fftwBackward_ = fftw_plan_dft_1d(n_, tmp, tmp, FFTW_BACKWARD, flags);
+        fftw_free(tmp);
+        return;
+    }
+#endif
+    if (!pow2_) {
+        // Bluestein: a length-N transform as a circular convolution of
+        // length m >= 2N-1
+        m_ = nextPow2(2*n_ - 1);
+    }
+
+    twiddles_.resize(m_/2);
+    for (size_t j=0; j<m_/2; j++) {
+        const double theta = -2.0*pi*static_cast<double>(j)/m_;
+        twiddles_[j] = cplx(std::cos(theta), std::sin(theta));
+    }
+    bitRev_.resize(m_);
+    size_t bits = 0;
+    while ((size_t(1) << bits) < m_) {
+        bits++;
+    }
+    for (size_t i=0; i<m_; i++) {
+        size_t r = 0;
+        for (size_t b=0; b<bits; b++) {
+            r |= ((i >> b) & 1) << (bits-1-b);
+        }
+        bitRev_[i] = r;
+    }
+
+    if (!pow2_) {
+        chirp_.resize(n_);
+        for (size_t j=0; j<n_; j++) {
+            // Reduce j^2 modulo 2N to keep the argument small
+            const size_t jj = (j*j) % (2*n_);
+            const double theta = -pi*static_cast<double>(jj)/n_;
+            chirp_[j] = cplx(std::cos(theta), std::sin(theta));
+        }
+        chirpHat_.assign(m_, cplx());
+        chirpHat_[0] = std::conj(chirp_[0]);
+        for (size_t j=1; j<n_; j++) {
+            chirpHat_[j] = std::conj(chirp_[j]);
+            chirpHat_[m_-j] = std::conj(chirp_[j]);
+        }
+        radix2(chirpHat_.data(), false);
+    }
+}
+
+Plan::~Plan()
+{
+#ifdef CFD_HAVE_FFTW3
+    fftw_destroy_plan(static_cast<fftw_plan>(fftwForward_));
+    fftw_destroy_plan(static_cast<fftw_plan>(fftwBackward_));
+#endif
+}
+
+size_t Plan::scratchSize() const
+{
+#ifdef CFD_HAVE_FFTW3
+    return 0;
+#endif
+    return pow2_ ? 0 : m_;
+}
+
+void Plan::forward(cplx* data, cplx* scratch) const
+{
+#ifdef CFD_HAVE_FFTW3
+    (void)scratch;
+    fftw_complex* d = reinterpret_cast<fftw_complex*>(data);
+    fftw_execute_dft(static_cast<fftw_plan>(fftwForward_), d, d);
+    return;
+#endif
+    if (pow2_) {
+        radix2(data, false);
+    } else {
+        bluestein(data, scratch);
+    }
+}
+
+void Plan::inverse(cplx* data, cplx* scratch) const
+{
+    const double scale = 1.0/static_cast<double>(n_);
+#ifdef CFD_HAVE_FFTW3
+    (void)scratch;
+    fftw_complex* d = reinterpret_cast<fftw_complex*>(data);
+    fftw_execute_dft(static_cast<fftw_plan>(fftwBackward_), d, d);
+    for (size_t i=0; i<n_; i++) {
+        data[i] *= scale;
+    }
+    return;
+#endif
+    if (pow2_) {
+        radix2(data, true);
+        for (size_t i=0; i<n_; i++) {
+            data[i] *= scale;
+        }
+    } else {
+        // ifft(x) = conj(fft(conj(x)))/N
+        for (size_t i=0; i<n_; i++) {
+            data[i] = std::conj(data[i]);
+        }
+        bluestein(data, scratch);
+        for (size_t i=0; i<n_; i++) {
+            data[i] = std::conj(data[i]) * scale;
+        }
+    }
+}
+
+void Plan::radix2(cplx* data, const bool inverse) const
+{
+    // Iterative Cooley-Tukey over m_ points, unnormalised
+    for (size_t i=0; i<m_; i++) {
+        const size_t r = bitRev_[i];
+        if (i < r) {
+            std::swap(data[i], data[r]);
+        }
+    }
+    for (size_t len=2; len<=m_; len<<=1) {
+        const size_t half = len/2;
+        const size_t step = m_/len;
+        for (size_t start=0; start<m_; start+=len) {
+            for (size_t j=0; j<half; j++) {
+                const cplx w = inverse ? std::conj(twiddles_[j*step])
+                                       : twiddles_[j*step];
+                const cplx u = data[start+j];
+                const cplx v = data[start+j+half] * w;
+                data[start+j] = u + v;
+                data[start+j+half] = u - v;
+            }
+        }
+    }
+}
+
+void Plan::bluestein(cplx* data, cplx* scratch) const
+{
+    assert(scratch != nullptr);
+    cplx* a = scratch;
+    for (size_t j=0; j<n_; j++) {
+        a[j] = data[j] * chirp_[j];
+    }
+    std::fill(a+n_, a+m_, cplx());
+    radix2(a, false);
+    for (size_t j=0; j<m_; j++) {
+        a[j] *= chirpHat_[j];
+    }
+    radix2(a, true);
+    const double scale = 1.0/static_cast<double>(m_);
+    for (size_t k=0; k<n_; k++) {
+        data[k] = chirp_[k] * a[k] * scale;
+    }
+}
+
+
+LineTransform::LineTransform(const size_t n, const RealTransform type):
+    n_(n),
+    type_(type),
+    plan_(type == RealTransform::DFT ? n : 2*n)
+{
+    if (type_ != RealTransform::DFT) {
+        shift_.resize(n_);
+        for (size_t k=0; k<n_; k++) {
+            const double theta = -pi*static_cast<double>(k)/(2*n_);
+            shift_[k] = cplx(std::cos(theta), std::sin(theta));
+        }
+    }
+}
+
+size_t LineTransform::scratchSize() const
+{
+    if (type_ == RealTransform::DFT) {
+        return plan_.scratchSize();
+    }
+    return 2*n_ + plan_.scratchSize();
+}
+
+void LineTransform::forward(cplx* line, cplx* scratch) const
+{
+    switch (type_)
+    {
+        case RealTransform::DFT:
+            plan_.forward(line, scratch);
+        break;
+
+        case RealTransform::DCT:
+            dctForward(line, scratch, scratch + 2*n_);
+        break;
+
+        case RealTransform::DST:
+        {
+            // DST-II(x)_k = DCT-II((-1)^n x_n)_{N-1-k}
+            for (size_t j=1; j<n_; j+=2) {
+                line[j] = -line[j];
+            }
+            dctForward(line, scratch, scratch + 2*n_);
+            std::reverse(line, line + n_);
+        }
+        break;
+    }
+}
+
+void LineTransform::inverse(cplx* line, cplx* scratch) const
+{
+    switch (type_)
+    {
+        case RealTransform::DFT:
+            plan_.inverse(line, scratch);
+        break;
+
+        case RealTransform::DCT:
+            dctInverse(line, scratch, scratch + 2*n_);
+        break;
+
+        case RealTransform::DST:
+        {
+            std::reverse(line, line + n_);
+            dctInverse(line, scratch, scratch + 2*n_);
+            for (size_t j=1; j<n_; j+=2) {
+                line[j] = -line[j];
+            }
+        }
+        break;
+    }
+}
+
+double LineTransform::eigenvalue(const size_t k, const double h) const
+{
+    double s = 0;
+    switch (type_)
+    {
+        case RealTransform::DFT:
+            s = std::sin(pi*static_cast<double>(k)/n_);
+        break;
+        case RealTransform::DCT:
+            s = std::sin(pi*static_cast<double>(k)/(2*n_));
+        break;
+        case RealTransform::DST:
+            s = std::sin(pi*static_cast<double>(k+1)/(2*n_));
+        break;
+    }
+    return -4.0*s*s/(h*h);
+}
+
+void LineTransform::dctForward(cplx* line, cplx* ext, cplx* scratch) const
+{
+    // Even extension about the last face, then a length 2N DFT
+    for (size_t j=0; j<n_; j++) {
+        ext[j] = line[j];
+        ext[2*n_-1-j] = line[j];
+    }
+    plan_.forward(ext, scratch);
+    for (size_t k=0; k<n_; k++) {
+        line[k] = 0.5 * shift_[k] * ext[k];
+    }
+}
+
+void LineTransform::dctInverse(cplx* line, cplx* ext, cplx* scratch) const
+{
+    // DCT-III written as a length 2N inverse DFT
+    ext[0] = line[0];
+    ext[n_] = cplx();
+    for (size_t k=1; k<n_; k++) {
+        ext[k] = line[k] * std::conj(shift_[k]);
+        ext[2*n_-k] = line[k] * shift_[k];
+    }
+    plan_.inverse(ext, scratch);
+    for (size_t j=0; j<n_; j++) {
+        line[j] = 2.0 * ext[j];
+    }
+}
+
+}
@@ -0,0 +1,93 @@
+/* ---------------------------------------------------------------------------
+ * One dimensional complex FFT plans, plus the real-to-real (DCT-II/DST-II)
+ * transforms needed for cell-centred Neumann and Dirichlet boundaries.
+ *
+ * If FFTW3 was found at configure time (CFD_HAVE_FFTW3) the complex
+ * transforms are delegated to it, otherwise an in-tree radix-2 transform is
+ * used, with Bluestein's algorithm for lengths that are not powers of two.
+ *
+ * Plans are immutable once constructed and can be shared between threads -
+ * all temporary storage is passed in by the caller (see scratchSize()).
+ * --------------------------------------------------------------------------*/
+
+#ifndef SOLVERS_FFT_H
+#define SOLVERS_FFT_H
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+namespace FFT
+{
+    using cplx = std::complex<double>;
+
+    class Plan
+    {
+    public:
+        explicit Plan(const size_t n);
+        ~Plan();
+
+        Plan(const Plan&) = delete;
+        Plan& operator=(const Plan&) = delete;
+
+        size_t size() const { return n_; }
+        // Number of complex values of scratch space needed by a transform
+        size_t scratchSize() const;
+
+        // In-place, unnormalised forward transform: X_k = sum x_n e^{-2pi i kn/N}
+        void forward(cplx* data, cplx* scratch) const;
+        // In-place inverse transform, including the 1/N normalisation
+        void inverse(cplx* data, cplx* scratch) const;
+
+    private:
+        size_t n_;
+        size_t m_; // Power of two length used by the radix-2 kernel
+        bool pow2_;
+        std::vector<cplx> twiddles_;   // e^{-2 pi i j/m}, j < m/2
+        std::vector<size_t> bitRev_;
+        std::vector<cplx> chirp_;      // Bluestein only: e^{-i pi n^2/N}
+        std::vector<cplx> chirpHat_;   // Bluestein only: FFT of conj(chirp)
+        void* fftwForward_;
+        void* fftwBackward_;
+
+        void radix2(cplx* data, const bool inverse) const;
+        void bluestein(cplx* data, cplx* scratch) const;
+    };
+
+    enum class RealTransform {
+        DFT, // Periodic
+        DCT, // DCT-II,  homogeneous Neumann at the outer faces
+        DST  // DST-II,  homogeneous Dirichlet at the outer faces
+    };
+
+    // Transform of a single line along one dimension, of the type suited to
+    // the boundary condition. The data is held as complex so that lines which
+    // already passed through a DFT in another dimension can be processed.
+    class LineTransform
+    {
+    public:
+        LineTransform(const size_t n, const RealTransform type);
+
+        size_t size() const { return n_; }
+        RealTransform type() const { return type_; }
+        size_t scratchSize() const;
+
+        void forward(cplx* line, cplx* scratch) const;
+        void inverse(cplx* line, cplx* scratch) const;
+
+        // Eigenvalue of the second-order (3-point) discrete second derivative
+        // for mode k, for a uniform spacing h
+        double eigenvalue(const size_t k, const double h) const;
+
+    private:
+        size_t n_;
+        RealTransform type_;
+        Plan plan_; // length n for DFT, 2n for DCT/DST
+        std::vector<cplx> shift_; // e^{-i pi k/2n}, k < n
+
+        void dctForward(cplx* line, cplx* ext, cplx* scratch) const;
+        void dctInverse(cplx* line, cplx* ext, cplx* scratch) const;
+    };
+}
+
+#endif // SOLVERS_FFT_H
@@ -0,0 +1,281 @@
+#include "LineSolver.h"
+
+#include <cassert>
+#include <algorithm>
+
+#include "Parallel/ParallelRange.h"
+
+template<size_t mD>
+LineSolver<mD>::LineSolver(const MeshPtr mesh, const size_t dim,
+                           const TridiagonalCoeffs& coeffs,
+                           const Algorithm alg,
+                           Parallel::ThreadPool& pool):
+    mesh_(mesh),
+    dim_(dim),
+    N_(mesh->dimSizes()[dim]),
+    stride_(1),
+    pool_(&pool),
+    alg_(alg)
+{
+    assert(dim_ < mD);
+    assert(mesh_->ordering() == CellOrdering::Lexicographic);
+    assert(coeffs.diag.size() == N_);
+    assert(coeffs.lower.size() == N_ && coeffs.upper.size() == N_);
+    for (size_t d=0; d<dim_; d++) {
+        stride_ *= mesh_->dimSizes()[d];
+    }
+
+    if (alg_ == Algorithm::Auto) {
+        // Cyclic reduction only pays off when there are too few batches of
+        // lines to occupy every thread and the lines are long
+        const size_t numLines = mesh_->numCells() / N_;
+        const size_t numBatches = (numLines + lineBatch - 1) / lineBatch;
+        const bool fewBatches = numBatches < pool_->size();
+        alg_ = (fewBatches && N_ >= minCyclicReductionLength)
+                ? Algorithm::CyclicReduction : Algorithm::Thomas;
+    }
+
+    if (alg_ == Algorithm::Thomas) {
+        factorThomas(coeffs);
+    } else {
+        factorCyclicReduction(coeffs);
+    }
+}
+
+template<size_t mD>
+TridiagonalCoeffs LineSolver<mD>::implicitDiffusion(const Mesh<mD>& mesh,
+                                                    const size_t dim,
+                                                    const double dtKappa,
+                                                    const LineBoundary lo,
+                                                    const LineBoundary hi)
+{
+    const std::vector<double>& e = mesh.edges(dim);
+    const std::vector<double>& x = mesh.centres(dim);
+    const size_t N = x.size();
+    TridiagonalCoeffs co;
+    co.lower.assign(N, 0);
+    co.diag.assign(N, 1);
+    co.upper.assign(N, 0);
+    for (size_t i=0; i<N; i++) {
+        const double width = e[i+1] - e[i];
+        if (i > 0) {
+            co.lower[i] = -dtKappa / (width * (x[i] - x[i-1]));
+        } else if (lo == LineBoundary::Dirichlet) {
+            // Zero value on the face, half a cell from the centre
+            co.diag[i] += dtKappa / (width * (x[i] - e[i]));
+        }
+        if (i < N-1) {
+            co.upper[i] = -dtKappa / (width * (x[i+1] - x[i]));
+        } else if (hi == LineBoundary::Dirichlet) {
+            co.diag[i] += dtKappa / (width * (e[i+1] - x[i]));
+        }
+        co.diag[i] -= co.lower[i] + co.upper[i];
+    }
+    return co;
+}
+
+template<size_t mD>
+void LineSolver<mD>::factorThomas(const TridiagonalCoeffs& coeffs)
+{
+    cPrime_.resize(N_);
+    invPivot_.resize(N_);
+    lower_ = coeffs.lower;
+    lower_[0] = 0;
+    double prevC = 0;
+    for (size_t j=0; j<N_; j++) {
+        const double pivot = coeffs.diag[j] - lower_[j]*prevC;
+        assert(pivot != 0);
+        invPivot_[j] = 1.0/pivot;
+        cPrime_[j] = (j < N_-1 ? coeffs.upper[j] : 0) * invPivot_[j];
+        prevC = cPrime_[j];
+    }
+}
+
+template<size_t mD>
+void LineSolver<mD>::factorCyclicReduction(const TridiagonalCoeffs& coeffs)
+{
+    std::vector<double> a = coeffs.lower, b = coeffs.diag, c = coeffs.upper;
+    a[0] = 0;
+    c[N_-1] = 0;
+    std::vector<double> na(N_), nb(N_), nc(N_);
+    for (size_t s=1; s<N_; s*=2) {
+        std::vector<double> alpha(N_, 0), gamma(N_, 0);
+        for (size_t i=0; i<N_; i++) {
+            nb[i] = b[i];
+            na[i] = 0;
+            nc[i] = 0;
+            if (i >= s) {
+                alpha[i] = -a[i]/b[i-s];
+                na[i] = alpha[i]*a[i-s];
+                nb[i] += alpha[i]*c[i-s];
+            }
+            if (i+s < N_) {
+                gamma[i] = -c[i]/b[i+s];
+                nc[i] = gamma[i]*c[i+s];
+                nb[i] += gamma[i]*a[i+s];
+            }
+        }
+        std::swap(a, na);
+        std::swap(b, nb);
+        std::swap(c, nc);
+        pcrAlpha_.push_back(std::move(alpha));
+        pcrGamma_.push_back(std::move(gamma));
+    }
+    pcrInvDiag_.resize(N_);
+    for (size_t i=0; i<N_; i++) {
+        pcrInvDiag_[i] = 1.0/b[i];
+    }
+}
+
+template<size_t mD>
+void LineSolver<mD>::thomasBatch(double* x, const size_t rowStride,
+                                 const size_t nb) const
+{
+    for (size_t b=0; b<nb; b++) {
+        x[b] *= invPivot_[0];
+    }
+    for (size_t j=1; j<N_; j++) {
+        double* row = x + j*rowStride;
+        const double* prev = row - rowStride;
+        const double a = lower_[j];
+        const double inv = invPivot_[j];
+        for (size_t b=0; b<nb; b++) {
+            row[b] = (row[b] - a*prev[b]) * inv;
+        }
+    }
+    for (size_t j=N_-1; j-- > 0; ) {
+        double* row = x + j*rowStride;
+        const double* next = row + rowStride;
+        const double c = cPrime_[j];
+        for (size_t b=0; b<nb; b++) {
+            row[b] -= c*next[b];
+        }
+    }
+}
+
+template<size_t mD>
+void LineSolver<mD>::cyclicReductionBatch(double* x, double* tmp,
+                                          const size_t rowStride,
+                                          const size_t nb) const
+{
+    // Ping-pong between two contiguous buffers of N*nb values
+    double* src = tmp;
+    double* dst = tmp + N_*nb;
+    for (size_t j=0; j<N_; j++) {
+        std::copy(x + j*rowStride, x + j*rowStride + nb, src + j*nb);
+    }
+    size_t s = 1;
+    for (size_t level=0; level<pcrAlpha_.size(); level++, s*=2) {
+        const std::vector<double>& alpha = pcrAlpha_[level];
+        const std::vector<double>& gamma = pcrGamma_[level];
+        Parallel::parallelFor(*pool_, 0, N_,
+            [&](const size_t begin, const size_t end) {
+            for (size_t i=begin; i<end; i++) {
+                double* out = dst + i*nb;
+                const double* in = src + i*nb;
+                std::copy(in, in + nb, out);
+                if (i >= s) {
+                    const double* lo = src + (i-s)*nb;
+                    const double al = alpha[i];
+                    for (size_t b=0; b<nb; b++) {
+                        out[b] += al*lo[b];
+                    }
+                }
+                if (i+s < N_) {
+                    const double* hi = src + (i+s)*nb;
+                    const double ga = gamma[i];
+                    for (size_t b=0; b<nb; b++) {
+                        out[b] += ga*hi[b];
+                    }
+                }
+            }
+        }, std::max<size_t>(1, Parallel::defaultGrain/nb));
+        std::swap(src, dst);
+    }
+    for (size_t j=0; j<N_; j++) {
+        double* row = x + j*rowStride;
+        const double* in = src + j*nb;
+        const double inv = pcrInvDiag_[j];
+        for (size_t b=0; b<nb; b++) {
+            row[b] = in[b]*inv;
+        }
+    }
+}
+
+template<size_t mD>
+void LineSolver<mD>::solve(std::vector<double>& values) const
+{
+    assert(values.size() == mesh_->numCells());
+    const size_t numOuter = values.size() / (N_*stride_);
+    // Along dim 0 a unit is a batch of whole lines, transposed into scratch.
+    // Otherwise a unit is a batch of neighbouring lines within one outer slab.
+    const bool transpose = (stride_ == 1);
+    const size_t numLines = values.size() / N_;
+    const size_t blocksPerOuter = (stride_ + lineBatch - 1) / lineBatch;
+    const size_t numUnits = transpose
+            ? (numLines + lineBatch - 1) / lineBatch
+            : numOuter * blocksPerOuter;
+    const bool pcr = (alg_ == Algorithm::CyclicReduction);
+
+    // Thomas spreads units over threads, PCR spreads each level instead
+    const size_t nT = pcr ? 1 : pool_->numSlots();
+    const size_t scratchPerThread = (transpose ? N_*lineBatch : 0)
+                                  + (pcr ? 2*N_*lineBatch : 0);
+    std::vector<double> scratch(nT * scratchPerThread);
+
+    auto solveUnits = [&](const size_t begin, const size_t end) {
+        const size_t t = pcr ? 0 : pool_->threadIndex();
+        double* buf = scratch.data() + t*scratchPerThread;
+        double* pcrBuf = buf + (transpose ? N_*lineBatch : 0);
+        for (size_t u=begin; u<end; u++) {
+            double* x;
+            size_t rowStride, nb;
+            if (transpose) {
+                const size_t l0 = u*lineBatch;
+                nb = std::min(lineBatch, numLines - l0);
+                for (size_t b=0; b<nb; b++) {
+                    const double* line = values.data() + (l0+b)*N_;
+                    for (size_t j=0; j<N_; j++) {
+                        buf[j*nb + b] = line[j];
+                    }
+                }
+                x = buf;
+                rowStride = nb;
+            } else {
+                const size_t outer = u / blocksPerOuter;
+                const size_t i0 = (u % blocksPerOuter) * lineBatch;
+                nb = std::min(lineBatch, stride_ - i0);
+                x = values.data() + outer*N_*stride_ + i0;
+                rowStride = stride_;
+            }
+
+            if (pcr) {
+                cyclicReductionBatch(x, pcrBuf, rowStride, nb);
+            } else {
+                thomasBatch(x, rowStride, nb);
+            }
+
+            if (transpose) {
+                const size_t l0 = u*lineBatch;
+                for (size_t b=0; b<nb; b++) {
+                    double* line = values.data() + (l0+b)*N_;
+                    for (size_t j=0; j<N_; j++) {
+                        line[j] = buf[j*nb + b];
+                    }
+                }
+            }
+        }
+    };
+    if (pcr) {
+        solveUnits(0, numUnits);
+    } else {
+        // Units per piece, so that a piece holds about defaultGrain cells
+        Parallel::parallelFor(*pool_, 0, numUnits, solveUnits,
+            std::max<size_t>(1, Parallel::defaultGrain/(N_*lineBatch)));
+    }
+}
+
+// Instantiate solver templates
+template class LineSolver<1>;
+template class LineSolver<2>;
+template class LineSolver<3>;
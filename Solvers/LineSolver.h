@@ -0,0 +1,115 @@
+/* ---------------------------------------------------------------------------
+ * Batched tridiagonal solves along one dimension of a Mesh, as needed by
+ * ADI / implicit diffusion schemes.
+ *
+ * Every line along dimension d shares the same coefficients (they depend
+ * only on the position along the line), so the elimination factors are
+ * computed once at construction and each solve is a pair of sweeps.
+ *
+ * Lines are processed in batches of 'lineBatch' neighbouring lines with the
+ * innermost loop running across the batch, so the sweeps vectorise across
+ * lines rather than within them. Along dimension 0 the batch is transposed
+ * into scratch first; along other dimensions neighbouring lines are already
+ * adjacent in memory and the solve runs in place.
+ *
+ * Two algorithms are available:
+ *  Thomas          - O(N), sequential along the line. Best for lines that
+ *                    fit in cache, and whenever there are enough batches of
+ *                    lines to keep all threads busy.
+ *  CyclicReduction - parallel cyclic reduction, O(N log N) but each level is
+ *                    a data-parallel sweep, so a few long lines can be
+ *                    split between threads.
+ *
+ * Work is shared over a ThreadPool, the global one unless given.
+ * --------------------------------------------------------------------------*/
+
+#ifndef SOLVERS_LINESOLVER_H
+#define SOLVERS_LINESOLVER_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "DataStructures/Field.tpp"
+#include "Parallel/ThreadPool.h"
+
+// Homogeneous boundary conditions at the first/last face of a line
+enum class LineBoundary {
+    Dirichlet,
+    Neumann
+};
+
+// a_i x_{i-1} + b_i x_i + c_i x_{i+1} = rhs_i  (lower[0], upper[N-1] unused)
+struct TridiagonalCoeffs
+{
+    std::vector<double> lower;
+    std::vector<double> diag;
+    std::vector<double> upper;
+};
+
+template<size_t mD>
+class LineSolver
+{
+    using MeshPtr = std::shared_ptr<const Mesh<mD>>;
+
+public:
+    enum class Algorithm {
+        Auto,
+        Thomas,
+        CyclicReduction
+    };
+
+    static constexpr size_t lineBatch = 8;
+    // Lines shorter than this always use Thomas under Algorithm::Auto
+    static constexpr size_t minCyclicReductionLength = 1024;
+
+    LineSolver(const MeshPtr mesh, const size_t dim,
+               const TridiagonalCoeffs& coeffs,
+               const Algorithm alg = Algorithm::Auto,
+               Parallel::ThreadPool& pool = Parallel::ThreadPool::global());
+
+    // Finite volume coefficients of (I - dtKappa * d2/dx_dim^2), using the
+    // cell widths and centre spacings of the (possibly stretched) mesh
+    static TridiagonalCoeffs implicitDiffusion(const Mesh<mD>& mesh,
+                                               const size_t dim,
+                                               const double dtKappa,
+                                               const LineBoundary lo,
+                                               const LineBoundary hi);
+
+    // Solve every line along dim in place. values has numCells entries in
+    // the Mesh's storage order.
+    void solve(std::vector<double>& values) const;
+
+    template<size_t fD>
+    void solve(Field<double, fD, mD>& field, const size_t component) const {
+        assert(field.mesh() == *mesh_);
+        solve(field.component(component));
+    }
+
+    size_t dim() const { return dim_; }
+    Algorithm algorithm() const { return alg_; }
+
+private:
+    MeshPtr mesh_;
+    size_t dim_;
+    size_t N_;
+    size_t stride_;
+    Parallel::ThreadPool* pool_;
+    Algorithm alg_;
+
+    // Thomas: modified upper diagonal and reciprocal pivots
+    std::vector<double> cPrime_, invPivot_, lower_;
+    // PCR: per level multipliers for the i-s and i+s rows, final 1/b
+    std::vector<std::vector<double>> pcrAlpha_, pcrGamma_;
+    std::vector<double> pcrInvDiag_;
+
+    void factorThomas(const TridiagonalCoeffs& coeffs);
+    void factorCyclicReduction(const TridiagonalCoeffs& coeffs);
+
+    // x[j*rowStride + b], j < N, b < nb
+    void thomasBatch(double* x, const size_t rowStride, const size_t nb) const;
+    void cyclicReductionBatch(double* x, double* tmp, const size_t rowStride,
+                              const size_t nb) const;
+};
+
+#endif // SOLVERS_LINESOLVER_H
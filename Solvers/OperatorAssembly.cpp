@@ -0,0 +1,267 @@
+#include "OperatorAssembly.h"
+
+#include <cassert>
+#include <algorithm>
+
+#include "Parallel/ParallelRange.h"
+
+namespace {
+    // Add val at col, keeping the row sorted by column
+    template<typename Row>
+    void addEntry(Row& row, const size_t col, const double val) {
+        size_t k = 0;
+        while (k < row.n && row.col[k] < col) {
+            k++;
+        }
+        if (k < row.n && row.col[k] == col) {
+            row.val[k] += val;
+            return;
+        }
+        assert(row.n < row.col.size());
+        for (size_t j=row.n; j>k; j--) {
+            row.col[j] = row.col[j-1];
+            row.val[j] = row.val[j-1];
+        }
+        row.col[k] = col;
+        row.val[k] = val;
+        row.n++;
+    }
+}
+
+template<size_t mD>
+OperatorAssembler<mD>::OperatorAssembler(const MeshPtr mesh,
+                                         const MeshBoundaries<mD>& bcs,
+                                         Parallel::ThreadPool& pool):
+    mesh_(mesh),
+    bcs_(bcs),
+    pool_(&pool),
+    N_(mesh->numCells()),
+    patterns_(std::make_shared<PatternCache>())
+{
+    assert(mesh_->ordering() == CellOrdering::Lexicographic);
+    size_t s = 1;
+    for (size_t d=0; d<mD; d++) {
+        stride_[d] = s;
+        s *= mesh_->dimSizes()[d];
+    }
+}
+
+template<size_t mD>
+void OperatorAssembler<mD>::gradientRow(const size_t cell, const size_t d,
+                                        const size_t off,
+                                        StencilRow& row) const
+{
+    const MeshMetrics& m = mesh_->metrics(d);
+    const size_t N = mesh_->dimSizes()[d];
+    const size_t i = indexAlong(cell, d);
+    const double invW = m.invWidth[i];
+
+    // Diagonal always present so that the pattern is mesh independent
+    addEntry(row, off + cell, 0);
+    if (i > 0) {
+        const double lam = m.faceWeight[i];
+        addEntry(row, off + cell - stride_[d], -(1-lam)*invW);
+        addEntry(row, off + cell, -lam*invW);
+    } else if (bcs_.lower[d] == LineBoundary::Neumann) {
+        addEntry(row, off + cell, -invW);
+    }
+    if (i < N-1) {
+        const double lam = m.faceWeight[i+1];
+        addEntry(row, off + cell, (1-lam)*invW);
+        addEntry(row, off + cell + stride_[d], lam*invW);
+    } else if (bcs_.upper[d] == LineBoundary::Neumann) {
+        addEntry(row, off + cell, invW);
+    }
+}
+
+template<size_t mD>
+void OperatorAssembler<mD>::diffusionRow(const size_t cell,
+                                         const double* kappa,
+                                         const double shift,
+                                         StencilRow& row) const
+{
+    addEntry(row, cell, shift);
+    for (size_t d=0; d<mD; d++) {
+        const MeshMetrics& m = mesh_->metrics(d);
+        const size_t N = mesh_->dimSizes()[d];
+        const size_t i = indexAlong(cell, d);
+        const double invW = m.invWidth[i];
+        const double k = (kappa ? kappa[cell] : 1.0);
+
+        if (i > 0) {
+            const size_t nb = cell - stride_[d];
+            const double lam = m.faceWeight[i];
+            const double kf = kappa ? (1-lam)*kappa[nb] + lam*k : 1.0;
+            const double coef = kf*invW*m.invCentreSpacing[i];
+            addEntry(row, nb, coef);
+            addEntry(row, cell, -coef);
+        } else if (bcs_.lower[d] == LineBoundary::Dirichlet) {
+            addEntry(row, cell, -k*invW*m.invCentreSpacing[i]);
+        }
+        if (i < N-1) {
+            const size_t nb = cell + stride_[d];
+            const double lam = m.faceWeight[i+1];
+            const double kf = kappa ? (1-lam)*k + lam*kappa[nb] : 1.0;
+            const double coef = kf*invW*m.invCentreSpacing[i+1];
+            addEntry(row, nb, coef);
+            addEntry(row, cell, -coef);
+        } else if (bcs_.upper[d] == LineBoundary::Dirichlet) {
+            addEntry(row, cell, -k*invW*m.invCentreSpacing[i+1]);
+        }
+    }
+}
+
+template<size_t mD>
+template<typename RowFn>
+typename OperatorAssembler<mD>::PatternPtr
+OperatorAssembler<mD>::buildPattern(const size_t rows, const size_t cols,
+                                    RowFn&& rowFn) const
+{
+    auto p = std::make_shared<SparsityPattern>();
+    p->rows = rows;
+    p->cols = cols;
+    p->rowPtr.assign(rows+1, 0);
+
+    // Count, prefix sum, then fill - each pass is independent per row
+    Parallel::parallelFor(*pool_, 0, rows,
+        [&](const size_t begin, const size_t end) {
+        StencilRow row;
+        for (size_t r=begin; r<end; r++) {
+            row.n = 0;
+            rowFn(r, row);
+            p->rowPtr[r+1] = row.n;
+        }
+    });
+    for (size_t r=0; r<rows; r++) {
+        p->rowPtr[r+1] += p->rowPtr[r];
+    }
+    p->colIdx.resize(p->rowPtr[rows]);
+    Parallel::parallelFor(*pool_, 0, rows,
+        [&](const size_t begin, const size_t end) {
+        StencilRow row;
+        for (size_t r=begin; r<end; r++) {
+            row.n = 0;
+            rowFn(r, row);
+            std::copy(row.col.begin(), row.col.begin() + row.n,
+                      p->colIdx.begin() + p->rowPtr[r]);
+        }
+    });
+    return p;
+}
+
+template<size_t mD>
+template<typename RowFn>
+const typename OperatorAssembler<mD>::PatternPtr&
+OperatorAssembler<mD>::cachedPattern(std::once_flag& once, PatternPtr& p,
+                                     const size_t rows, const size_t cols,
+                                     RowFn&& rowFn) const
+{
+    std::call_once(once, [&]() { p = buildPattern(rows, cols, rowFn); });
+    return p;
+}
+
+template<size_t mD>
+const typename OperatorAssembler<mD>::PatternPtr&
+OperatorAssembler<mD>::laplacianPattern() const
+{
+    return cachedPattern(patterns_->lapOnce, patterns_->lap, N_, N_,
+        [this](const size_t r, StencilRow& row) {
+            diffusionRow(r, nullptr, 0, row);
+        });
+}
+
+template<size_t mD>
+template<typename RowFn>
+void OperatorAssembler<mD>::fillValues(CSRMatrix& A, RowFn&& rowFn) const
+{
+    const SparsityPattern& p = A.pattern();
+    std::vector<double>& vals = A.values();
+    Parallel::parallelFor(*pool_, 0, p.rows,
+        [&](const size_t begin, const size_t end) {
+        StencilRow row;
+        for (size_t r=begin; r<end; r++) {
+            row.n = 0;
+            rowFn(r, row);
+            assert(row.n == p.rowLength(r));
+            assert(std::equal(row.col.begin(), row.col.begin() + row.n,
+                              p.colIdx.begin() + p.rowPtr[r]));
+            std::copy(row.val.begin(), row.val.begin() + row.n,
+                      vals.begin() + p.rowPtr[r]);
+        }
+    });
+}
+
+template<size_t mD>
+CSRMatrix OperatorAssembler<mD>::gradient(const size_t dim) const
+{
+    assert(dim < mD);
+    auto rowFn = [this, dim](const size_t r, StencilRow& row) {
+        gradientRow(r, dim, 0, row);
+    };
+    CSRMatrix A(cachedPattern(patterns_->gradOnce[dim], patterns_->grad[dim],
+                              N_, N_, rowFn));
+    fillValues(A, rowFn);
+    return A;
+}
+
+template<size_t mD>
+CSRMatrix OperatorAssembler<mD>::gradient() const
+{
+    auto rowFn = [this](const size_t r, StencilRow& row) {
+        gradientRow(r % N_, r / N_, 0, row);
+    };
+    CSRMatrix A(cachedPattern(patterns_->fullGradOnce, patterns_->fullGrad,
+                              mD*N_, N_, rowFn));
+    fillValues(A, rowFn);
+    return A;
+}
+
+template<size_t mD>
+CSRMatrix OperatorAssembler<mD>::divergence() const
+{
+    auto rowFn = [this](const size_t r, StencilRow& row) {
+        for (size_t d=0; d<mD; d++) {
+            gradientRow(r, d, d*N_, row);
+        }
+    };
+    CSRMatrix A(cachedPattern(patterns_->divOnce, patterns_->div,
+                              N_, mD*N_, rowFn));
+    fillValues(A, rowFn);
+    return A;
+}
+
+template<size_t mD>
+CSRMatrix OperatorAssembler<mD>::laplacian() const
+{
+    CSRMatrix A(laplacianPattern());
+    fillValues(A, [this](const size_t r, StencilRow& row) {
+        diffusionRow(r, nullptr, 0, row);
+    });
+    return A;
+}
+
+template<size_t mD>
+CSRMatrix OperatorAssembler<mD>::diffusion(const scalarField& kappa,
+                                           const double shift) const
+{
+    CSRMatrix A(laplacianPattern());
+    diffusion(kappa, shift, A);
+    return A;
+}
+
+template<size_t mD>
+void OperatorAssembler<mD>::diffusion(const scalarField& kappa,
+                                      const double shift,
+                                      CSRMatrix& A) const
+{
+    assert(kappa.mesh() == *mesh_);
+    const double* k = kappa.x().data();
+    fillValues(A, [this, k, shift](const size_t r, StencilRow& row) {
+        diffusionRow(r, k, shift, row);
+    });
+}
+
+// Instantiate assembler templates
+template class OperatorAssembler<1>;
+template class OperatorAssembler<2>;
+template class OperatorAssembler<3>;
@@ -0,0 +1,124 @@
+/* ---------------------------------------------------------------------------
+ * Assembly of the finite volume gradient, divergence and Laplacian stencils
+ * on a Mesh<mD> into sparse matrices.
+ *
+ * Face values are linearly interpolated between neighbouring cell centres,
+ * so the stencils are second-order on stretched meshes as well. Boundary
+ * faces are homogeneous Dirichlet (zero face value) or Neumann (zero normal
+ * gradient), set per side of each dimension.
+ *
+ * Sparsity patterns depend only on the Mesh and boundaries: they are built
+ * once per operator (thread safely), cached by the assembler, and shared by
+ * every matrix it returns. Coefficient-only changes (e.g. a new diffusivity
+ * each step) refill the values of an existing matrix in place. An assembler
+ * may be shared between threads, eg by the cases of a CaseRunner.
+ *
+ * Rows are assembled in parallel - a counting pass sizes each row, then
+ * every row is written independently.
+ * --------------------------------------------------------------------------*/
+
+#ifndef SOLVERS_OPERATORASSEMBLY_H
+#define SOLVERS_OPERATORASSEMBLY_H
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+#include "DataStructures/Field.tpp"
+#include "LineSolver.h"
+#include "SparseMatrix.h"
+
+template<size_t mD>
+struct MeshBoundaries
+{
+    std::array<LineBoundary, mD> lower;
+    std::array<LineBoundary, mD> upper;
+
+    static MeshBoundaries<mD> all(const LineBoundary b) {
+        MeshBoundaries<mD> bcs;
+        bcs.lower.fill(b);
+        bcs.upper.fill(b);
+        return bcs;
+    }
+};
+
+template<size_t mD>
+class OperatorAssembler
+{
+    using MeshPtr = std::shared_ptr<const Mesh<mD>>;
+    using PatternPtr = std::shared_ptr<const SparsityPattern>;
+    using scalarField = Field<double, 1, mD>;
+
+public:
+    // Largest number of entries in any assembled row
+    static constexpr size_t maxRowLength = 3*mD;
+
+    struct StencilRow
+    {
+        size_t n;
+        std::array<size_t, maxRowLength> col;
+        std::array<double, maxRowLength> val;
+    };
+
+    // Rows are assembled in parallel on pool
+    OperatorAssembler(const MeshPtr mesh, const MeshBoundaries<mD>& bcs,
+                      Parallel::ThreadPool& pool =
+                          Parallel::ThreadPool::global());
+
+    // d(phi)/dx_dim as an N x N matrix
+    CSRMatrix gradient(const size_t dim) const;
+    // Full gradient, (mD*N) x N, rows ordered component by component
+    CSRMatrix gradient() const;
+    // Divergence of a vector field, N x (mD*N)
+    CSRMatrix divergence() const;
+    // div(grad(phi)), N x N
+    CSRMatrix laplacian() const;
+    // div(kappa grad(phi)) + shift*phi, on the Laplacian's pattern
+    CSRMatrix diffusion(const scalarField& kappa, const double shift = 0) const;
+    // As above, overwriting the values of a matrix from laplacian()/diffusion()
+    void diffusion(const scalarField& kappa, const double shift,
+                   CSRMatrix& A) const;
+
+    const Mesh<mD>& mesh() const { return *mesh_; }
+
+private:
+    MeshPtr mesh_;
+    MeshBoundaries<mD> bcs_;
+    Parallel::ThreadPool* pool_;
+    size_t N_;
+    std::array<size_t, mD> stride_;
+    // Lazily built, cached patterns (shared by copies, which have the
+    // same Mesh and boundaries)
+    struct PatternCache {
+        std::array<std::once_flag, mD> gradOnce;
+        std::once_flag fullGradOnce, divOnce, lapOnce;
+        std::array<PatternPtr, mD> grad;
+        PatternPtr fullGrad, div, lap;
+    };
+    std::shared_ptr<PatternCache> patterns_;
+
+    size_t indexAlong(const size_t cell, const size_t d) const {
+        return (cell / stride_[d]) % mesh_->dimSizes()[d];
+    }
+
+    // Gauss gradient along d of cell 'cell', written at column offset 'off'
+    void gradientRow(const size_t cell, const size_t d, const size_t off,
+                     StencilRow& row) const;
+    void diffusionRow(const size_t cell, const double* kappa,
+                      const double shift, StencilRow& row) const;
+
+    template<typename RowFn>
+    PatternPtr buildPattern(const size_t rows, const size_t cols,
+                            RowFn&& rowFn) const;
+    // The pattern in p, built on first use (once, thread safely)
+    template<typename RowFn>
+    const PatternPtr& cachedPattern(std::once_flag& once, PatternPtr& p,
+                                    const size_t rows, const size_t cols,
+                                    RowFn&& rowFn) const;
+    const PatternPtr& laplacianPattern() const;
+    template<typename RowFn>
+    void fillValues(CSRMatrix& A, RowFn&& rowFn) const;
+};
+
+#endif // SOLVERS_OPERATORASSEMBLY_H
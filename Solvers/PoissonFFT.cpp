@@ -0,0 +1,167 @@
+#include "PoissonFFT.h"
+
+#include <cassert>
+#include <algorithm>
+
+#include "Parallel/ParallelRange.h"
+
+namespace {
+    // Number of neighbouring lines gathered together when transforming along
+    // a strided dimension, so that each row of the gather is a contiguous read
+    constexpr size_t lineBatch = 8;
+
+    FFT::RealTransform transformFor(const SpectralBoundary bc) {
+        switch (bc)
+        {
+            case SpectralBoundary::Neumann:
+                return FFT::RealTransform::DCT;
+            case SpectralBoundary::Dirichlet:
+                return FFT::RealTransform::DST;
+            case SpectralBoundary::Periodic:
+            default:
+                return FFT::RealTransform::DFT;
+        }
+    }
+}
+
+template<size_t mD>
+FFTPoissonSolver<mD>::FFTPoissonSolver(const MeshPtr mesh,
+                                       const std::array<SpectralBoundary, mD>& bcs,
+                                       const double alpha,
+                                       Parallel::ThreadPool& pool):
+    mesh_(mesh),
+    bcs_(bcs),
+    alpha_(alpha),
+    pool_(&pool)
+{
+    assert(isApplicable(*mesh_));
+    assert(mesh_->ordering() == CellOrdering::Lexicographic);
+    size_t stride = 1;
+    for (size_t d=0; d<mD; d++) {
+        const size_t N = mesh_->dimSizes()[d];
+        const double h = (mesh_->dimMax()[d] - mesh_->dimMin()[d]) / N;
+        transforms_[d].reset(new FFT::LineTransform(N, transformFor(bcs_[d])));
+        eigen_[d].resize(N);
+        for (size_t k=0; k<N; k++) {
+            eigen_[d][k] = transforms_[d]->eigenvalue(k, h);
+        }
+        stride_[d] = stride;
+        stride *= N;
+    }
+}
+
+template<size_t mD>
+void FFTPoissonSolver<mD>::solve(const scalarField& rhs, scalarField& phi) const
+{
+    assert(rhs.mesh() == *mesh_);
+    assert(phi.mesh() == *mesh_);
+    const std::vector<double>& f = rhs.x();
+    std::vector<cplx> work(f.begin(), f.end());
+
+    for (size_t d=0; d<mD; d++) {
+        transformDim(work, d, true);
+    }
+    divideByEigenvalues(work);
+    for (size_t d=mD; d-- > 0; ) {
+        transformDim(work, d, false);
+    }
+
+    std::vector<double>& out = phi.x();
+    for (size_t i=0; i<work.size(); i++) {
+        out[i] = work[i].real();
+    }
+}
+
+template<size_t mD>
+void FFTPoissonSolver<mD>::transformDim(std::vector<cplx>& work,
+                                        const size_t d,
+                                        const bool forward) const
+{
+    const FFT::LineTransform& tr = *transforms_[d];
+    const size_t N = tr.size();
+    const size_t stride = stride_[d];
+    const size_t numOuter = work.size() / (N*stride);
+    // Lines with the same outer index and neighbouring inner indices are
+    // batched together. Along dimension 0 lines are already contiguous.
+    const size_t batch = (stride == 1 ? 1 : std::min(lineBatch, stride));
+    const size_t blocksPerOuter = (stride + batch - 1) / batch;
+    const size_t numUnits = numOuter * blocksPerOuter;
+
+    const size_t scratchPerThread = batch*N + tr.scratchSize();
+    std::vector<cplx> scratch(pool_->numSlots() * scratchPerThread);
+    // Units per piece, so that a piece holds about defaultGrain values
+    const size_t grain = std::max<size_t>(1, Parallel::defaultGrain/(batch*N));
+
+    Parallel::parallelFor(*pool_, 0, numUnits,
+        [&](const size_t begin, const size_t end) {
+        cplx* lines = scratch.data() + pool_->threadIndex()*scratchPerThread;
+        cplx* trScratch = lines + batch*N;
+        for (size_t u=begin; u<end; u++) {
+            const size_t outer = u / blocksPerOuter;
+            const size_t i0 = (u % blocksPerOuter) * batch;
+            const size_t nb = std::min(batch, stride - i0);
+            cplx* base = work.data() + outer*N*stride + i0;
+
+            if (stride == 1) {
+                if (forward) {
+                    tr.forward(base, trScratch);
+                } else {
+                    tr.inverse(base, trScratch);
+                }
+                continue;
+            }
+            // Gather nb strided lines into contiguous storage
+            for (size_t j=0; j<N; j++) {
+                const cplx* row = base + j*stride;
+                for (size_t b=0; b<nb; b++) {
+                    lines[b*N + j] = row[b];
+                }
+            }
+            for (size_t b=0; b<nb; b++) {
+                if (forward) {
+                    tr.forward(lines + b*N, trScratch);
+                } else {
+                    tr.inverse(lines + b*N, trScratch);
+                }
+            }
+            for (size_t j=0; j<N; j++) {
+                cplx* row = base + j*stride;
+                for (size_t b=0; b<nb; b++) {
+                    row[b] = lines[b*N + j];
+                }
+            }
+        }
+    }, grain);
+}
+
+template<size_t mD>
+void FFTPoissonSolver<mD>::divideByEigenvalues(std::vector<cplx>& work) const
+{
+    const size_t nx = eigen_[0].size();
+    const size_t numRows = work.size() / nx;
+    Parallel::parallelFor(*pool_, 0, numRows,
+        [&](const size_t begin, const size_t end) {
+        for (size_t r=begin; r<end; r++) {
+            // Sum of the eigenvalues from dimensions 1..mD-1 is constant
+            // along a row
+            double rowEig = -alpha_;
+            size_t rem = r;
+            for (size_t d=1; d<mD; d++) {
+                const size_t N = eigen_[d].size();
+                rowEig += eigen_[d][rem % N];
+                rem /= N;
+            }
+            cplx* row = work.data() + r*nx;
+            for (size_t i=0; i<nx; i++) {
+                const double lambda = rowEig + eigen_[0][i];
+                // Only the singular zero mode has lambda == 0 exactly
+                row[i] = (lambda == 0.0 ? cplx() : row[i] / lambda);
+            }
+        }
+    }, std::max<size_t>(1, Parallel::defaultGrain/nx));
+}
+
+// Instantiate solver templates
+template class FFTPoissonSolver<1>;
+template class FFTPoissonSolver<2>;
+template class FFTPoissonSolver<3>;
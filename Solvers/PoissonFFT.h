@@ -0,0 +1,77 @@
+/* ---------------------------------------------------------------------------
+ * Direct spectral solver for the Poisson/Helmholtz problem
+ *
+ *      (laplacian - alpha) phi = rhs
+ *
+ * discretised with the standard second-order (2*mD+1 point) stencil on a
+ * cell-centred, uniformly spaced Mesh. Each dimension is diagonalised by the
+ * transform matching its boundary condition (DFT for periodic, DCT-II for
+ * homogeneous Neumann, DST-II for homogeneous Dirichlet), so a solve costs
+ * O(N log N) with no iteration.
+ *
+ * Only meshes with MeshScalingType::Constant can be handled - use
+ * isApplicable() to choose between this and an iterative solver.
+ *
+ * For alpha == 0 with no Dirichlet dimension the problem is singular; the
+ * zero mode is dropped, giving the solution with zero mean.
+ * --------------------------------------------------------------------------*/
+
+#ifndef SOLVERS_POISSONFFT_H
+#define SOLVERS_POISSONFFT_H
+
+#include <array>
+#include <complex>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "DataStructures/Field.tpp"
+#include "FFT.h"
+#include "Parallel/ThreadPool.h"
+
+enum class SpectralBoundary {
+    Periodic,
+    Neumann,
+    Dirichlet
+};
+
+template<size_t mD>
+class FFTPoissonSolver
+{
+    using MeshPtr = std::shared_ptr<const Mesh<mD>>;
+    using scalarField = Field<double, 1, mD>;
+    using cplx = FFT::cplx;
+
+public:
+    // Lines are shared over pool
+    FFTPoissonSolver(const MeshPtr mesh,
+                     const std::array<SpectralBoundary, mD>& bcs,
+                     const double alpha = 0,
+                     Parallel::ThreadPool& pool =
+                         Parallel::ThreadPool::global());
+
+    static bool isApplicable(const Mesh<mD>& mesh) {
+        return mesh.scalingType() == MeshScalingType::Constant;
+    }
+
+    // rhs and phi must be defined on this solver's Mesh. phi may alias rhs.
+    void solve(const scalarField& rhs, scalarField& phi) const;
+
+    const Mesh<mD>& mesh() const { return *mesh_; }
+    double alpha() const { return alpha_; }
+
+private:
+    MeshPtr mesh_;
+    std::array<SpectralBoundary, mD> bcs_;
+    double alpha_;
+    Parallel::ThreadPool* pool_;
+    std::array<std::unique_ptr<FFT::LineTransform>, mD> transforms_;
+    std::array<std::vector<double>, mD> eigen_;
+    std::array<size_t, mD> stride_;
+
+    void transformDim(std::vector<cplx>& work, const size_t d,
+                      const bool forward) const;
+    void divideByEigenvalues(std::vector<cplx>& work) const;
+};
+
+#endif // SOLVERS_POISSONFFT_H
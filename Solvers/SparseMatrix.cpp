@@ -0,0 +1,204 @@
+#include "SparseMatrix.h"
+
+#include <cassert>
+#include <algorithm>
+#include <numeric>
+
+#include "Parallel/ParallelRange.h"
+
+double CSRMatrix::operator()(const size_t r, const size_t c) const
+{
+    assert(r < rows() && c < cols());
+    const size_t* begin = pattern_->colIdx.data() + pattern_->rowPtr[r];
+    const size_t* end = pattern_->colIdx.data() + pattern_->rowPtr[r+1];
+    const size_t* it = std::lower_bound(begin, end, c);
+    if (it == end || *it != c) {
+        return 0;
+    }
+    return values_[it - pattern_->colIdx.data()];
+}
+
+void CSRMatrix::multiply(const double* x, double* y,
+                         Parallel::ThreadPool& pool) const
+{
+    const size_t* rowPtr = pattern_->rowPtr.data();
+    const size_t* colIdx = pattern_->colIdx.data();
+    const double* vals = values_.data();
+    // Rows per piece, so that a piece holds about defaultGrain non-zeros
+    const size_t perRow = std::max<size_t>(1,
+        nnz()/std::max<size_t>(1, rows()));
+    Parallel::parallelFor(pool, 0, rows(),
+        [&](const size_t begin, const size_t end) {
+        for (size_t r=begin; r<end; r++) {
+            double sum = 0;
+            for (size_t k=rowPtr[r]; k<rowPtr[r+1]; k++) {
+                sum += vals[k]*x[colIdx[k]];
+            }
+            y[r] = sum;
+        }
+    }, std::max<size_t>(1, Parallel::defaultGrain/perRow));
+}
+
+
+std::vector<size_t> SellCSigmaMatrix::sortedRows(const SparsityPattern& p,
+                                                 const size_t sigma)
+{
+    std::vector<size_t> perm(p.rows);
+    std::iota(perm.begin(), perm.end(), 0);
+    const size_t window = (sigma == 0 ? p.rows : sigma);
+    for (size_t start=0; start<p.rows; start+=window) {
+        const size_t stop = std::min(p.rows, start+window);
+        // Stable, so rows of equal length keep their (cache friendly) order
+        std::stable_sort(perm.begin()+start, perm.begin()+stop,
+            [&p](const size_t a, const size_t b) {
+                return p.rowLength(a) > p.rowLength(b);
+            });
+    }
+    return perm;
+}
+
+double SellCSigmaMatrix::fillEfficiency(const SparsityPattern& p,
+                                        const size_t C,
+                                        const size_t sigma)
+{
+    if (p.nnz() == 0) {
+        return 1;
+    }
+    const std::vector<size_t> perm = sortedRows(p, sigma);
+    size_t stored = 0;
+    for (size_t start=0; start<p.rows; start+=C) {
+        size_t width = 0;
+        for (size_t r=start; r<std::min(p.rows, start+C); r++) {
+            width = std::max(width, p.rowLength(perm[r]));
+        }
+        stored += width*C;
+    }
+    return static_cast<double>(p.nnz())/stored;
+}
+
+SellCSigmaMatrix::SellCSigmaMatrix(const CSRMatrix& A,
+                                   const size_t C,
+                                   const size_t sigma):
+    rows_(A.rows()),
+    cols_(A.cols()),
+    C_(C),
+    numChunks_((A.rows() + C - 1)/C)
+{
+    const SparsityPattern& p = A.pattern();
+    perm_ = sortedRows(p, sigma);
+    // Padded slots in the last chunk point at a row that is never written
+    perm_.resize(numChunks_*C_, rows_);
+
+    chunkPtr_.resize(numChunks_+1);
+    chunkWidth_.resize(numChunks_);
+    chunkPtr_[0] = 0;
+    for (size_t k=0; k<numChunks_; k++) {
+        size_t width = 0;
+        for (size_t r=0; r<C_; r++) {
+            const size_t row = perm_[k*C_ + r];
+            if (row < rows_) {
+                width = std::max(width, p.rowLength(row));
+            }
+        }
+        chunkWidth_[k] = width;
+        chunkPtr_[k+1] = chunkPtr_[k] + width*C_;
+    }
+
+    // Padding reads x[0] with a zero coefficient
+    colIdx_.assign(chunkPtr_[numChunks_], 0);
+    values_.assign(chunkPtr_[numChunks_], 0);
+    slotOf_.resize(p.nnz());
+    for (size_t k=0; k<numChunks_; k++) {
+        for (size_t r=0; r<C_; r++) {
+            const size_t row = perm_[k*C_ + r];
+            if (row >= rows_) {
+                continue;
+            }
+            for (size_t j=0; j<p.rowLength(row); j++) {
+                const size_t slot = chunkPtr_[k] + j*C_ + r;
+                const size_t entry = p.rowPtr[row] + j;
+                colIdx_[slot] = p.colIdx[entry];
+                slotOf_[entry] = slot;
+            }
+        }
+    }
+    updateValues(A);
+}
+
+void SellCSigmaMatrix::updateValues(const CSRMatrix& A,
+                                    Parallel::ThreadPool& pool)
+{
+    assert(A.nnz() == slotOf_.size());
+    const std::vector<double>& v = A.values();
+    Parallel::parallelFor(pool, 0, v.size(),
+        [&](const size_t begin, const size_t end) {
+        for (size_t e=begin; e<end; e++) {
+            values_[slotOf_[e]] = v[e];
+        }
+    });
+}
+
+void SellCSigmaMatrix::multiply(const double* x, double* y,
+                                Parallel::ThreadPool& pool) const
+{
+    std::vector<double> sums(pool.numSlots()*C_);
+    // Chunks per piece, so that a piece holds about defaultGrain entries
+    const size_t perChunk = std::max<size_t>(1,
+        values_.size()/std::max<size_t>(1, numChunks_));
+    Parallel::parallelFor(pool, 0, numChunks_,
+        [&](const size_t begin, const size_t end) {
+        double* sum = sums.data() + pool.threadIndex()*C_;
+        for (size_t k=begin; k<end; k++) {
+            std::fill(sum, sum + C_, 0.0);
+            const double* vals = values_.data() + chunkPtr_[k];
+            const size_t* cols = colIdx_.data() + chunkPtr_[k];
+            for (size_t j=0; j<chunkWidth_[k]; j++) {
+                for (size_t r=0; r<C_; r++) {
+                    sum[r] += vals[j*C_ + r]*x[cols[j*C_ + r]];
+                }
+            }
+            for (size_t r=0; r<C_; r++) {
+                const size_t row = perm_[k*C_ + r];
+                if (row < rows_) {
+                    y[row] = sum[r];
+                }
+            }
+        }
+    }, std::max<size_t>(1, Parallel::defaultGrain/perChunk));
+}
+
+
+SparseOperator::SparseOperator(const CSRMatrix& A,
+                               const SparseFormat fmt,
+                               Parallel::ThreadPool& pool):
+    csr_(A),
+    format_(fmt),
+    pool_(&pool)
+{
+    if (format_ == SparseFormat::Auto) {
+        const bool uniformRows = SellCSigmaMatrix::fillEfficiency(A.pattern())
+                                 >= minSellEfficiency;
+        format_ = uniformRows ? SparseFormat::SellCSigma : SparseFormat::CSR;
+    }
+    if (format_ == SparseFormat::SellCSigma) {
+        sell_.reset(new SellCSigmaMatrix(csr_));
+    }
+}
+
+void SparseOperator::refresh(const CSRMatrix& A)
+{
+    assert(A.patternPtr() == csr_.patternPtr());
+    csr_.values() = A.values();
+    if (sell_) {
+        sell_->updateValues(csr_, *pool_);
+    }
+}
+
+void SparseOperator::multiply(const double* x, double* y) const
+{
+    if (sell_) {
+        sell_->multiply(x, y, *pool_);
+    } else {
+        csr_.multiply(x, y, *pool_);
+    }
+}
@@ -0,0 +1,190 @@
+/* ---------------------------------------------------------------------------
+ * Sparse matrices for assembled discrete operators.
+ *
+ * SparsityPattern  - immutable CSR structure (row pointers, column indices).
+ *                    Held by shared_ptr so that matrices whose coefficients
+ *                    change every timestep keep reusing the same structure.
+ * CSRMatrix        - a pattern plus one value per non-zero.
+ * SellCSigmaMatrix - SELL-C-sigma layout built from a CSRMatrix: rows are
+ *                    sorted by length inside windows of sigma rows, grouped
+ *                    into chunks of C rows and stored column-major within a
+ *                    chunk, so the SpMV inner loop runs across C rows at once.
+ * SparseOperator   - one of the above, chosen automatically from the row
+ *                    length distribution, with a threaded SpMV on Fields.
+ *
+ * Rows are shared over a ThreadPool, the global one unless given.
+ *
+ * Vectors of fD-component Fields are laid out component by component, as in
+ * Field storage: entry (d*numCells + cell).
+ * --------------------------------------------------------------------------*/
+
+#ifndef SOLVERS_SPARSEMATRIX_H
+#define SOLVERS_SPARSEMATRIX_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "DataStructures/Field.tpp"
+#include "Parallel/ThreadPool.h"
+
+struct SparsityPattern
+{
+    size_t rows;
+    size_t cols;
+    std::vector<size_t> rowPtr; // rows+1 entries
+    std::vector<size_t> colIdx; // sorted within each row
+
+    size_t nnz() const { return colIdx.size(); }
+    size_t rowLength(const size_t r) const { return rowPtr[r+1] - rowPtr[r]; }
+};
+
+class CSRMatrix
+{
+    using PatternPtr = std::shared_ptr<const SparsityPattern>;
+
+public:
+    explicit CSRMatrix(const PatternPtr pattern):
+        pattern_(pattern),
+        values_(pattern->nnz())
+    {}
+
+    size_t rows() const { return pattern_->rows; }
+    size_t cols() const { return pattern_->cols; }
+    size_t nnz() const { return pattern_->nnz(); }
+    const SparsityPattern& pattern() const { return *pattern_; }
+    PatternPtr patternPtr() const { return pattern_; }
+
+    const std::vector<double>& values() const { return values_; }
+    std::vector<double>& values() { return values_; }
+
+    // Entry lookup (binary search within the row); 0 if not in the pattern
+    double operator()(const size_t r, const size_t c) const;
+
+    // y = A*x. y must not alias x.
+    void multiply(const double* x, double* y,
+                  Parallel::ThreadPool& pool =
+                      Parallel::ThreadPool::global()) const;
+
+private:
+    PatternPtr pattern_;
+    std::vector<double> values_;
+};
+
+class SellCSigmaMatrix
+{
+public:
+    static constexpr size_t defaultC = 8;
+
+    // sigma == 0 sorts over the whole matrix
+    SellCSigmaMatrix(const CSRMatrix& A,
+                     const size_t C = defaultC,
+                     const size_t sigma = 256);
+
+    // Copy new values from a CSRMatrix with the same pattern
+    void updateValues(const CSRMatrix& A,
+                      Parallel::ThreadPool& pool =
+                          Parallel::ThreadPool::global());
+
+    size_t rows() const { return rows_; }
+    size_t cols() const { return cols_; }
+    size_t chunkHeight() const { return C_; }
+    // Stored entries including padding
+    size_t storedEntries() const { return values_.size(); }
+
+    void multiply(const double* x, double* y,
+                  Parallel::ThreadPool& pool =
+                      Parallel::ThreadPool::global()) const;
+
+    // nnz / stored entries for a given pattern and layout, without building
+    static double fillEfficiency(const SparsityPattern& p,
+                                 const size_t C = defaultC,
+                                 const size_t sigma = 256);
+
+private:
+    size_t rows_, cols_, C_, numChunks_;
+    std::vector<size_t> perm_;       // chunk row slot -> matrix row
+    std::vector<size_t> chunkPtr_;   // start of each chunk in values_
+    std::vector<size_t> chunkWidth_;
+    std::vector<size_t> colIdx_;
+    std::vector<double> values_;
+    std::vector<size_t> slotOf_;     // CSR entry -> index into values_
+
+    static std::vector<size_t> sortedRows(const SparsityPattern& p,
+                                          const size_t sigma);
+};
+
+enum class SparseFormat {
+    Auto,
+    CSR,
+    SellCSigma
+};
+
+class SparseOperator
+{
+public:
+    // Auto picks SELL-C-sigma when at least this fraction of stored
+    // entries are real non-zeros
+    static constexpr double minSellEfficiency = 0.8;
+
+    SparseOperator(const CSRMatrix& A,
+                   const SparseFormat fmt = SparseFormat::Auto,
+                   Parallel::ThreadPool& pool = Parallel::ThreadPool::global());
+
+    // New coefficients on the same pattern - no re-analysis or allocation
+    void refresh(const CSRMatrix& A);
+
+    SparseFormat format() const { return format_; }
+    size_t rows() const { return csr_.rows(); }
+    size_t cols() const { return csr_.cols(); }
+
+    void multiply(const double* x, double* y) const;
+
+    // out = A*in, with A sized (fOut*numCells) x (fIn*numCells).
+    // out must be a different Field to in.
+    template<size_t fIn, size_t fOut, size_t mD>
+    void apply(const Field<double, fIn, mD>& in,
+               Field<double, fOut, mD>& out) const;
+
+private:
+    CSRMatrix csr_;
+    std::unique_ptr<SellCSigmaMatrix> sell_;
+    SparseFormat format_;
+    Parallel::ThreadPool* pool_;
+};
+
+template<size_t fIn, size_t fOut, size_t mD>
+void SparseOperator::apply(const Field<double, fIn, mD>& in,
+                           Field<double, fOut, mD>& out) const
+{
+    const size_t N = in.numCells();
+    assert(cols() == fIn*N);
+    assert(rows() == fOut*N);
+    assert(in.mesh() == out.mesh());
+
+    // Single component Fields are already contiguous
+    std::vector<double> xBuf, yBuf;
+    const double* x = in.x().data();
+    if (fIn > 1) {
+        xBuf.resize(fIn*N);
+        for (size_t d=0; d<fIn; d++) {
+            std::copy(in.component(d).begin(), in.component(d).end(),
+                      xBuf.begin() + d*N);
+        }
+        x = xBuf.data();
+    }
+    double* y = out.x().data();
+    if (fOut > 1) {
+        yBuf.resize(fOut*N);
+        y = yBuf.data();
+    }
+    multiply(x, y);
+    if (fOut > 1) {
+        for (size_t d=0; d<fOut; d++) {
+            std::copy(yBuf.begin() + d*N, yBuf.begin() + (d+1)*N,
+                      out.component(d).begin());
+        }
+    }
+}
+
+#endif // SOLVERS_SPARSEMATRIX_H
@@ -0,0 +1,62 @@
+#include "allocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Every form of operator new and delete is replaced, so each allocation is
+// released by its matching function. Kept out of the test sources so the
+// compiler does not see malloc and free next to new and delete.
+namespace {
+    std::atomic<size_t> count(0);
+
+    void* allocate(std::size_t size) {
+        count++;
+        if (void* p = std::malloc(size ? size : 1)) {
+            return p;
+        }
+        throw std::bad_alloc();
+    }
+
+    void* allocateAligned(std::size_t size, const std::align_val_t align) {
+        count++;
+        const std::size_t a = static_cast<std::size_t>(align);
+        // aligned_alloc needs a multiple of the alignment
+        const std::size_t n = ((size ? size : 1) + a - 1) / a * a;
+        if (void* p = std::aligned_alloc(a, n)) {
+            return p;
+        }
+        throw std::bad_alloc();
+    }
+}
+
+size_t allocationCount()
+{
+    return count;
+}
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, std::align_val_t align)
+{
+    return allocateAligned(size, align);
+}
+void* operator new[](std::size_t size, std::align_val_t align)
+{
+    return allocateAligned(size, align);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
@@ -0,0 +1,17 @@
+/* ---------------------------------------------------------------------------
+ * Counts every allocation made through operator new by the test program it
+ * is linked into, so tests can check that an operation does not allocate.
+ *
+ * Replacing the global allocator affects the whole program, so it is only
+ * linked into testAllocations, not testMain.
+ * --------------------------------------------------------------------------*/
+
+#ifndef TESTS_ALLOCATIONCOUNTER_H
+#define TESTS_ALLOCATIONCOUNTER_H
+
+#include <cstddef>
+
+// Allocations made so far
+size_t allocationCount();
+
+#endif // TESTS_ALLOCATIONCOUNTER_H
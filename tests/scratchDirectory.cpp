@@ -0,0 +1,31 @@
+#include "scratchDirectory.h"
+
+#include <filesystem>
+#include <system_error>
+#include <vector>
+
+#include <stdlib.h>
+
+ScratchDirectory::ScratchDirectory(const std::string& prefix)
+{
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    const fs::path tmp = fs::temp_directory_path(ec);
+    if (ec) {
+        return;
+    }
+    const std::string name = (tmp / (prefix + "XXXXXX")).string();
+    std::vector<char> buf(name.begin(), name.end());
+    buf.push_back('\0');
+    if (::mkdtemp(buf.data())) {
+        path_ = buf.data();
+    }
+}
+
+ScratchDirectory::~ScratchDirectory()
+{
+    if (!path_.empty()) {
+        std::error_code ec;
+        std::filesystem::remove_all(path_, ec);
+    }
+}
@@ -0,0 +1,30 @@
+/* ---------------------------------------------------------------------------
+ * A directory of its own for the files a test writes, made under the system
+ * temporary directory with a unique name (mkdtemp) and removed, with
+ * everything in it, when the ScratchDirectory goes out of scope - also when
+ * a REQUIRE fails. Concurrent or earlier, interrupted runs never see each
+ * other's files.
+ * --------------------------------------------------------------------------*/
+
+#ifndef TESTS_SCRATCHDIRECTORY_H
+#define TESTS_SCRATCHDIRECTORY_H
+
+#include <string>
+
+class ScratchDirectory
+{
+public:
+    // Named prefix followed by a unique suffix; path() is empty on failure
+    explicit ScratchDirectory(const std::string& prefix);
+    ~ScratchDirectory();
+
+    ScratchDirectory(const ScratchDirectory&) = delete;
+    ScratchDirectory& operator=(const ScratchDirectory&) = delete;
+
+    const std::string& path() const { return path_; }
+
+private:
+    std::string path_;
+};
+
+#endif // TESTS_SCRATCHDIRECTORY_H
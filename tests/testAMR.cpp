@@ -0,0 +1,103 @@
+#include "AMR/AMRHierarchy.h"
+#include "AMR/AMRField.tpp"
+
+#include "catch.hpp"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+using namespace AMR;
+
+namespace {
+    // Circular front of width w at radius 0.3 about (0.5, 0.5)
+    double front(const std::array<double, 2>& x, const double w) {
+        const double r = std::hypot(x[0]-0.5, x[1]-0.5);
+        return 1 + std::tanh((r - 0.3)/w);
+    }
+
+    // Regrid repeatedly on the flags of the front until the finest level
+    // is reached
+    std::shared_ptr<const AMRHierarchy<2>> refineOnFront(
+            std::shared_ptr<const AMRHierarchy<2>> h, const double w) {
+        for (size_t L=0; L<h->maxLevel(); L++) {
+            AMRField<1, 2> q(h, "q");
+            q.setFrom([w](const std::array<double, 2>& x, size_t) {
+                return front(x, w);
+            });
+            h = std::make_shared<const AMRHierarchy<2>>(
+                    h->regrid(q.flagJumps(0, 0.1)));
+        }
+        return h;
+    }
+}
+
+TEST_CASE("AMR hierarchy", "[amr]") {
+    auto base = std::make_shared<Mesh<2>>(MeshScalingType::Constant,
+                                          MeshDimension(32, 0, 1),
+                                          MeshDimension(32, 0, 1));
+    auto h0 = std::make_shared<const AMRHierarchy<2>>(base, 2, 8);
+    REQUIRE(h0->numLevels() == 1);
+    REQUIRE(h0->numLeafCells() == 1024);
+
+    auto h = refineOnFront(h0, 0.01);
+
+    SECTION("Refinement follows the front with fewer cells") {
+        REQUIRE(h->numLevels() == 3);
+        // Uniform resolution at the finest level would be 128^2 cells
+        REQUIRE(h->numLeafCells() < 16384/2);
+        REQUIRE(h->cellSize(2, 0) == Approx(1.0/128));
+        // The front is covered by the finest level, the centre is not
+        REQUIRE(h->findPatch(2, {{ 64 + 38, 64 }}) != AMRHierarchy<2>::npos);
+        REQUIRE(h->findPatch(2, {{ 64, 64 }}) == AMRHierarchy<2>::npos);
+    }
+
+    SECTION("Levels are properly nested") {
+        for (size_t L=1; L<h->numLevels(); L++) {
+            for (const auto& p : h->patches(L)) {
+                REQUIRE(p.mesh->numCells() == 64);
+                REQUIRE(h->findPatch(L-1, {{ p.lo[0]/2, p.lo[1]/2 }})
+                        != AMRHierarchy<2>::npos);
+                REQUIRE(h->findPatch(L-1, {{ (p.lo[0]+7)/2, (p.lo[1]+7)/2 }})
+                        != AMRHierarchy<2>::npos);
+                REQUIRE(p.mesh->edges(0).front()
+                        == Approx(p.lo[0]*h->cellSize(L, 0)));
+            }
+        }
+    }
+
+    SECTION("Averaging down is exact for linear data") {
+        AMRField<2, 2> f(h, "f");
+        f.setFrom([](const std::array<double, 2>& x, size_t c) {
+            return c == 0 ? 2*x[0] - x[1] : 3.0;
+        });
+        AMRField<2, 2> g(f);
+        g.averageDown();
+        for (size_t L=0; L<h->numLevels(); L++) {
+            for (size_t p=0; p<h->patches(L).size(); p++) {
+                const auto& a = f.patch(L, p).x();
+                const auto& b = g.patch(L, p).x();
+                for (size_t c=0; c<a.size(); c++) {
+                    REQUIRE(b[c] == Approx(a[c]));
+                }
+            }
+        }
+    }
+
+    SECTION("Regridding conserves the composite integral") {
+        AMRField<1, 2> q(h, "q");
+        q.setFrom([](const std::array<double, 2>& x, size_t) {
+            return front(x, 0.01);
+        });
+        q.averageDown();
+        const double before = q.integral(0);
+        // Move to the hierarchy of a wider front: patches appear and vanish
+        auto h2 = refineOnFront(h0, 0.04);
+        REQUIRE(h2->numLeafCells() != h->numLeafCells());
+        AMRField<1, 2> q2 = q.regridded(h2);
+        REQUIRE(q2.integral(0) == Approx(before).epsilon(1e-12));
+        // And back to level 0 only
+        AMRField<1, 2> q0 = q.regridded(h0);
+        REQUIRE(q0.integral(0) == Approx(before).epsilon(1e-12));
+    }
+}
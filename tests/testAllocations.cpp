@@ -0,0 +1,86 @@
+#include "DataStructures/Field.tpp"
+#include "DataStructures/Mesh.h"
+
+#include "allocationCounter.h"
+#include "catch.hpp"
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+TEST_CASE("Operations that must not allocate", "[allocation]") {
+    MeshDimension defaultDim(10, 0, 1);
+    MeshScalingType s(MeshScalingType::Constant);
+    auto mesh2D = std::make_shared<Mesh<2>>(s, defaultDim, defaultDim);
+
+    SECTION ("Moves do not allocate") {
+        static_assert(std::is_nothrow_move_constructible<
+                          Field<double, 2, 2>>::value, "");
+        static_assert(std::is_nothrow_move_assignable<
+                          Field<double, 2, 2>>::value, "");
+        static_assert(std::is_nothrow_move_constructible<
+                          Field<double, 2, 2, FieldLocation::Staggered>>::value, "");
+        static_assert(std::is_nothrow_move_constructible<Mesh<3>>::value, "");
+        static_assert(std::is_nothrow_move_assignable<Mesh<3>>::value, "");
+
+        // Names too long for the small string buffer, so a copy would
+        // allocate
+        Field<double, 2, 2> a(mesh2D, "a field with a long enough name");
+        Field<double, 2, 2> b(mesh2D, "another field with a long name");
+        Mesh<2> meshCopy(*mesh2D);
+        const double* buffer = a.y().data();
+
+        const size_t before = allocationCount();
+        Field<double, 2, 2> moved(std::move(a));
+        b = std::move(moved);
+        Mesh<2> movedMesh(std::move(meshCopy));
+        meshCopy = std::move(movedMesh);
+        // Read the counter before Catch builds its messages
+        const size_t after = allocationCount();
+        REQUIRE(after == before);
+
+        const Field<double, 2, 2>& cb = b;
+        REQUIRE(cb.y().data() == buffer);
+        REQUIRE(cb.name() == "a field with a long enough name");
+        REQUIRE(meshCopy == *mesh2D);
+        REQUIRE(movedMesh.numCells() == 0);
+
+        // Growing a vector of Fields moves them: the only allocation is
+        // the vector's new buffer
+        Field<double, 2, 2> original(mesh2D, "vectorIn2D");
+        std::vector<Field<double, 2, 2>> fields;
+        fields.reserve(1);
+        fields.push_back(std::move(b));
+        Field<double, 2, 2> c(original, "a copy with a long enough name");
+        const size_t beforeGrow = allocationCount();
+        fields.push_back(std::move(c));
+        const size_t afterGrow = allocationCount();
+        REQUIRE(afterGrow == beforeGrow + 1);
+        REQUIRE(fields[0].name() == "a field with a long enough name");
+    }
+
+    SECTION ("In-place operations do not allocate") {
+        Field<double, 2, 2> u(mesh2D, "u"), v(mesh2D, "v");
+        Field<double, 1, 2> f(mesh2D, "f");
+        for (size_t i=0; i<100; i++) {
+            u.x()[i] = i;
+            u.y()[i] = 2*i;
+            v.x()[i] = 1;
+            v.y()[i] = i + 1.0;
+            f.x()[i] = 0.5*i;
+        }
+        const size_t before = allocationCount();
+        u += v;
+        u -= v;
+        u *= v;
+        u /= v;
+        u *= f;
+        u.axpy(0.5, v);
+        u.fma(v, v);
+        u *= 2.0;
+        const size_t after = allocationCount();
+        REQUIRE(after == before);
+        REQUIRE(u.x()[3] == Approx(2*(1.5*3 + 0.5 + 1)));
+    }
+}
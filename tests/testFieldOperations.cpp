@@ -0,0 +1,799 @@
+#include "DataStructures/Field.tpp"
+#include "DataStructures/Mesh.h"
+#include "FieldOperations/FieldOperations.h"
+#include "FieldOperations/FieldOperations.tpp"
+#include "FieldOperations/Reconstruction.h"
+#include "FieldOperations/Interpolation.tpp"
+#include "FieldOperations/Probes.h"
+#include "FieldOperations/Fusion.h"
+#include "FieldOperations/TemporalBlocking.h"
+
+#include "catch.hpp"
+#include "scratchDirectory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace FieldOps;
+
+namespace {
+    template<typename T>
+    bool matchVectorsApprox(const std::vector<T>& v1, const std::vector<T>& v2) {
+        if (v1.size() != v2.size()) {
+            return false;
+        }
+        for (size_t i=0; i<v1.size(); i++) {
+            if (v1[i] != Approx(v2[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    constexpr double pi = 3.141592653589793238463;
+
+    // Cell averages of sin(x) on a 1D mesh
+    std::vector<double> sinAverages(const Mesh<1>& mesh) {
+        const std::vector<double>& e = mesh.edges(0);
+        std::vector<double> q(mesh.numCells());
+        for (size_t i=0; i<q.size(); i++) {
+            q[i] = (std::cos(e[i]) - std::cos(e[i+1]))/(e[i+1] - e[i]);
+        }
+        return q;
+    }
+
+    // Largest face error of the left and right states, skipping 'skip'
+    // faces at each end
+    double maxFaceError(const Mesh<1>& mesh, const reconstructionType type,
+                        const size_t skip) {
+        Reconstructor<1> recon(std::make_shared<Mesh<1>>(mesh), 0, type,
+                               ghostType::ZeroGradient);
+        std::vector<double> qL, qR;
+        recon.faces(sinAverages(mesh), qL, qR);
+        const std::vector<double>& e = mesh.edges(0);
+        double err = 0;
+        for (size_t f=skip; f<qL.size()-skip; f++) {
+            err = std::max(err, std::fabs(qL[f] - std::sin(e[f])));
+            err = std::max(err, std::fabs(qR[f] - std::sin(e[f])));
+        }
+        return err;
+    }
+}
+
+TEST_CASE("Face reconstruction", "[reconstruction]") {
+    SECTION("WENO5 is fifth order on uniform and stretched meshes") {
+        for (MeshScalingType s : { MeshScalingType::Constant,
+                                   MeshScalingType::Hyperbolic }) {
+            Mesh<1> coarse(s, MeshDimension(40, 0, 1));
+            Mesh<1> fine(s, MeshDimension(80, 0, 1));
+            const double eC = maxFaceError(coarse, reconstructionType::WENO5, 3);
+            const double eF = maxFaceError(fine, reconstructionType::WENO5, 6);
+            REQUIRE(eC/eF > 20);
+        }
+    }
+
+    SECTION("Linear data is reproduced exactly") {
+        auto mesh = std::make_shared<Mesh<1>>(MeshScalingType::Exponential,
+                                              MeshDimension(20, -1, 2));
+        std::vector<double> q(20);
+        for (size_t i=0; i<20; i++) {
+            q[i] = 3*mesh->centres(0)[i] - 1;
+        }
+        for (reconstructionType t : { reconstructionType::MUSCLMinmod,
+                                      reconstructionType::MUSCLVanLeer,
+                                      reconstructionType::WENO5 }) {
+            Reconstructor<1> recon(mesh, 0, t, ghostType::ZeroGradient);
+            std::vector<double> qL, qR;
+            recon.faces(q, qL, qR);
+            REQUIRE(qL.size() == 21);
+            for (size_t f=3; f<18; f++) {
+                const double exact = 3*mesh->edges(0)[f] - 1;
+                REQUIRE(qL[f] == Approx(exact));
+                REQUIRE(qR[f] == Approx(exact));
+            }
+        }
+    }
+
+    SECTION("Limited reconstructions do not overshoot a step") {
+        auto mesh = std::make_shared<Mesh<1>>(MeshScalingType::Constant,
+                                              MeshDimension(16, 0, 1));
+        std::vector<double> q(16);
+        for (size_t i=0; i<16; i++) {
+            q[i] = (i < 8 ? 1.0 : 0.0);
+        }
+        for (reconstructionType t : { reconstructionType::MUSCLMinmod,
+                                      reconstructionType::MUSCLVanLeer }) {
+            Reconstructor<1> recon(mesh, 0, t, ghostType::ZeroGradient);
+            std::vector<double> qL, qR;
+            recon.faces(q, qL, qR);
+            for (size_t f=0; f<qL.size(); f++) {
+                REQUIRE(qL[f] >= 0);
+                REQUIRE(qL[f] <= 1);
+                REQUIRE(qR[f] >= 0);
+                REQUIRE(qR[f] <= 1);
+            }
+        }
+    }
+
+    SECTION("Lines along every dimension match the 1D result") {
+        const MeshScalingType s = MeshScalingType::Pivot;
+        MeshDimension a(6, 0, 1), b(12, 0, 2), c(4, -1, 1);
+        auto mesh3 = std::make_shared<Mesh<3>>(s, a, b, c);
+        auto mesh1 = std::make_shared<Mesh<1>>(s, b);
+        std::vector<double> q1(12);
+        for (size_t j=0; j<12; j++) {
+            q1[j] = std::exp(mesh1->centres(0)[j]);
+        }
+        Field<double, 1, 3> q3(mesh3, "q");
+        for (size_t k=0; k<4; k++) {
+            for (size_t j=0; j<12; j++) {
+                for (size_t i=0; i<6; i++) {
+                    q3.x()[i + 6*j + 72*k] = q1[j];
+                }
+            }
+        }
+        Reconstructor<1> r1(mesh1, 0, reconstructionType::WENO5, ghostType::Periodic);
+        Parallel::ThreadPool pool(2);
+        Reconstructor<3> r3(mesh3, 1, reconstructionType::WENO5, ghostType::Periodic, pool);
+        std::vector<double> l1, rr1, l3, rr3;
+        r1.faces(q1, l1, rr1);
+        r3.faces(q3.x(), l3, rr3);
+        REQUIRE(l3.size() == Reconstructor<3>::numFaces(*mesh3, 1));
+        for (size_t k=0; k<4; k++) {
+            for (size_t f=0; f<13; f++) {
+                for (size_t i=0; i<6; i++) {
+                    REQUIRE(l3[i + 6*f + 78*k] == Approx(l1[f]));
+                    REQUIRE(rr3[i + 6*f + 78*k] == Approx(rr1[f]));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Advection operator", "[advection]") {
+    SECTION("Uniform density in the rotating velocity field is steady") {
+        auto mesh = std::make_shared<Mesh<2>>(MeshScalingType::Constant,
+                                              MeshDimension(10, 0, 1),
+                                              MeshDimension(10, 0, 1));
+        Field<double, 2, 2> U(mesh, "U");
+        Field<double, 1, 2> Rho(mesh, "Rho");
+        Field<double, 1, 2> dRho(mesh, "dRho");
+        Rho.setFixed(1);
+        for (size_t j=0; j<10; j++) {
+            for (size_t i=0; i<10; i++) {
+                U.x()[i + 10*j] =  0.01 * pi * mesh->centres(1)[j];
+                U.y()[i + 10*j] = -0.01 * pi * mesh->centres(0)[i];
+            }
+        }
+        AdvectionOperator<2> adv(mesh, reconstructionType::WENO5,
+                                 ghostType::ZeroGradient);
+        adv.apply(Rho, U, dRho);
+        for (double v : dRho.x()) {
+            REQUIRE(v == Approx(0));
+        }
+    }
+
+    SECTION("Periodic translation") {
+        auto mesh = std::make_shared<Mesh<1>>(MeshScalingType::Constant,
+                                              MeshDimension(64, 0, 1));
+        Field<double, 1, 1> U(mesh, "U");
+        Field<double, 1, 1> q(mesh, "q");
+        Field<double, 1, 1> dq(mesh, "dq");
+        U.setFixed(1);
+        const std::vector<double>& e = mesh->edges(0);
+        for (size_t i=0; i<64; i++) {
+            // Cell averages of sin(2 pi x)
+            q.x()[i] = (std::cos(2*pi*e[i]) - std::cos(2*pi*e[i+1]))
+                        / (2*pi*(e[i+1] - e[i]));
+        }
+        AdvectionOperator<1> adv(mesh, reconstructionType::WENO5,
+                                 ghostType::Periodic);
+        adv.apply(q, U, dq);
+        for (size_t i=0; i<64; i++) {
+            // -d/dx of sin(2 pi x), averaged over the cell
+            const double exact = -(std::sin(2*pi*e[i+1]) - std::sin(2*pi*e[i]))
+                                  / (e[i+1] - e[i]);
+            REQUIRE(dq.x()[i] == Approx(exact).epsilon(1e-4));
+        }
+    }
+}
+
+TEST_CASE("Interpolation between field locations", "[location]") {
+    auto mesh = std::make_shared<Mesh<3>>(MeshScalingType::Exponential,
+                                          MeshDimension(5, 0, 1),
+                                          MeshDimension(4, -1, 1),
+                                          MeshDimension(3, 0, 2));
+    // Linear in every coordinate, so interior interpolation is exact
+    auto linear = [](const double x, const double y, const double z) {
+        return 1 + 2*x - 3*y + 0.5*z;
+    };
+    auto fill = [&](auto& f) {
+        constexpr FieldLocation loc = std::decay_t<decltype(f)>::location;
+        for (size_t c=0; c<3; c++) {
+            const auto dims = f.dims(c);
+            const auto& px = locationPositions(*mesh, loc, c, 0);
+            const auto& py = locationPositions(*mesh, loc, c, 1);
+            const auto& pz = locationPositions(*mesh, loc, c, 2);
+            for (size_t k=0; k<dims[2]; k++) {
+                for (size_t j=0; j<dims[1]; j++) {
+                    for (size_t i=0; i<dims[0]; i++) {
+                        f.component(c)[i + dims[0]*(j + dims[1]*k)] =
+                                linear(px[i], py[j], pz[k]);
+                    }
+                }
+            }
+        }
+    };
+
+    Field<double, 3, 3> cells(mesh, "cells");
+    Field<double, 3, 3, FieldLocation::Staggered> mac(mesh, "mac");
+    Field<double, 3, 3, FieldLocation::Node> nodes(mesh, "nodes");
+    Field<double, 1, 3, FieldLocation::FaceY> faceY(mesh, "faceY");
+
+    SECTION("Storage sizes") {
+        REQUIRE(cells.component(0).size() == 60);
+        REQUIRE(mac.component(0).size() == 6*4*3);
+        REQUIRE(mac.component(1).size() == 5*5*3);
+        REQUIRE(mac.component(2).size() == 5*4*4);
+        REQUIRE(nodes.component(1).size() == 6*5*4);
+        REQUIRE(faceY.x().size() == 5*5*3);
+    }
+
+    SECTION("Centres and nodes round trip exactly for linear data") {
+        fill(cells);
+        Field<double, 3, 3, FieldLocation::Node> expected(mesh, "expected");
+        fill(expected);
+        interpolate(cells, nodes);
+        // Interior nodes only; boundary nodes copy the adjacent cells
+        const auto dims = nodes.dims(0);
+        for (size_t k=1; k<dims[2]-1; k++) {
+            for (size_t j=1; j<dims[1]-1; j++) {
+                for (size_t i=1; i<dims[0]-1; i++) {
+                    const size_t n = i + dims[0]*(j + dims[1]*k);
+                    REQUIRE(nodes.x()[n] == Approx(expected.x()[n]));
+                }
+            }
+        }
+        fill(nodes);
+        Field<double, 3, 3> back(mesh, "back");
+        interpolate(nodes, back);
+        REQUIRE(matchVectorsApprox(back.z(), cells.z()));
+    }
+
+    SECTION("MAC staggering") {
+        fill(mac);
+        interpolate(mac, cells);
+        Field<double, 3, 3> expected(mesh, "expected");
+        fill(expected);
+        for (size_t c=0; c<3; c++) {
+            REQUIRE(matchVectorsApprox(cells.component(c), expected.component(c)));
+        }
+        Field<double, 3, 3, FieldLocation::Staggered> mac2(mesh, "mac2");
+        interpolate(cells, mac2);
+        // Interior faces of the y component match the staggered values
+        const auto dims = mac2.dims(1);
+        for (size_t k=0; k<dims[2]; k++) {
+            for (size_t j=1; j<dims[1]-1; j++) {
+                for (size_t i=0; i<dims[0]; i++) {
+                    const size_t n = i + dims[0]*(j + dims[1]*k);
+                    REQUIRE(mac2.y()[n] == Approx(mac.y()[n]));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Probes", "[probes]") {
+    auto mesh = std::make_shared<Mesh<3>>(MeshScalingType::Hyperbolic,
+                                          MeshDimension(8, 0, 1),
+                                          MeshDimension(6, -1, 1),
+                                          MeshDimension(5, 0, 2));
+    Field<double, 1, 3> p(mesh, "p");
+    Field<double, 3, 3> U(mesh, "U");
+    for (size_t k=0; k<5; k++) {
+        for (size_t j=0; j<6; j++) {
+            for (size_t i=0; i<8; i++) {
+                const size_t n = i + 8*(j + 6*k);
+                const double x = mesh->centres(0)[i];
+                const double y = mesh->centres(1)[j];
+                const double z = mesh->centres(2)[k];
+                p.x()[n] = 1 + x - 2*y + 3*z;
+                U.x()[n] = x;
+                U.y()[n] = y;
+                U.z()[n] = z;
+            }
+        }
+    }
+    // Points inside the hull of the cell centres
+    std::vector<std::array<double, 3>> pts;
+    for (size_t n=0; n<200; n++) {
+        pts.push_back({{ 0.1 + 0.8*std::fmod(n*0.618034, 1.0),
+                         -0.8 + 1.6*std::fmod(n*0.414214, 1.0),
+                         0.3 + 1.4*std::fmod(n*0.732051, 1.0) }});
+    }
+
+    SECTION("Linear probes are exact for linear data") {
+        Probes<3> probes(mesh, pts);
+        REQUIRE(probes.size() == 200);
+        REQUIRE(probes.stencilSize() == 8);
+        std::vector<double> v;
+        probes.sample(v, p, U);
+        REQUIRE(v.size() == 4*200);
+        for (size_t n=0; n<200; n++) {
+            const auto& q = pts[n];
+            REQUIRE(v[4*n] == Approx(1 + q[0] - 2*q[1] + 3*q[2]));
+            REQUIRE(v[4*n+1] == Approx(q[0]));
+            REQUIRE(v[4*n+2] == Approx(q[1]));
+            REQUIRE(v[4*n+3] == Approx(q[2]));
+        }
+    }
+
+    SECTION("Nearest probes pick the closest centre") {
+        Probes<3> probes(mesh, pts, probeType::Nearest);
+        REQUIRE(probes.stencilSize() == 1);
+        std::vector<double> v;
+        probes.sample(v, U);
+        for (size_t n=0; n<200; n++) {
+            for (size_t d=0; d<3; d++) {
+                double best = 1e30;
+                for (double c : mesh->centres(d)) {
+                    if (std::fabs(c - pts[n][d]) < std::fabs(best - pts[n][d])) {
+                        best = c;
+                    }
+                }
+                REQUIRE(v[3*n+d] == Approx(best));
+            }
+        }
+    }
+
+    SECTION("Moved probes are held constant beyond the outer centres") {
+        Probes<3> probes(mesh, pts);
+        probes.move({ {{ 0.0, -1.0, 0.0 }}, {{ 1.0, 1.0, 2.0 }} });
+        std::vector<double> v;
+        probes.sample(v, U);
+        REQUIRE(v.size() == 6);
+        REQUIRE(v[0] == Approx(mesh->centres(0).front()));
+        REQUIRE(v[1] == Approx(mesh->centres(1).front()));
+        REQUIRE(v[5] == Approx(mesh->centres(2).back()));
+    }
+}
+
+TEST_CASE("Fused sweeps", "[fusion]") {
+    using Slot = FusedSweep<2>::Slot;
+    MeshDimension xDim(37, 0, 2), yDim(23, -1, 1);
+    auto mesh = std::make_shared<Mesh<2>>(MeshScalingType::Hyperbolic,
+                                          xDim, yDim);
+    Field<double, 1, 2> Rho(mesh, "Rho"), divRhoU(mesh, "divRhoU");
+    Field<double, 2, 2> U(mesh, "U");
+    const size_t nx = mesh->xCells();
+    for (size_t c=0; c<mesh->numCells(); c++) {
+        const double x = mesh->centres(0)[c % nx];
+        const double y = mesh->centres(1)[c / nx];
+        Rho.x()[c] = 2;
+        U.x()[c] = 3*x + y;
+        U.y()[c] = x - 0.5*y;
+    }
+
+    // out is a Field or a plain vector
+    auto divFlux = [&](FusedSweep<2>& sweep, auto& out) {
+        const Slot rho = sweep.input(Rho);
+        const Slot u = sweep.input(U, 0);
+        const Slot v = sweep.input(U, 1);
+        auto F = sweep.pointwise<2>(std::array<Slot, 3>{{ rho, u, v }},
+            [](const std::array<double, 3>& a, std::array<double, 2>& f) {
+                f[0] = a[0]*a[1];
+                f[1] = a[0]*a[2];
+            });
+        sweep.output(sweep.divergence(F), out);
+        return F;
+    };
+
+    SECTION("Central differences are exact for linear data") {
+        FusedSweep<2> sweep(mesh);
+        divFlux(sweep, divRhoU);
+        sweep.run();
+        for (double v : divRhoU.x()) {
+            REQUIRE(v == Approx(2*(3 - 0.5)));
+        }
+    }
+
+    SECTION("Bound Fields follow copy-on-write between runs") {
+        FusedSweep<2> sweep(mesh);
+        divFlux(sweep, divRhoU);
+        sweep.run();
+        // A copy taken between runs is not written through
+        const Field<double, 1, 2> snap = divRhoU;
+        Rho *= 2.0;
+        sweep.run();
+        REQUIRE_FALSE(snap.sharesStorageWith(divRhoU, 0));
+        for (size_t c=0; c<mesh->numCells(); c++) {
+            REQUIRE(snap.x()[c] == Approx(2*(3 - 0.5)));
+            REQUIRE(divRhoU.x()[c] == Approx(4*(3 - 0.5)));
+        }
+
+        // An input detached from a copy is read from its new buffer
+        const Field<double, 2, 2> oldU = U;
+        U *= -1.0;
+        REQUIRE_FALSE(oldU.sharesStorageWith(U, 0));
+        sweep.run();
+        for (double v : divRhoU.x()) {
+            REQUIRE(v == Approx(-4*(3 - 0.5)));
+        }
+    }
+
+    SECTION("Halos are worked out from the outputs") {
+        FusedSweep<2> sweep(mesh, {{ 5, 4 }});
+        auto F = divFlux(sweep, divRhoU);
+        auto g = sweep.gradient(F[0]);
+        std::vector<double> dxdyF;
+        sweep.output(sweep.derivative(g[1], 0), dxdyF);
+        sweep.run();
+        // F[0] feeds the divergence (radius 1) and a second derivative
+        REQUIRE(sweep.halo(F[0]) == 2);
+        REQUIRE(sweep.halo(F[1]) == 2);
+        REQUIRE(sweep.halo(g[1]) == 1);
+        for (double v : dxdyF) {
+            REQUIRE(v == Approx(0).epsilon(1e-9));
+        }
+    }
+
+    SECTION("Tiling does not change the result") {
+        for (size_t c=0; c<mesh->numCells(); c++) {
+            Rho.x()[c] = 1 + 0.5*std::sin(0.37*c);
+            U.y()[c] = std::cos(0.11*c);
+        }
+        FusedSweep<2> whole(mesh, {{ 37, 23 }});
+        std::vector<double> ref;
+        divFlux(whole, ref);
+        whole.run();
+        REQUIRE(whole.tileSize()[0] == 37);
+
+        FusedSweep<2> tiled(mesh, {{ 6, 5 }});
+        divFlux(tiled, divRhoU);
+        tiled.run();
+        REQUIRE(divRhoU.x() == ref);
+
+        // Unfused: the flux as full Fields, then a divergence sweep
+        Field<double, 2, 2> flux = U * Rho;
+        FusedSweep<2> divOnly(mesh, {{ 6, 5 }});
+        std::vector<double> unfused;
+        divOnly.output(divOnly.divergence({{ divOnly.input(flux, 0),
+                                             divOnly.input(flux, 1) }}),
+                       unfused);
+        divOnly.run();
+        REQUIRE(matchVectorsApprox(unfused, ref));
+    }
+
+    SECTION("Sweeps from several threads share a pool") {
+        for (size_t c=0; c<mesh->numCells(); c++) {
+            Rho.x()[c] = 1 + 0.5*std::sin(0.37*c);
+        }
+        FusedSweep<2> whole(mesh, {{ 37, 23 }});
+        std::vector<double> ref;
+        divFlux(whole, ref);
+        whole.run();
+
+        // Outside threads help with each other's tiles while they wait
+        Parallel::ThreadPool shared(4);
+        std::atomic<size_t> wrong(0);
+        std::vector<std::thread> threads;
+        for (size_t i=0; i<4; i++) {
+            threads.emplace_back([&]() {
+                FusedSweep<2> sweep(mesh, {{ 6, 5 }}, shared);
+                std::vector<double> out;
+                divFlux(sweep, out);
+                for (size_t rep=0; rep<20; rep++) {
+                    sweep.run();
+                    wrong += (out != ref);
+                }
+            });
+        }
+        for (std::thread& t : threads) {
+            t.join();
+        }
+        REQUIRE(wrong == 0);
+    }
+}
+
+TEST_CASE("Temporal blocking", "[temporal]") {
+    // Rotating Gaussian blob
+    MeshDimension dim(41, -1, 1);
+    auto mesh = std::make_shared<Mesh<2>>(MeshScalingType::Constant, dim, dim);
+    Field<double, 2, 2> U(mesh, "U");
+    Field<double, 1, 2> q0(mesh, "q");
+    const size_t nx = mesh->xCells();
+    for (size_t c=0; c<mesh->numCells(); c++) {
+        const double x = mesh->centres(0)[c % nx];
+        const double y = mesh->centres(1)[c / nx];
+        U.x()[c] = -y;
+        U.y()[c] = x;
+        q0.x()[c] = std::exp(-20*((x-0.4)*(x-0.4) + y*y));
+    }
+    const double dt = 0.2*(2.0/41);
+    UpwindAdvectionStep<2> step(U, dt);
+    const size_t nSteps = 11;
+
+    std::vector<double> ref = q0.x();
+    TemporalBlocking<2> plain(mesh, 1, {{ 41, 41 }});
+    plain.advance(ref, nSteps, step);
+
+    SECTION("One step per block matches a direct loop") {
+        std::vector<double> q = q0.x(), next(q.size());
+        for (size_t s=0; s<nSteps; s++) {
+            for (size_t c=0; c<q.size(); c++) {
+                const size_t i = c % nx, j = c / nx;
+                const double qm[2] = { q[i > 0 ? c-1 : c],
+                                       q[j > 0 ? c-nx : c] };
+                const double qp[2] = { q[i+1 < nx ? c+1 : c],
+                                       q[j+1 < nx ? c+nx : c] };
+                const size_t idx[2] = { i, j };
+                double dqdt = 0;
+                for (size_t d=0; d<2; d++) {
+                    const double u = U.component(d)[c];
+                    const auto& m = mesh->metrics(d);
+                    dqdt -= (u > 0)
+                        ? u*(q[c] - qm[d])*m.invCentreSpacing[idx[d]]
+                        : u*(qp[d] - q[c])*m.invCentreSpacing[idx[d]+1];
+                }
+                next[c] = q[c] + dt*dqdt;
+            }
+            q.swap(next);
+        }
+        REQUIRE(q == ref);
+    }
+
+    SECTION("Blocking and tiling do not change the result") {
+        for (size_t k : { 2, 4, 11, 16 }) {
+            TemporalBlocking<2> blocked(mesh, k, {{ 6, 9 }});
+            std::vector<double> q = q0.x();
+            const double* buffer = q.data();
+            blocked.advance(q, nSteps, step);
+            REQUIRE(q == ref);
+            // An odd or even number of blocks, and q keeps its storage
+            REQUIRE(q.data() == buffer);
+        }
+        // Default tiles
+        TemporalBlocking<2> blocked(mesh, 4);
+        std::vector<double> q = q0.x();
+        blocked.advance(q, nSteps, step);
+        REQUIRE(q == ref);
+    }
+
+    SECTION("Advances from several threads share a pool") {
+        // Outside threads help with each other's tiles while they wait
+        Parallel::ThreadPool shared(4);
+        const std::vector<double> start = q0.x();
+        std::atomic<size_t> wrong(0);
+        std::vector<std::thread> threads;
+        for (size_t i=0; i<4; i++) {
+            threads.emplace_back([&]() {
+                TemporalBlocking<2> blocked(mesh, 4, {{ 6, 9 }}, shared);
+                for (size_t rep=0; rep<10; rep++) {
+                    std::vector<double> q = start;
+                    blocked.advance(q, nSteps, step);
+                    wrong += (q != ref);
+                }
+            });
+        }
+        for (std::thread& t : threads) {
+            t.join();
+        }
+        REQUIRE(wrong == 0);
+    }
+
+    SECTION("The blob moves anticlockwise") {
+        size_t peak = std::max_element(ref.begin(), ref.end()) - ref.begin();
+        REQUIRE(mesh->centres(1)[peak / nx] > 0);
+    }
+}
+
+TEST_CASE("Stencil descriptions", "[stencil]") {
+    using namespace FieldOps::Stencils;
+    static_assert(CentralFirst::coeffs[0] == -0.5
+                  && CentralFirst::coeffs[1] == 0.5, "");
+    static_assert(CentralSecond::coeffs[1] == -2, "");
+    static_assert(CentralFirst4::reach == 2, "");
+
+    MeshDimension xDim(29, -1, 2), yDim(17, 0, 1), zDim(11, 0, 3);
+
+    SECTION("Coefficients at unit spacing") {
+        const std::array<double, 4> c4 = CentralFirst4::coeffs;
+        REQUIRE(c4[0] == Approx(1.0/12));
+        REQUIRE(c4[1] == Approx(-2.0/3));
+        REQUIRE(c4[2] == Approx(2.0/3));
+        REQUIRE(c4[3] == Approx(-1.0/12));
+        REQUIRE(BackwardFirst::coeffs[0] == Approx(-1));
+        REQUIRE(BackwardFirst::coeffs[1] == Approx(1));
+    }
+
+    SECTION("Exact on polynomials of the stencil's order, any spacing") {
+        for (auto scaling : { MeshScalingType::Constant,
+                              MeshScalingType::Hyperbolic }) {
+            auto mesh = std::make_shared<Mesh<2>>(scaling, xDim, yDim);
+            const size_t nx = mesh->xCells(), ny = mesh->yCells();
+            Field<double, 1, 2> f(mesh, "f"), lap(mesh, "lap");
+            Field<double, 2, 2> grad(mesh, "grad");
+            for (size_t c=0; c<mesh->numCells(); c++) {
+                const double x = mesh->centres(0)[c % nx];
+                const double y = mesh->centres(1)[c / nx];
+                f.x()[c] = x*x*x - 2*x*y*y + y;
+            }
+            gradient<CentralFirst4>(f, grad);
+            laplacian<CentralSecond>(f, lap);
+            // Second order Laplacian is exact for quadratics only, so
+            // check it where the cubic term vanishes: f_xx = 6x, f_yy = -4x
+            for (size_t j=2; j<ny-2; j++) {
+                for (size_t i=2; i<nx-2; i++) {
+                    const size_t c = j*nx + i;
+                    const double x = mesh->centres(0)[i];
+                    const double y = mesh->centres(1)[j];
+                    REQUIRE(grad.x()[c] == Approx(3*x*x - 2*y*y));
+                    REQUIRE(grad.y()[c] == Approx(-4*x*y + 1));
+                    if (scaling == MeshScalingType::Constant) {
+                        REQUIRE(lap.x()[c] == Approx(2*x).epsilon(1e-6));
+                    }
+                }
+            }
+        }
+    }
+
+    SECTION("Boundary values are reflected") {
+        auto mesh = std::make_shared<Mesh<1>>(MeshScalingType::Constant, xDim);
+        Field<double, 1, 1> f(mesh, "f");
+        for (size_t i=0; i<mesh->numCells(); i++) {
+            f.x()[i] = mesh->centres(0)[i];
+        }
+        Field<double, 1, 1> grad(mesh, "grad");
+        gradient<CentralFirst>(f, grad);
+        const size_t n = mesh->numCells();
+        // Ghost value equals the end cell, so a one-sided difference
+        REQUIRE(grad.x()[0] == Approx(0.5));
+        REQUIRE(grad.x()[n/2] == Approx(1));
+        REQUIRE(grad.x()[n-1] == Approx(0.5));
+    }
+
+    SECTION("Matches hand written loops in 3D") {
+        auto mesh = std::make_shared<Mesh<3>>(MeshScalingType::Constant,
+                                              xDim, yDim, zDim);
+        const auto& dims = mesh->dimSizes();
+        Field<double, 3, 3> F(mesh, "F");
+        Field<double, 1, 3> divF(mesh, "divF");
+        for (size_t d=0; d<3; d++) {
+            for (size_t c=0; c<mesh->numCells(); c++) {
+                F.component(d)[c] = std::sin(0.3*c + d);
+            }
+        }
+        div<divergenceType::Type1>(F, divF);
+        std::vector<double> ref(mesh->numCells(), 0.0);
+        size_t stride = 1;
+        for (size_t d=0; d<3; d++) {
+            const double inv2h = 0.5*dims[d]/(mesh->edges(d).back()
+                                              - mesh->edges(d).front());
+            const std::vector<double>& q = F.component(d);
+            for (size_t c=0; c<ref.size(); c++) {
+                const size_t i = (c / stride) % dims[d];
+                const size_t m = (i > 0 ? c - stride : c);
+                const size_t p = (i+1 < dims[d] ? c + stride : c);
+                ref[c] += (q[p] - q[m])*inv2h;
+            }
+            stride *= dims[d];
+        }
+        REQUIRE(matchVectorsApprox(divF.x(), ref));
+
+        Field<double, 1, 3> f(mesh, "f");
+        f.x() = F.x();
+        Field<double, 3, 3> g1(mesh, "g1"), g2(mesh, "g2");
+        ddx<gradType::CentralDifferencing>(f, g1);
+        gradient<CentralFirst>(f, g2);
+        REQUIRE(g1.z() == g2.z());
+    }
+}
+
+TEST_CASE("Narrow band stencils", "[active]") {
+    MeshDimension dim(40, -1, 1);
+    auto mesh = std::make_shared<Mesh<2>>(MeshScalingType::Hyperbolic,
+                                          dim, dim);
+    const size_t nx = mesh->xCells();
+    Field<double, 1, 2> q(mesh, "q"), lap(mesh, "lap"), ref(mesh, "ref");
+    Field<double, 2, 2> grad(mesh, "grad"), gradRef(mesh, "gradRef");
+    for (size_t c=0; c<mesh->numCells(); c++) {
+        const double x = mesh->centres(0)[c % nx];
+        const double y = mesh->centres(1)[c / nx];
+        q.x()[c] = std::exp(-30*((x-0.3)*(x-0.3) + y*y));
+    }
+    laplacian<Stencils::CentralSecond>(q, ref);
+    gradient<Stencils::CentralFirst4>(q, gradRef);
+
+    ActiveCells<2> band(mesh);
+    band.narrowBand(q.x(), 1e-3, 2);
+    REQUIRE(band.fraction() < 0.5);
+    REQUIRE(band.active(mesh->cellIndex({{ 26, 20 }})));
+
+    lap.setFixed(-1);
+    laplacian<Stencils::CentralSecond>(q, lap, band);
+    gradient<Stencils::CentralFirst4>(q, grad, band);
+    for (size_t c=0; c<mesh->numCells(); c++) {
+        if (band.active(c)) {
+            REQUIRE(lap.x()[c] == ref.x()[c]);
+            REQUIRE(grad.x()[c] == gradRef.x()[c]);
+            REQUIRE(grad.y()[c] == gradRef.y()[c]);
+        } else {
+            REQUIRE(lap.x()[c] == -1);
+        }
+    }
+
+    // Every cell active, including the boundaries
+    band.activateAll();
+    laplacian<Stencils::CentralSecond>(q, lap, band);
+    REQUIRE(lap.x() == ref.x());
+}
+
+TEST_CASE("Ensemble stencils", "[ensemble]") {
+    MeshDimension xDim(19, 0, 1), yDim(13, 0, 2), zDim(7, 0, 1);
+    const size_t nMembers = 6;
+    for (auto scaling : { MeshScalingType::Constant,
+                          MeshScalingType::Hyperbolic }) {
+        auto mesh = std::make_shared<Mesh<3>>(scaling, xDim, yDim, zDim);
+        EnsembleField<double, 1, 3> q(mesh, "q", nMembers),
+                                    lap(mesh, "lap", nMembers);
+        EnsembleField<double, 3, 3> grad(mesh, "grad", nMembers);
+        EnsembleField<double, 1, 3> div(mesh, "div", nMembers);
+        for (size_t c=0; c<mesh->numCells(); c++) {
+            for (size_t m=0; m<nMembers; m++) {
+                q(0, c, m) = std::sin(0.1*c*(m+1));
+            }
+        }
+        laplacian<Stencils::CentralSecond>(q, lap);
+        gradient<Stencils::CentralFirst4>(q, grad);
+        divergence<Stencils::CentralFirst>(grad, div);
+
+        // Member by member, through the single-Field kernels
+        for (size_t m=0; m<nMembers; m++) {
+            const Field<double, 1, 3> f = q.member(m);
+            Field<double, 1, 3> l(mesh, "l"), dv(mesh, "dv");
+            Field<double, 3, 3> g(mesh, "g");
+            laplacian<Stencils::CentralSecond>(f, l);
+            gradient<Stencils::CentralFirst4>(f, g);
+            divergence<Stencils::CentralFirst>(g, dv);
+            REQUIRE(lap.member(m) == l);
+            REQUIRE(grad.member(m) == g);
+            REQUIRE(div.member(m) == dv);
+        }
+    }
+}
+
+TEST_CASE("Out of core stencils", "[mapped]") {
+    const ScratchDirectory scratchDir("testOutOfCore.");
+    REQUIRE_FALSE(scratchDir.path().empty());
+    const std::string dir = scratchDir.path();
+    MeshDimension xDim(17, 0, 1), yDim(11, 0, 2), zDim(23, -1, 1);
+    auto mesh = std::make_shared<Mesh<3>>(MeshScalingType::Hyperbolic,
+                                          xDim, yDim, zDim);
+    Field<double, 1, 3> q(mesh, "q"), lap(mesh, "lap"), div(mesh, "div");
+    Field<double, 3, 3> grad(mesh, "grad");
+    for (size_t c=0; c<mesh->numCells(); c++) {
+        q.x()[c] = std::cos(0.05*c);
+    }
+    laplacian<Stencils::CentralSecond4>(q, lap);
+    gradient<Stencils::CentralFirst4>(q, grad);
+    divergence<Stencils::CentralFirst>(grad, div);
+
+    MappedField<double, 1, 3> mq(mesh, "oocQ", dir), mlap(mesh, "oocLap", dir),
+                              mdiv(mesh, "oocDiv", dir);
+    MappedField<double, 3, 3> mgrad(mesh, "oocGrad", dir);
+    REQUIRE(mq.good());
+    mq.assign(q);
+    // Slabs smaller than, equal to and larger than the reach, and default
+    for (size_t slab : { 1, 2, 5, 0 }) {
+        laplacian<Stencils::CentralSecond4>(mq, mlap, slab);
+        gradient<Stencils::CentralFirst4>(mq, mgrad, slab);
+        divergence<Stencils::CentralFirst>(mgrad, mdiv, slab);
+        REQUIRE(mlap.toField() == lap);
+        REQUIRE(mgrad.toField() == grad);
+        REQUIRE(mdiv.toField() == div);
+    }
+}
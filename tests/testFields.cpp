@@ -1,13 +1,21 @@
 #include "DataStructures/Field.tpp"
+#include "DataStructures/EnsembleField.tpp"
+#include "DataStructures/MappedField.tpp"
 #include "DataStructures/Mesh.h"
 #include "FieldOperations/FieldOperations.h"
 #include "DataStructures/BoundingBox.h"
 
 #include "catch.hpp"
+#include "scratchDirectory.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
 #include <memory>
 #include <iostream>
 #include <sstream>
+#include <unistd.h>
 
 template<size_t fD, size_t mD>
 bool allVals(const Field<double, fD, mD>& f, const double val) {
@@ -61,6 +69,63 @@ TEST_CASE("Mesh tests", "[mesh]") {
         REQUIRE(!mesh1D.isSameMesh(pivMesh1));
     }
 
+    SECTION ("Interned geometry") {
+        Mesh<2> other(s, defaultDim, defaultDim);
+        REQUIRE(other.geometry() == mesh2D.geometry());
+        REQUIRE(other.hash() == mesh2D.hash());
+        Mesh<2> copy(mesh2D);
+        REQUIRE(copy.geometry() == mesh2D.geometry());
+        REQUIRE(Mesh<2>(s, defaultDim, MeshDimension(10, 0, 2)).geometry()
+                != mesh2D.geometry());
+        REQUIRE(pivMesh1.geometry() != mesh1D.geometry());
+
+        std::weak_ptr<const MeshGeometry<1>> unique;
+        {
+            Mesh<1> tmp(s, MeshDimension(17, -3, 5));
+            unique = tmp.geometry();
+            Mesh<1> again(s, MeshDimension(17, -3, 5));
+            REQUIRE(again.geometry() == unique.lock());
+        }
+        // Released with the last Mesh using it
+        REQUIRE(unique.expired());
+        Mesh<1> rebuilt(s, MeshDimension(17, -3, 5));
+        REQUIRE(rebuilt.edges(0).back() == 5);
+    }
+
+    SECTION ("Cached metrics") {
+        Mesh<2> m(MeshScalingType::Hyperbolic, MeshDimension(12, -1, 2),
+                  MeshDimension(8, 0, 1));
+        for (size_t d=0; d<2; d++) {
+            const MeshMetrics& g = m.metrics(d);
+            const std::vector<double>& e = m.edges(d);
+            const std::vector<double>& x = m.centres(d);
+            const size_t N = x.size();
+            REQUIRE(g.width.size() == N);
+            REQUIRE(g.faceWeight.size() == N+1);
+            REQUIRE(reinterpret_cast<uintptr_t>(g.invWidth.data()) % 64 == 0);
+            REQUIRE(reinterpret_cast<uintptr_t>(g.faceWeight.data()) % 64 == 0);
+            double total = 0;
+            for (size_t i=0; i<N; i++) {
+                total += g.width[i];
+                REQUIRE(g.width[i]*g.invWidth[i] == Approx(1));
+            }
+            REQUIRE(total == Approx(e.back() - e.front()));
+            REQUIRE(g.centreSpacing[0] == Approx(x[0] - e[0]));
+            REQUIRE(g.centreSpacing[N] == Approx(e[N] - x[N-1]));
+            for (size_t f=1; f<N; f++) {
+                REQUIRE(g.centreSpacing[f] == Approx(x[f] - x[f-1]));
+                // Interpolating the centre positions gives the face position
+                const double w = g.faceWeight[f];
+                REQUIRE((1-w)*x[f-1] + w*x[f] == Approx(e[f]));
+            }
+        }
+        // Cached with the shared geometry
+        Mesh<2> same(MeshScalingType::Hyperbolic, MeshDimension(12, -1, 2),
+                     MeshDimension(8, 0, 1));
+        REQUIRE(&same.metrics(1) == &m.metrics(1));
+        REQUIRE(&m.reordered(CellOrdering::Morton).metrics(0) == &m.metrics(0));
+    }
+
     SECTION ("Mesh accessors") {
         REQUIRE(mesh1D.xCells() == mesh3D.xCells());
         REQUIRE(mesh1D.xCells() == mesh3D.yCells());
@@ -69,6 +134,110 @@ TEST_CASE("Mesh tests", "[mesh]") {
         REQUIRE(mesh1D.scalingType() != pivMesh1.scalingType());
         // TODO - Tests for values once operators implemented
     }
+
+    SECTION ("Point location") {
+        for (MeshScalingType t : { MeshScalingType::Constant,
+                                   MeshScalingType::Exponential,
+                                   MeshScalingType::Hyperbolic,
+                                   MeshScalingType::Pivot }) {
+            Mesh<2> m(t, MeshDimension(36, -1, 2), MeshDimension(50, 0, 0.1));
+            // Every edge belongs to the cell above it
+            for (size_t d=0; d<2; d++) {
+                const std::vector<double>& e = m.edges(d);
+                for (size_t i=0; i<e.size()-1; i++) {
+                    REQUIRE(m.locate(d, e[i]) == i);
+                    REQUIRE(m.locate(d, std::nextafter(e[i+1], e[i])) == i);
+                }
+                REQUIRE(m.locate(d, e.back()) == e.size()-2);
+                REQUIRE(m.locate(d, e.back() + 1) == e.size()-2);
+                REQUIRE(m.locate(d, e.front() - 1) == 0);
+            }
+            // Batched lookup agrees with a search of the edges
+            std::vector<std::array<double, 2>> pts;
+            for (size_t n=0; n<1000; n++) {
+                pts.push_back({{ -1 + 3*std::fmod(n*0.6180339887, 1.0),
+                                 0.1*std::fmod(n*0.4142135623, 1.0) }});
+            }
+            std::vector<size_t> cells;
+            m.locate(pts, cells);
+            REQUIRE(cells.size() == pts.size());
+            for (size_t n=0; n<pts.size(); n++) {
+                size_t idx = 0;
+                for (size_t d=2; d-- > 0;) {
+                    const std::vector<double>& e = m.edges(d);
+                    const size_t i = std::upper_bound(e.begin(), e.end(), pts[n][d])
+                                   - e.begin() - 1;
+                    idx = idx*m.dimSizes()[d] + i;
+                }
+                REQUIRE(cells[n] == idx);
+                REQUIRE(m.locate(pts[n]) == idx);
+            }
+        }
+    }
+}
+
+TEST_CASE("Cell orderings", "[ordering]") {
+    SECTION("Curve keys round trip") {
+        for (size_t k=0; k<16; k++) {
+            for (size_t j=0; j<16; j++) {
+                for (size_t i=0; i<16; i++) {
+                    const std::array<size_t, 3> idx {{ i, j, k }};
+                    REQUIRE(SFC::mortonDecode<3>(SFC::mortonEncode<3>(idx)) == idx);
+                    REQUIRE(SFC::hilbertDecode<3>(SFC::hilbertEncode<3>(idx, 4), 4)
+                            == idx);
+                }
+            }
+        }
+        REQUIRE(SFC::mortonEncode<2>({{ 3, 0 }}) == 5);
+        REQUIRE(SFC::mortonEncode<2>({{ 0, 3 }}) == 10);
+    }
+
+    SECTION("Consecutive Hilbert cells are face neighbours") {
+        for (uint64_t key=0; key+1<32*32; key++) {
+            const auto a = SFC::hilbertDecode<2>(key, 5);
+            const auto b = SFC::hilbertDecode<2>(key+1, 5);
+            const size_t dist = (a[0] > b[0] ? a[0]-b[0] : b[0]-a[0])
+                              + (a[1] > b[1] ? a[1]-b[1] : b[1]-a[1]);
+            REQUIRE(dist == 1);
+        }
+    }
+
+    SECTION("Reordered meshes") {
+        Mesh<3> lex(MeshScalingType::Constant, MeshDimension(6, 0, 1),
+                    MeshDimension(5, 0, 1), MeshDimension(3, 0, 1));
+        for (CellOrdering o : { CellOrdering::Tiled, CellOrdering::Morton,
+                                CellOrdering::Hilbert }) {
+            auto mesh = std::make_shared<Mesh<3>>(lex.reordered(o, 4));
+            REQUIRE(mesh->ordering() == o);
+            REQUIRE(*mesh != lex);
+            REQUIRE(*mesh == lex.reordered(o, 4));
+            // Storage indices are a permutation of the cells
+            std::vector<bool> seen(90, false);
+            for (size_t c=0; c<90; c++) {
+                const size_t s = mesh->storageIndex(c);
+                REQUIRE(s < 90);
+                REQUIRE(!seen[s]);
+                seen[s] = true;
+                REQUIRE(mesh->lexicographicIndex(s) == c);
+                REQUIRE(mesh->cellSubIndex(s) == lex.cellSubIndex(c));
+            }
+            const size_t s = mesh->cellIndex({{ 2, 4, 1 }});
+            REQUIRE(mesh->cellSubIndex(mesh->neighbour(s, 0, 1))
+                    == (std::array<size_t, 3>{{ 3, 4, 1 }}));
+            REQUIRE(mesh->neighbour(s, 1, 1) == Mesh<3>::npos);
+            REQUIRE(mesh->locate({{ 0.45, 0.9, 0.5 }}) == s);
+
+            // Lexicographic I/O is independent of the storage order
+            Field<double, 1, 3> f(mesh, "f");
+            std::vector<double> vals(90);
+            for (size_t c=0; c<90; c++) {
+                vals[c] = c;
+            }
+            f.setLexicographic(0, vals);
+            REQUIRE(f.x()[s] == lex.cellIndex({{ 2, 4, 1 }}));
+            REQUIRE(f.lexicographic(0) == vals);
+        }
+    }
 }
 
 TEST_CASE("Field tests", "[field]" ) {
@@ -99,6 +268,19 @@ TEST_CASE("Field tests", "[field]" ) {
         REQUIRE(tTwoV_size == 200);
     }
 
+    SECTION ("Storage locations") {
+        Field<double, 2, 2, FieldLocation::Staggered> mac(mesh2D, "mac");
+        REQUIRE(mac.x().size() == 110);
+        REQUIRE(mac.y().size() == 110);
+        REQUIRE(mac.dims(0)[0] == 11);
+        REQUIRE(mac.dims(1)[1] == 11);
+        Field<double, 1, 2, FieldLocation::Node> nodes(mesh2D, "nodes");
+        REQUIRE(nodes.x().size() == 121);
+        Field<double, 1, 1, FieldLocation::FaceX> faces(mesh1D, "faces");
+        REQUIRE(faces.x().size() == 11);
+        REQUIRE(nodes.numCells() == 100);
+    }
+
     SECTION ("Assignment") {
         // setFixed
         testOneS.setFixed(4.3);
@@ -134,6 +316,32 @@ TEST_CASE("Field tests", "[field]" ) {
             REQUIRE(copiedFieldV == testTwoV);
             REQUIRE(!copiedFieldV.strictlyEqual(testTwoV));
         }
+        SECTION ("Copy on write") {
+            testTwoV.setFixed(1);
+            Field<double, 2, 2> snapshot(testTwoV, "snapshot");
+            REQUIRE(snapshot.sharesStorageWith(testTwoV, 0));
+            REQUIRE(snapshot.isShared());
+            const Field<double, 2, 2>& original = testTwoV;
+            const double* before = original.y().data();
+            // Writing one component copies only that component
+            testTwoV.x()[3] = 5;
+            REQUIRE(!snapshot.sharesStorageWith(testTwoV, 0));
+            REQUIRE(snapshot.sharesStorageWith(testTwoV, 1));
+            REQUIRE(snapshot.x()[3] == 1);
+            REQUIRE(testTwoV.x()[3] == 5);
+            // Const access never detaches
+            const Field<double, 2, 2>& cref = snapshot;
+            REQUIRE(cref.y().data() == before);
+            REQUIRE(snapshot.isShared());
+            snapshot.detach();
+            REQUIRE(!snapshot.isShared());
+            REQUIRE(!testTwoV.isShared());
+            REQUIRE(snapshot.y() == testTwoV.y());
+            // By-value arithmetic leaves its argument alone
+            Field<double, 2, 2> sum = testTwoV + 1.0;
+            REQUIRE(testTwoV.y()[0] == 1);
+            REQUIRE(sum.y()[0] == 2);
+        }
         SECTION ("Moving") {
             Field<double, 1, 1> copiedField(testOneS);
             Field<double, 1, 1> movedField(std::move(copiedField));
@@ -200,6 +408,65 @@ TEST_CASE("Field tests", "[field]" ) {
             REQUIRE(allVals(testTwoV, 15));
         }
     }
+
+    SECTION ("Field-field arithmetic") {
+        Field<double, 2, 2> u(mesh2D, "u"), v(mesh2D, "v");
+        Field<double, 1, 2> s(mesh2D, "s");
+        for (size_t i=0; i<100; i++) {
+            u.x()[i] = i;
+            u.y()[i] = 2*i;
+            v.x()[i] = 1;
+            v.y()[i] = i + 1.0;
+            s.x()[i] = 0.5*i;
+        }
+        SECTION ("Elementwise operators") {
+            Field<double, 2, 2> w = u + v;
+            REQUIRE(w.x()[7] == 8);
+            REQUIRE(w.y()[7] == 22);
+            w = u - v;
+            REQUIRE(w.x()[7] == 6);
+            REQUIRE(w.y()[7] == 6);
+            w = u * v;
+            REQUIRE(w.y()[7] == 112);
+            w = u / v;
+            REQUIRE(w.y()[7] == Approx(14.0/8));
+            w = 1.0 - u / 2.0;
+            REQUIRE(w.x()[4] == -1);
+            // Operands are left alone
+            REQUIRE(u.x()[7] == 7);
+            REQUIRE(v.y()[7] == 8);
+        }
+        SECTION ("Scalar field times vector field") {
+            Field<double, 2, 2> w = s * u;
+            REQUIRE(w.x()[6] == 18);
+            REQUIRE(w.y()[6] == 36);
+            w = u * s;
+            REQUIRE(w.y()[6] == 36);
+            w /= s;
+            REQUIRE(w.y()[6] == 12);
+        }
+        SECTION ("axpy and fma") {
+            Field<double, 2, 2> w(u, "w");
+            w.axpy(2.0, v);
+            REQUIRE(w.x()[5] == 7);
+            REQUIRE(w.y()[5] == 22);
+            w.fma(u, v);
+            REQUIRE(w.x()[5] == 12);
+            REQUIRE(w.y()[5] == 82);
+            // Aliased operands
+            w.fma(w, w);
+            REQUIRE(w.x()[5] == 156);
+            REQUIRE(u.x()[5] == 5);
+        }
+        SECTION ("Shared operands") {
+            // A shared buffer is replaced by the result, not modified
+            Field<double, 2, 2> snapshot(u, "snapshot");
+            u += v;
+            REQUIRE(snapshot.x()[7] == 7);
+            REQUIRE(u.x()[7] == 8);
+            REQUIRE(!u.isShared());
+        }
+    }
 }
 
 TEST_CASE("Bounding boxes", "[bounds]") {
@@ -284,6 +551,351 @@ TEST_CASE("Bounding boxes", "[bounds]") {
     }
 }
 
+TEST_CASE("Active cells", "[active]") {
+    MeshDimension xDim(20, 0, 1), yDim(15, 0, 1);
+    auto mesh = std::make_shared<Mesh<2>>(MeshScalingType::Constant,
+                                          xDim, yDim);
+    const size_t nx = mesh->xCells();
+    ActiveCells<2> active(mesh);
+    REQUIRE(active.empty());
+    REQUIRE(active.runs().empty());
+
+    SECTION("Selection, lookups and runs") {
+        // Columns 3 and 4 of every row
+        active.select([nx](const size_t c) {
+            return c % nx == 3 || c % nx == 4;
+        });
+        REQUIRE(active.size() == 2*mesh->yCells());
+        REQUIRE(active.runs().size() == mesh->yCells());
+        REQUIRE(active.runs()[1] == ActiveCells<2>::Run(nx+3, nx+5));
+        REQUIRE(active.active(nx+4));
+        REQUIRE_FALSE(active.active(nx+5));
+        REQUIRE(active.fraction() == Approx(0.1));
+
+        active.activate({ 5, 6, 0 });
+        REQUIRE(active.runs()[0] == ActiveCells<2>::Run(0, 1));
+        REQUIRE(active.runs()[1] == ActiveCells<2>::Run(3, 7));
+        REQUIRE(std::is_sorted(active.cells().begin(), active.cells().end()));
+
+        active.clear();
+        REQUIRE(active.empty());
+        for (size_t c=0; c<mesh->numCells(); c++) {
+            REQUIRE_FALSE(active.active(c));
+        }
+        active.activateAll();
+        REQUIRE(active.runs().size() == 1);
+        REQUIRE(active.size() == mesh->numCells());
+
+        // Long runs are split so they share out over the thread pool
+        MeshDimension big(int(Parallel::defaultGrain) + 10, 0, 1);
+        ActiveCells<1> all(std::make_shared<Mesh<1>>(
+                               MeshScalingType::Constant, big));
+        all.activateAll();
+        REQUIRE(all.runs().size() == 2);
+        REQUIRE(all.runs()[1].first == Parallel::defaultGrain);
+    }
+
+    SECTION("Narrow bands follow a moving front") {
+        std::vector<double> q(mesh->numCells(), 0.0);
+        q[mesh->cellIndex({{ 10, 7 }})] = 1;
+        active.narrowBand(q, 0.5, 2);
+        REQUIRE(active.size() == 25);
+        REQUIRE(active.active(mesh->cellIndex({{ 8, 9 }})));
+        REQUIRE_FALSE(active.active(mesh->cellIndex({{ 7, 7 }})));
+
+        // Move the front two cells; the band catches it without a scan
+        std::fill(q.begin(), q.end(), 0.0);
+        q[mesh->cellIndex({{ 12, 7 }})] = 1;
+        active.updateBand(q, 0.5, 2);
+        REQUIRE(active.size() == 25);
+        REQUIRE(active.active(mesh->cellIndex({{ 14, 9 }})));
+        REQUIRE_FALSE(active.active(mesh->cellIndex({{ 9, 7 }})));
+
+        // Clipped at the Mesh edge
+        std::fill(q.begin(), q.end(), 0.0);
+        q[mesh->cellIndex({{ 0, 0 }})] = -1;
+        active.narrowBand(q, 0.5, 2);
+        REQUIRE(active.size() == 9);
+    }
+
+    SECTION("Field operations on active cells only") {
+        Field<double, 2, 2> U(mesh, "U"), V(mesh, "V");
+        U.setFixed(1);
+        V.setFixed(2);
+        Field<double, 2, 2> shared(U);
+        active.select([](const size_t c) { return c % 7 == 0; });
+        U.axpy(3, V, active);
+        for (size_t c=0; c<mesh->numCells(); c++) {
+            REQUIRE(U.x()[c] == (c % 7 == 0 ? 7 : 1));
+            REQUIRE(U.y()[c] == (c % 7 == 0 ? 7 : 1));
+        }
+        // The copy sharing U's old storage is untouched
+        REQUIRE(shared.x()[0] == 1);
+        V.setFixed(0, active);
+        REQUIRE(V.x()[7] == 0);
+        REQUIRE(V.x()[8] == 2);
+    }
+}
+
+TEST_CASE("Ensemble fields", "[ensemble]") {
+    MeshDimension xDim(6, 0, 1), yDim(4, 0, 1);
+    auto mesh = std::make_shared<Mesh<2>>(MeshScalingType::Constant,
+                                          xDim, yDim);
+    const size_t nMembers = 5;
+    EnsembleField<double, 2, 2> E(mesh, "U", nMembers);
+    REQUIRE(E.numMembers() == nMembers);
+    REQUIRE(E.component(1).size() == mesh->numCells()*nMembers);
+
+    std::vector<Field<double, 2, 2>> members;
+    for (size_t m=0; m<nMembers; m++) {
+        members.emplace_back(mesh, "U");
+        for (size_t c=0; c<mesh->numCells(); c++) {
+            members[m].x()[c] = c + 100.0*m;
+            members[m].y()[c] = -double(m);
+        }
+        E.setMember(m, members[m]);
+    }
+
+    SECTION("Members are interleaved per cell") {
+        REQUIRE(E.component(0)[3*nMembers + 2] == 203);
+        REQUIRE(E(0, 3, 2) == 203);
+        REQUIRE(E(1, 7, 4) == -4);
+        for (size_t m=0; m<nMembers; m++) {
+            REQUIRE(E.member(m) == members[m]);
+        }
+    }
+
+    SECTION("Arithmetic acts on every member") {
+        EnsembleField<double, 2, 2> F(members[1], nMembers);
+        REQUIRE(F.member(3) == members[1]);
+        E.axpy(2, F);
+        E *= 0.5;
+        Field<double, 2, 2> expect = members[4];
+        expect.axpy(2, members[1]);
+        expect *= 0.5;
+        REQUIRE(E.member(4) == expect);
+        E -= E;
+        for (double v : E.component(0)) {
+            REQUIRE(v == 0);
+        }
+    }
+
+    SECTION("Mean over the members") {
+        const Field<double, 2, 2> mean = E.mean();
+        REQUIRE(mean.x()[3] == Approx(203));
+        REQUIRE(mean.y()[0] == Approx(-2));
+    }
+}
+
+TEST_CASE("Mapped fields", "[mapped]") {
+    namespace fs = std::filesystem;
+    // Removed with its files however the section ends
+    const ScratchDirectory scratchDir("testMappedFields.");
+    REQUIRE_FALSE(scratchDir.path().empty());
+    const std::string dir = scratchDir.path();
+    MeshDimension xDim(30, 0, 1), yDim(20, 0, 1);
+    auto mesh = std::make_shared<Mesh<2>>(MeshScalingType::Constant,
+                                          xDim, yDim);
+    Field<double, 2, 2> U(mesh, "U");
+    for (size_t c=0; c<mesh->numCells(); c++) {
+        U.x()[c] = 0.5*c;
+        U.y()[c] = -1.0*c;
+    }
+
+    SECTION("Values round trip through the files") {
+        MappedField<double, 2, 2> M(mesh, "mappedU", dir);
+        REQUIRE(M.good());
+        REQUIRE(fs::file_size(M.path(1)) == mesh->numCells()*sizeof(double));
+        M.assign(U);
+        REQUIRE(M.component(0)[7] == 3.5);
+        // Hints do not change the contents
+        M.advise(MappedField<double, 2, 2>::Access::Sequential);
+        M.prefetch(0, 100);
+        M.release(0, mesh->numCells());
+        REQUIRE(M.toField() == U);
+    }
+
+    SECTION("Scratch files are removed, kept files reopened") {
+        std::string scratch;
+        {
+            MappedField<double, 2, 2> M(mesh, "mappedScratch", dir);
+            scratch = M.path(0);
+            REQUIRE(fs::exists(scratch));
+        }
+        REQUIRE_FALSE(fs::exists(scratch));
+
+        std::string kept;
+        {
+            MappedField<double, 2, 2> M(mesh, "mappedKept", dir, true);
+            M.assign(U);
+            M.flush();
+            kept = M.path(1);
+        }
+        {
+            MappedField<double, 2, 2> M(mesh, "mappedKept", dir, true);
+            REQUIRE(M.component(1)[10] == -10);
+        }
+        REQUIRE(fs::exists(kept));
+    }
+
+    SECTION("Existing files are not taken over or resized") {
+        std::string path;
+        {
+            MappedField<double, 1, 2> M(mesh, "mappedExisting", dir, true);
+            REQUIRE(M.good());
+            M.component(0)[3] = 42;
+            M.flush();
+            path = M.path(0);
+        }
+        const auto size = fs::file_size(path);
+        {
+            // Scratch files must be new, and leave the existing file alone
+            MappedField<double, 1, 2> M(mesh, "mappedExisting", dir);
+            REQUIRE_FALSE(M.good());
+        }
+        REQUIRE(fs::exists(path));
+        {
+            // A kept file of another size is not truncated
+            auto small = std::make_shared<Mesh<2>>(
+                MeshScalingType::Constant, MeshDimension(4, 0, 1),
+                MeshDimension(4, 0, 1));
+            MappedField<double, 1, 2> M(small, "mappedExisting", dir, true);
+            REQUIRE_FALSE(M.good());
+        }
+        REQUIRE(fs::file_size(path) == size);
+        {
+            MappedField<double, 1, 2> M(mesh, "mappedExisting", dir, true);
+            REQUIRE(M.good());
+            REQUIRE(M.component(0)[3] == 42);
+        }
+    }
+
+    SECTION("Unmappable locations are reported") {
+        MappedField<double, 1, 2> M(mesh, "q", dir + "/no/such/directory");
+        REQUIRE_FALSE(M.good());
+    }
+}
+
+TEST_CASE("Memory placement", "[memory]") {
+    using Parallel::MemoryPolicy;
+    MeshDimension xDim(512, 0, 1), yDim(512, 0, 1);
+    auto mesh = std::make_shared<Mesh<2>>(MeshScalingType::Constant,
+                                          xDim, yDim);
+    Field<double, 1, 2> q(mesh, "q");
+    std::vector<double>& v = q.component(0);
+    for (size_t i=0; i<v.size(); i++) {
+        v[i] = double(i);
+    }
+    const size_t nNodes = Parallel::Memory::numNodes();
+    REQUIRE(nNodes >= 1);
+
+    auto present = [](const Parallel::MemoryReport& r) {
+        size_t n = 0;
+        for (size_t p : r.pagesPerNode) {
+            n += p;
+        }
+        return n;
+    };
+    auto unchanged = [&q]() {
+        const std::vector<double>& w = q.component(0);
+        for (size_t i=0; i<w.size(); i++) {
+            if (w[i] != double(i)) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    SECTION("Every page is accounted for") {
+        const Parallel::MemoryReport r = q.placement(0);
+        REQUIRE(r.pagesPerNode.size() == nNodes);
+        REQUIRE(r.pages > 0);
+        REQUIRE(r.pages*sysconf(_SC_PAGESIZE) <= v.size()*sizeof(double));
+        REQUIRE(present(r) + r.notPresent == r.pages);
+        // Written above, so present
+        REQUIRE(present(r) == r.pages);
+    }
+
+    SECTION("Policies keep the values") {
+        MemoryPolicy policy;
+        for (MemoryPolicy::Pages pages : { MemoryPolicy::Pages::Default,
+                                           MemoryPolicy::Pages::Huge }) {
+            for (MemoryPolicy::Placement placement :
+                 { MemoryPolicy::Placement::Default,
+                   MemoryPolicy::Placement::Interleave,
+                   MemoryPolicy::Placement::Bind,
+                   MemoryPolicy::Placement::LocalPartitions }) {
+                policy.pages = pages;
+                policy.placement = placement;
+                q.setMemoryPolicy(policy);
+                REQUIRE(unchanged());
+                const Parallel::MemoryReport r = q.placement(0);
+                REQUIRE(present(r) + r.notPresent == r.pages);
+            }
+        }
+    }
+
+    SECTION("Shared buffers are detached before placing") {
+        Field<double, 1, 2> copy(q, "copy");
+        REQUIRE(copy.sharesStorageWith(q, 0));
+        MemoryPolicy policy;
+        policy.placement = MemoryPolicy::Placement::Interleave;
+        copy.setMemoryPolicy(policy);
+        REQUIRE_FALSE(copy.sharesStorageWith(q, 0));
+        REQUIRE(copy == q);
+        REQUIRE(unchanged());
+    }
+
+    SECTION("Bound pages are on the node") {
+        MemoryPolicy policy;
+        policy.placement = MemoryPolicy::Placement::Bind;
+        policy.node = int(nNodes) - 1;
+        if (q.setMemoryPolicy(policy)) {
+            const Parallel::MemoryReport r = q.placement(0);
+            REQUIRE(r.pagesPerNode[policy.node] == present(r));
+        }
+    }
+
+    SECTION("New buffers get the default policy") {
+        MemoryPolicy policy;
+        policy.pages = MemoryPolicy::Pages::Huge;
+        policy.placement = MemoryPolicy::Placement::Interleave;
+
+        // Big enough to hold whole huge pages
+        MeshDimension bigDim(1024, 0, 1);
+        auto bigMesh = std::make_shared<Mesh<2>>(MeshScalingType::Constant,
+                                                 bigDim, bigDim);
+        Field<double, 1, 2> big(bigMesh, "big");
+        big.component(0).assign(bigMesh->numCells(), 1.0);
+
+        // What this kernel does with the same request on a control buffer
+        Field<double, 1, 2> control(big, "control");
+        const bool placed = control.setMemoryPolicy(policy);
+        const bool hugeWorks = placed && control.placement(0).hugeBytes > 0;
+
+        Parallel::Memory::setDefaultPolicy(policy);
+        Field<double, 1, 2> p(big);
+        p *= 2.0;
+        Parallel::Memory::setDefaultPolicy(MemoryPolicy());
+        REQUIRE_FALSE(p.sharesStorageWith(big, 0));
+        REQUIRE(p.component(0)[7] == 2.0);
+        REQUIRE(big.component(0)[7] == 1.0);
+        REQUIRE(Parallel::Memory::defaultPolicy().isDefault());
+
+        const Parallel::MemoryReport r = p.placement(0);
+        if (hugeWorks) {
+            REQUIRE(r.hugeBytes > 0);
+        }
+        if (placed && nNodes > 1) {
+            size_t nodesUsed = 0;
+            for (size_t n : r.pagesPerNode) {
+                nodesUsed += (n > 0);
+            }
+            REQUIRE(nodesUsed > 1);
+        }
+    }
+}
+
 TEST_CASE("Spacial gradients", "[grad]") {
 
 }
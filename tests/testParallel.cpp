@@ -0,0 +1,322 @@
+#include "Parallel/CaseRunner.h"
+#include "Parallel/ParallelFor.h"
+#include "Parallel/ParallelRange.h"
+#include "Parallel/TaskGraph.h"
+#include "Parallel/ThreadPool.h"
+
+#include "DataStructures/Mesh.h"
+
+#include "catch.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+using namespace Parallel;
+
+TEST_CASE("Thread pool", "[parallel]") {
+    SECTION("Every task runs once") {
+        for (size_t nThreads : { 1, 4 }) {
+            ThreadPool pool(nThreads);
+            REQUIRE(pool.size() == nThreads);
+            std::vector<std::atomic<int>> counts(1000);
+            std::atomic<size_t> done(0);
+            for (size_t i=0; i<counts.size(); i++) {
+                pool.submit([&counts, &done, i]() {
+                    counts[i]++;
+                    done++;
+                });
+            }
+            pool.helpUntil([&done, &counts]() {
+                return done == counts.size();
+            });
+            for (auto& c : counts) {
+                REQUIRE(c == 1);
+            }
+        }
+    }
+
+    SECTION("Tasks can submit tasks") {
+        for (size_t nThreads : { 1, 4 }) {
+            ThreadPool pool(nThreads);
+            std::atomic<size_t> done(0);
+            for (size_t i=0; i<10; i++) {
+                pool.submit([&pool, &done]() {
+                    for (size_t j=0; j<10; j++) {
+                        pool.submit([&done]() { done++; });
+                    }
+                });
+            }
+            pool.helpUntil([&done]() { return done == 100; });
+            REQUIRE(done == 100);
+        }
+    }
+
+    SECTION("Outside threads get slots of their own") {
+        for (size_t nThreads : { 1, 4 }) {
+            ThreadPool pool(nThreads);
+            // Set while a thread runs a piece in that slot
+            std::vector<std::atomic<bool>> busy(pool.numSlots());
+            std::atomic<size_t> clashes(0), outOfRange(0);
+            auto loops = [&]() {
+                for (size_t rep=0; rep<20; rep++) {
+                    parallelFor(pool, 0, 64, [&](size_t, size_t) {
+                        const size_t t = pool.threadIndex();
+                        if (t == 0 || t >= pool.numSlots()) {
+                            outOfRange++;
+                            return;
+                        }
+                        if (busy[t].exchange(true)) {
+                            clashes++;
+                        }
+                        std::this_thread::yield();
+                        busy[t] = false;
+                    }, 1);
+                }
+            };
+            std::vector<std::thread> threads;
+            for (size_t i=0; i<6; i++) {
+                threads.emplace_back(loops);
+            }
+            for (std::thread& t : threads) {
+                t.join();
+            }
+            REQUIRE(outOfRange == 0);
+            REQUIRE(clashes == 0);
+            // Not in the pool outside a loop
+            REQUIRE(pool.threadIndex() == 0);
+        }
+    }
+}
+
+TEST_CASE("Task graph", "[parallel]") {
+    const size_t n = 1000;
+    std::vector<double> a(n), b(n), c(n), d(n);
+    const size_t nTiles = 7;
+    auto tiled = [n, nTiles](std::vector<double>& out, auto f) {
+        return [&out, f, n, nTiles](size_t tile) {
+            size_t begin, end;
+            chunkRange(n, nTiles, tile, begin, end);
+            for (size_t i=begin; i<end; i++) {
+                out[i] = f(i);
+            }
+        };
+    };
+
+    // a = i;  b = a + 1;  c = 2a;  d = b + c;  a = d - b
+    TaskGraph graph;
+    double offset = 0;
+    const size_t ka = graph.add(tiled(a, [&offset](size_t i) {
+        return i + offset;
+    }), nTiles, {}, { &a });
+    const size_t kb = graph.add(tiled(b, [&a](size_t i) { return a[i] + 1; }),
+                                nTiles, { &a }, { &b });
+    const size_t kc = graph.add(tiled(c, [&a](size_t i) { return 2*a[i]; }),
+                                nTiles, { &a }, { &c });
+    const size_t kd = graph.add(tiled(d, [&b, &c](size_t i) {
+        return b[i] + c[i];
+    }), nTiles, { &b, &c }, { &d });
+    const size_t ke = graph.add([&a, &b, &d, n]() {
+        for (size_t i=0; i<n; i++) {
+            a[i] = d[i] - b[i];
+        }
+    }, { &b, &d }, { &a });
+
+    SECTION("Dependencies") {
+        REQUIRE(graph.numKernels() == 5);
+        REQUIRE(graph.predecessors(ka).empty());
+        REQUIRE(graph.predecessors(kb) == std::vector<size_t>{ ka });
+        REQUIRE(graph.predecessors(kc) == std::vector<size_t>{ ka });
+        REQUIRE(graph.predecessors(kd) == (std::vector<size_t>{ kb, kc }));
+        // Overwriting a waits for its readers as well as its last writer
+        REQUIRE(graph.predecessors(ke)
+                == (std::vector<size_t>{ ka, kb, kc, kd }));
+        REQUIRE(graph.successors(ka) == (std::vector<size_t>{ kb, kc, ke }));
+    }
+
+    SECTION("Replaying matches the sequential result") {
+        for (size_t nThreads : { 1, 3 }) {
+            ThreadPool pool(nThreads);
+            for (size_t step=0; step<5; step++) {
+                offset = step;
+                graph.run(pool);
+                for (size_t i=0; i<n; i++) {
+                    const double ai = i + offset;
+                    REQUIRE(b[i] == ai + 1);
+                    REQUIRE(d[i] == 3*ai + 1);
+                    REQUIRE(a[i] == 2*ai);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Parallel ranges", "[parallel]") {
+    ThreadPool pool(4, true);
+
+    SECTION("Every index is visited once") {
+        std::vector<std::atomic<int>> hits(37*19*11);
+        Range<3> r = fullRange<3>({{ 37, 19, 11 }});
+        std::atomic<size_t> pieces(0);
+        parallelFor(pool, r, [&hits, &pieces](const Range<3>& p) {
+            pieces++;
+            for (size_t k=p.begin[2]; k<p.end[2]; k++) {
+                for (size_t j=p.begin[1]; j<p.end[1]; j++) {
+                    for (size_t i=p.begin[0]; i<p.end[0]; i++) {
+                        hits[i + 37*(j + 19*k)]++;
+                    }
+                }
+            }
+        }, 64);
+        REQUIRE(pieces > 1);
+        for (auto& h : hits) {
+            REQUIRE(h == 1);
+        }
+
+        std::vector<std::atomic<int>> hits1D(100000);
+        parallelFor(pool, 0, hits1D.size(), [&hits1D](size_t b, size_t e) {
+            for (size_t i=b; i<e; i++) {
+                hits1D[i]++;
+            }
+        });
+        for (auto& h : hits1D) {
+            REQUIRE(h == 1);
+        }
+    }
+
+    SECTION("Pieces are split along the outer dimensions first") {
+        Range<2> r = fullRange<2>({{ 64, 64 }});
+        std::atomic<bool> wholeRows(true);
+        parallelFor(pool, r, [&wholeRows](const Range<2>& p) {
+            if (p.begin[0] != 0 || p.end[0] != 64) {
+                wholeRows = false;
+            }
+        }, 256);
+        REQUIRE(wholeRows);
+    }
+
+    SECTION("Small ranges run inline") {
+        std::vector<std::thread::id> threads;
+        parallelFor(pool, 0, 100, [&threads](size_t, size_t) {
+            threads.push_back(std::this_thread::get_id());
+        });
+        REQUIRE(threads == std::vector<std::thread::id>{
+                               std::this_thread::get_id() });
+    }
+}
+
+namespace {
+    // Cases the calling thread is inside
+    thread_local int caseDepth = 0;
+}
+
+TEST_CASE("Case runner", "[parallel]") {
+    SECTION("Cases run once each, largest estimate first") {
+        ThreadPool pool(3);
+        CaseRunner runner(pool, 1);
+        std::vector<int> runs(5, 0);
+        const double costs[5] = { 2, 9, 1, 9, 5 };
+        for (size_t i=0; i<5; i++) {
+            runner.add("case" + std::to_string(i), costs[i],
+                       [&runs, i]() { runs[i]++; });
+        }
+        REQUIRE(runner.numCases() == 5);
+        runner.run();
+        REQUIRE(runs == std::vector<int>(5, 1));
+        REQUIRE(runner.numCases() == 0);
+
+        const auto& r = runner.results();
+        REQUIRE(r.size() == 5);
+        REQUIRE(r[2].name == "case2");
+        // One at a time, so they start in order of cost
+        const size_t expectOrder[5] = { 3, 0, 4, 1, 2 };
+        for (size_t i=0; i<5; i++) {
+            REQUIRE(r[i].startOrder == expectOrder[i]);
+            REQUIRE(r[i].slot == 0);
+        }
+    }
+
+    SECTION("Loops inside cases share the pool without nesting cases") {
+        for (size_t nThreads : { 1, 4 }) {
+            ThreadPool pool(nThreads);
+            CaseRunner runner(pool);
+            const size_t nCases = 12, n = 20000;
+            std::vector<double> sums(nCases, 0.0);
+            std::atomic<int> maxDepth(0);
+            for (size_t c=0; c<nCases; c++) {
+                runner.add("sum", double(c), [&, c]() {
+                    caseDepth++;
+                    int d = maxDepth;
+                    while (caseDepth > d
+                           && !maxDepth.compare_exchange_weak(d, caseDepth)) {}
+                    std::vector<double> partial(n, 0.0);
+                    parallelFor(pool, 0, n, [&](size_t b, size_t e) {
+                        for (size_t i=b; i<e; i++) {
+                            partial[i] = double(i % (c+1));
+                        }
+                    }, 500);
+                    sums[c] = std::accumulate(partial.begin(), partial.end(),
+                                              0.0);
+                    caseDepth--;
+                });
+            }
+            runner.run();
+            const int depth = maxDepth;
+            REQUIRE(depth == 1);
+            for (size_t c=0; c<nCases; c++) {
+                double expect = 0;
+                for (size_t i=0; i<n; i++) {
+                    expect += double(i % (c+1));
+                }
+                REQUIRE(sums[c] == expect);
+            }
+            for (const auto& r : runner.results()) {
+                REQUIRE(r.slot < pool.size());
+            }
+        }
+    }
+
+    SECTION("More slots than threads park until a thread is free") {
+        ThreadPool pool(2);
+        CaseRunner runner(pool, 6);
+        const size_t nCases = 9, n = 8000;
+        std::vector<int> runs(nCases, 0);
+        for (size_t c=0; c<nCases; c++) {
+            runner.add("loop", 1, [&, c]() {
+                std::vector<double> v(n);
+                parallelFor(pool, 0, n, [&v](size_t b, size_t e) {
+                    for (size_t i=b; i<e; i++) {
+                        v[i] = 1.0;
+                    }
+                }, 100);
+                runs[c] += int(std::accumulate(v.begin(), v.end(), 0.0) == n);
+            });
+        }
+        runner.run();
+        REQUIRE(runs == std::vector<int>(nCases, 1));
+        for (const auto& r : runner.results()) {
+            REQUIRE(r.slot < 6);
+        }
+    }
+
+    SECTION("Meshes built by separate cases share their geometry") {
+        ThreadPool pool(4);
+        CaseRunner runner(pool);
+        std::vector<std::shared_ptr<const Mesh<2>>> meshes(8);
+        for (size_t c=0; c<meshes.size(); c++) {
+            runner.add("mesh", 1, [&meshes, c]() {
+                MeshDimension dim(64, 0, 1);
+                meshes[c] = std::make_shared<Mesh<2>>(
+                    MeshScalingType::Constant, dim, dim);
+            });
+        }
+        runner.run();
+        for (const auto& m : meshes) {
+            REQUIRE(m->geometry() == meshes[0]->geometry());
+        }
+    }
+}
@@ -0,0 +1,137 @@
+#include "DataStructures/Field.tpp"
+#include "DataStructures/Mesh.h"
+#include "Particles/Particles.h"
+#include "Parallel/ThreadPool.h"
+
+#include "catch.hpp"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+using namespace Particles;
+
+namespace {
+    // Solid body rotation U = (-y, x) about the origin
+    Field<double, 2, 2> rotation(const std::shared_ptr<Mesh<2>>& mesh) {
+        Field<double, 2, 2> U(mesh, "U");
+        const size_t nx = mesh->xCells();
+        for (size_t j=0; j<mesh->yCells(); j++) {
+            for (size_t i=0; i<nx; i++) {
+                U.x()[i + nx*j] = -mesh->centres(1)[j];
+                U.y()[i + nx*j] =  mesh->centres(0)[i];
+            }
+        }
+        return U;
+    }
+
+    std::vector<std::array<double, 2>> ring(const size_t n, const double r) {
+        std::vector<std::array<double, 2>> pts;
+        for (size_t p=0; p<n; p++) {
+            const double t = 6.283185307179586*p/n;
+            pts.push_back({{ r*std::cos(t), r*std::sin(t) }});
+        }
+        return pts;
+    }
+}
+
+TEST_CASE("Particle storage", "[particles]") {
+    auto mesh = std::make_shared<Mesh<2>>(MeshScalingType::Exponential,
+                                          MeshDimension(12, 0, 1),
+                                          MeshDimension(7, 0, 2));
+    Parallel::ThreadPool pool(2);
+    ParticleSet<2> set(mesh, pool);
+    std::vector<std::array<double, 2>> pts;
+    for (size_t p=0; p<500; p++) {
+        pts.push_back({{ std::fmod(p*0.618034, 1.0),
+                         2*std::fmod(p*0.414214, 1.0) }});
+    }
+    set.add(pts);
+    REQUIRE(set.size() == 500);
+
+    SECTION("Sorting bins particles by cell") {
+        set.sort();
+        REQUIRE(set.isSorted());
+        REQUIRE(set.binBegin(0) == 0);
+        REQUIRE(set.binBegin(mesh->numCells()) == 500);
+        for (size_t c=0; c<mesh->numCells(); c++) {
+            for (size_t p=set.binBegin(c); p<set.binBegin(c+1); p++) {
+                REQUIRE(set.cells()[p] == c);
+                const auto& q = pts[set.ids()[p]];
+                REQUIRE(set.position(0)[p] == q[0]);
+                REQUIRE(set.position(1)[p] == q[1]);
+                REQUIRE(mesh->locate(q) == c);
+            }
+        }
+    }
+
+    SECTION("Particles outside the Mesh are removed") {
+        set.add(std::array<double, 2>{{ 1.5, 0.5 }});
+        set.add(std::array<double, 2>{{ 0.5, -0.1 }});
+        set.sort();
+        REQUIRE(set.size() == 500);
+    }
+
+    SECTION("Velocity interpolation is exact for linear fields") {
+        Field<double, 2, 2> U(mesh, "U");
+        for (size_t j=0; j<7; j++) {
+            for (size_t i=0; i<12; i++) {
+                U.x()[i + 12*j] = 2*mesh->centres(0)[i] - mesh->centres(1)[j];
+                U.y()[i + 12*j] = 3;
+            }
+        }
+        ParticleSet<2> inner(mesh);
+        std::vector<std::array<double, 2>> innerPts;
+        for (const auto& q : pts) {
+            if (q[0] > mesh->centres(0).front() && q[0] < mesh->centres(0).back()
+             && q[1] > mesh->centres(1).front() && q[1] < mesh->centres(1).back()) {
+                innerPts.push_back(q);
+            }
+        }
+        inner.add(innerPts);
+        ParticleSet<2>::Components vel;
+        inner.interpolate(U, vel);
+        for (size_t p=0; p<inner.size(); p++) {
+            REQUIRE(vel[0][p] == Approx(2*innerPts[p][0] - innerPts[p][1]));
+            REQUIRE(vel[1][p] == Approx(3));
+        }
+    }
+}
+
+TEST_CASE("Particle advection", "[particles]") {
+    auto mesh = std::make_shared<Mesh<2>>(MeshScalingType::Constant,
+                                          MeshDimension(20, -1, 1),
+                                          MeshDimension(20, -1, 1));
+    const Field<double, 2, 2> U = rotation(mesh);
+    const double r = 0.5;
+    const size_t steps = 100;
+    const double dt = 0.01;
+
+    auto maxError = [&](const integratorType type) {
+        Parallel::ThreadPool pool(2);
+    ParticleSet<2> set(mesh, pool);
+        set.setSortInterval(7);
+        const auto start = ring(300, r);
+        set.add(start);
+        for (size_t s=0; s<steps; s++) {
+            set.advect(U, dt, type);
+        }
+        REQUIRE(set.size() == 300);
+        const double ct = std::cos(steps*dt), st = std::sin(steps*dt);
+        double err = 0;
+        for (size_t p=0; p<set.size(); p++) {
+            const auto& q = start[set.ids()[p]];
+            err = std::max(err, std::fabs(set.position(0)[p] - (ct*q[0] - st*q[1])));
+            err = std::max(err, std::fabs(set.position(1)[p] - (st*q[0] + ct*q[1])));
+        }
+        return err;
+    };
+
+    const double eEuler = maxError(integratorType::Euler);
+    const double eRK2 = maxError(integratorType::RK2);
+    const double eRK4 = maxError(integratorType::RK4);
+    REQUIRE(eRK4 < 1e-9);
+    REQUIRE(eRK2 < 1e-4);
+    REQUIRE(eRK4 < eRK2);
+    REQUIRE(eRK2 < eEuler);
+}
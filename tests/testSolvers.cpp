@@ -0,0 +1,499 @@
+#include "DataStructures/Field.tpp"
+#include "DataStructures/Mesh.h"
+#include "Solvers/FFT.h"
+#include "Solvers/PoissonFFT.h"
+#include "Solvers/LineSolver.h"
+#include "Solvers/OperatorAssembly.h"
+#include "Solvers/SparseMatrix.h"
+#include "Parallel/CaseRunner.h"
+#include "Parallel/ThreadPool.h"
+
+#include "catch.hpp"
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    template<typename T>
+    bool matchVectorsApprox(const std::vector<T>& v1, const std::vector<T>& v2) {
+        if (v1.size() != v2.size()) {
+            return false;
+        }
+        for (size_t i=0; i<v1.size(); i++) {
+            if (v1[i] != Approx(v2[i]).epsilon(1e-9)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    constexpr double pi = 3.141592653589793238463;
+
+    std::vector<std::complex<double>> naiveDFT(const std::vector<std::complex<double>>& x) {
+        const size_t N = x.size();
+        std::vector<std::complex<double>> X(N);
+        for (size_t k=0; k<N; k++) {
+            for (size_t n=0; n<N; n++) {
+                const double theta = -2*pi*double(k*n)/N;
+                X[k] += x[n] * std::complex<double>(std::cos(theta), std::sin(theta));
+            }
+        }
+        return X;
+    }
+
+    // Second-order Laplacian minus alpha, with ghost cells set by the
+    // boundary conditions, on a uniform mesh
+    template<size_t mD>
+    std::vector<double> applyHelmholtz(const Mesh<mD>& mesh,
+                                       const std::vector<double>& phi,
+                                       const std::array<SpectralBoundary, mD>& bcs,
+                                       const double alpha) {
+        std::vector<double> out(phi.size());
+        std::array<size_t, mD> stride;
+        size_t s = 1;
+        for (size_t d=0; d<mD; d++) {
+            stride[d] = s;
+            s *= mesh.dimSizes()[d];
+        }
+        for (size_t c=0; c<phi.size(); c++) {
+            double val = -alpha*phi[c];
+            for (size_t d=0; d<mD; d++) {
+                const size_t N = mesh.dimSizes()[d];
+                const double h = (mesh.dimMax()[d]-mesh.dimMin()[d])/N;
+                const size_t i = (c / stride[d]) % N;
+                double lo, hi;
+                if (i > 0) {
+                    lo = phi[c - stride[d]];
+                } else if (bcs[d] == SpectralBoundary::Periodic) {
+                    lo = phi[c + (N-1)*stride[d]];
+                } else {
+                    lo = (bcs[d] == SpectralBoundary::Neumann ? 1 : -1) * phi[c];
+                }
+                if (i < N-1) {
+                    hi = phi[c + stride[d]];
+                } else if (bcs[d] == SpectralBoundary::Periodic) {
+                    hi = phi[c - (N-1)*stride[d]];
+                } else {
+                    hi = (bcs[d] == SpectralBoundary::Neumann ? 1 : -1) * phi[c];
+                }
+                val += (lo - 2*phi[c] + hi)/(h*h);
+            }
+            out[c] = val;
+        }
+        return out;
+    }
+}
+
+TEST_CASE("FFT plans", "[fft]") {
+    using cplx = std::complex<double>;
+
+    for (size_t N : {1, 2, 8, 12, 15}) {
+        FFT::Plan plan(N);
+        std::vector<cplx> x(N);
+        for (size_t n=0; n<N; n++) {
+            x[n] = cplx(std::sin(0.3*n + 0.1), std::cos(1.7*n));
+        }
+        std::vector<cplx> X = x;
+        std::vector<cplx> scratch(plan.scratchSize());
+        plan.forward(X.data(), scratch.data());
+        const std::vector<cplx> ref = naiveDFT(x);
+        for (size_t k=0; k<N; k++) {
+            REQUIRE(std::abs(X[k] - ref[k]) < 1e-10);
+        }
+        plan.inverse(X.data(), scratch.data());
+        for (size_t n=0; n<N; n++) {
+            REQUIRE(std::abs(X[n] - x[n]) < 1e-12);
+        }
+    }
+
+    SECTION("Real-to-real transforms") {
+        const size_t N = 6;
+        std::vector<cplx> x(N);
+        for (size_t n=0; n<N; n++) {
+            x[n] = cplx(1.0 + 0.5*n*n, 0);
+        }
+        FFT::LineTransform dct(N, FFT::RealTransform::DCT);
+        FFT::LineTransform dst(N, FFT::RealTransform::DST);
+        std::vector<cplx> scratch(std::max(dct.scratchSize(), dst.scratchSize()));
+
+        std::vector<cplx> C = x, S = x;
+        dct.forward(C.data(), scratch.data());
+        dst.forward(S.data(), scratch.data());
+        for (size_t k=0; k<N; k++) {
+            double c = 0, s = 0;
+            for (size_t n=0; n<N; n++) {
+                c += x[n].real() * std::cos(pi*k*(2*n+1)/(2.0*N));
+                s += x[n].real() * std::sin(pi*(k+1)*(2*n+1)/(2.0*N));
+            }
+            REQUIRE(std::abs(C[k] - c) < 1e-10);
+            REQUIRE(std::abs(S[k] - s) < 1e-10);
+        }
+        dct.inverse(C.data(), scratch.data());
+        dst.inverse(S.data(), scratch.data());
+        for (size_t n=0; n<N; n++) {
+            REQUIRE(std::abs(C[n] - x[n]) < 1e-12);
+            REQUIRE(std::abs(S[n] - x[n]) < 1e-12);
+        }
+    }
+}
+
+TEST_CASE("FFT Poisson solver", "[poisson]") {
+    MeshScalingType cnst = MeshScalingType::Constant;
+
+    SECTION("Applicability") {
+        Mesh<1> piv(MeshScalingType::Pivot, MeshDimension(10, 0, 1));
+        Mesh<1> uni(cnst, MeshDimension(10, 0, 1));
+        REQUIRE(!FFTPoissonSolver<1>::isApplicable(piv));
+        REQUIRE(FFTPoissonSolver<1>::isApplicable(uni));
+    }
+
+    SECTION("Periodic 2D box") {
+        auto mesh = std::make_shared<Mesh<2>>(cnst, MeshDimension(16, 0, 1),
+                                                    MeshDimension(16, 0, 2));
+        std::array<SpectralBoundary, 2> bcs { { SpectralBoundary::Periodic,
+                                                SpectralBoundary::Periodic } };
+        Field<double, 1, 2> phi(mesh, "phi");
+        Field<double, 1, 2> rhs(mesh, "rhs");
+        for (size_t j=0; j<16; j++) {
+            for (size_t i=0; i<16; i++) {
+                const double x = (i+0.5)/16, y = 2*(j+0.5)/16;
+                phi.x()[i + 16*j] = std::sin(2*pi*x) * std::cos(pi*y);
+            }
+        }
+        rhs.x() = applyHelmholtz(*mesh, phi.x(), bcs, 0);
+
+        Parallel::ThreadPool pool(2);
+        FFTPoissonSolver<2> solver(mesh, bcs, 0, pool);
+        Field<double, 1, 2> result(mesh, "result");
+        solver.solve(rhs, result);
+        for (size_t c=0; c<mesh->numCells(); c++) {
+            REQUIRE(std::abs(result.x()[c] - phi.x()[c]) < 1e-10);
+        }
+    }
+
+    SECTION("Mixed boundaries, Helmholtz, 3D, non power-of-two") {
+        auto mesh = std::make_shared<Mesh<3>>(cnst, MeshDimension(6, 0, 1),
+                                                    MeshDimension(10, -1, 1),
+                                                    MeshDimension(7, 0, 3));
+        std::array<SpectralBoundary, 3> bcs { { SpectralBoundary::Periodic,
+                                                SpectralBoundary::Neumann,
+                                                SpectralBoundary::Dirichlet } };
+        Field<double, 1, 3> phi(mesh, "phi");
+        for (size_t c=0; c<mesh->numCells(); c++) {
+            phi.x()[c] = std::sin(0.37*c) + 0.01*c;
+        }
+        Field<double, 1, 3> rhs(mesh, "rhs");
+        rhs.x() = applyHelmholtz(*mesh, phi.x(), bcs, 2.5);
+
+        FFTPoissonSolver<3> solver(mesh, bcs, 2.5);
+        // Solve in place
+        solver.solve(rhs, rhs);
+        for (size_t c=0; c<mesh->numCells(); c++) {
+            REQUIRE(std::abs(rhs.x()[c] - phi.x()[c]) < 1e-10);
+        }
+    }
+}
+
+namespace {
+    // Apply the tridiagonal operator along dim to every line
+    template<size_t mD>
+    std::vector<double> applyTridiagonal(const Mesh<mD>& mesh, const size_t dim,
+                                         const TridiagonalCoeffs& co,
+                                         const std::vector<double>& x) {
+        size_t stride = 1;
+        for (size_t d=0; d<dim; d++) {
+            stride *= mesh.dimSizes()[d];
+        }
+        const size_t N = mesh.dimSizes()[dim];
+        std::vector<double> out(x.size());
+        for (size_t c=0; c<x.size(); c++) {
+            const size_t i = (c / stride) % N;
+            double v = co.diag[i]*x[c];
+            if (i > 0) {
+                v += co.lower[i]*x[c-stride];
+            }
+            if (i < N-1) {
+                v += co.upper[i]*x[c+stride];
+            }
+            out[c] = v;
+        }
+        return out;
+    }
+}
+
+TEST_CASE("Batched tridiagonal line solvers", "[linesolver]") {
+    using Alg = LineSolver<3>::Algorithm;
+    auto mesh = std::make_shared<Mesh<3>>(MeshScalingType::Hyperbolic,
+                                          MeshDimension(13, 0, 1),
+                                          MeshDimension(20, -1, 2),
+                                          MeshDimension(9, 0, 0.5));
+    Field<double, 3, 3> f(mesh, "f");
+    for (size_t c=0; c<mesh->numCells(); c++) {
+        f.x()[c] = std::sin(0.1*c);
+        f.y()[c] = std::cos(0.3*c) + 1;
+        f.z()[c] = 0.001*c;
+    }
+
+    Parallel::ThreadPool pool(2);
+    for (size_t dim=0; dim<3; dim++) {
+        for (Alg alg : { Alg::Thomas, Alg::CyclicReduction }) {
+            const TridiagonalCoeffs co = LineSolver<3>::implicitDiffusion(
+                        *mesh, dim, 0.05, LineBoundary::Dirichlet,
+                        LineBoundary::Neumann);
+            LineSolver<3> solver(mesh, dim, co, alg, pool);
+            REQUIRE(solver.algorithm() == alg);
+            for (size_t comp=0; comp<3; comp++) {
+                Field<double, 3, 3> g(f);
+                solver.solve(g, comp);
+                const std::vector<double> back =
+                        applyTridiagonal(*mesh, dim, co, g.component(comp));
+                REQUIRE(matchVectorsApprox(back, f.component(comp)));
+            }
+        }
+    }
+
+    SECTION("Automatic choice") {
+        auto longMesh = std::make_shared<Mesh<1>>(MeshScalingType::Constant,
+                                                  MeshDimension(4096, 0, 1));
+        const auto co = LineSolver<1>::implicitDiffusion(
+                    *longMesh, 0, 1e-3, LineBoundary::Neumann, LineBoundary::Neumann);
+        // Too few batches of lines for four threads
+        Parallel::ThreadPool four(4);
+        LineSolver<1> single(longMesh, 0, co, LineSolver<1>::Algorithm::Auto,
+                             four);
+        REQUIRE(single.algorithm() == LineSolver<1>::Algorithm::CyclicReduction);
+
+        LineSolver<3> many(mesh, 1, LineSolver<3>::implicitDiffusion(
+                               *mesh, 1, 0.1, LineBoundary::Neumann,
+                               LineBoundary::Neumann));
+        REQUIRE(many.algorithm() == Alg::Thomas);
+
+        // A uniform field is unchanged by Neumann-Neumann implicit diffusion
+        std::vector<double> ones(4096, 1.0);
+        single.solve(ones);
+        REQUIRE(matchVectorsApprox(ones, std::vector<double>(4096, 1.0)));
+    }
+
+    SECTION("Outside threads sharing a pool") {
+        auto wide = std::make_shared<Mesh<2>>(MeshScalingType::Constant,
+                                              MeshDimension(64, 0, 1),
+                                              MeshDimension(4096, 0, 1));
+        const auto co = LineSolver<2>::implicitDiffusion(
+                    *wide, 0, 0.05, LineBoundary::Dirichlet,
+                    LineBoundary::Neumann);
+        std::vector<double> rhs(wide->numCells());
+        for (size_t c=0; c<rhs.size(); c++) {
+            rhs[c] = std::sin(0.01*c);
+        }
+        Parallel::ThreadPool one(1);
+        std::vector<double> serial = rhs;
+        LineSolver<2>(wide, 0, co, LineSolver<2>::Algorithm::Thomas, one)
+            .solve(serial);
+
+        // Each thread's pieces are helped by the other threads waiting on
+        // the pool, so they must not share per-thread scratch
+        Parallel::ThreadPool shared(4);
+        const LineSolver<2> solver(wide, 0, co,
+                                   LineSolver<2>::Algorithm::Thomas, shared);
+        std::atomic<size_t> wrong(0);
+        std::vector<std::thread> threads;
+        for (size_t i=0; i<4; i++) {
+            threads.emplace_back([&]() {
+                for (size_t rep=0; rep<10; rep++) {
+                    std::vector<double> x = rhs;
+                    solver.solve(x);
+                    wrong += (x != serial);
+                }
+            });
+        }
+        for (std::thread& t : threads) {
+            t.join();
+        }
+        REQUIRE(wrong == 0);
+    }
+}
+
+TEST_CASE("Sparse operator assembly", "[sparse]") {
+    auto mesh = std::make_shared<Mesh<2>>(MeshScalingType::Exponential,
+                                          MeshDimension(12, 0, 1),
+                                          MeshDimension(9, -1, 1));
+    auto bcs = MeshBoundaries<2>::all(LineBoundary::Neumann);
+    bcs.lower[1] = LineBoundary::Dirichlet;
+    Parallel::ThreadPool pool(2);
+    OperatorAssembler<2> assembler(mesh, bcs, pool);
+    const size_t N = mesh->numCells();
+
+    SECTION("Laplacian matches the line solver coefficients") {
+        const CSRMatrix L = assembler.laplacian();
+        REQUIRE(L.rows() == N);
+        for (size_t dim=0; dim<2; dim++) {
+            const TridiagonalCoeffs co = LineSolver<2>::implicitDiffusion(
+                        *mesh, dim, 1.0, bcs.lower[dim], bcs.upper[dim]);
+            // Sum of -L over the other dimension's contributions is not
+            // separable, so compare off-diagonals only
+            const size_t stride = (dim == 0 ? 1 : 12);
+            const size_t nAlong = mesh->dimSizes()[dim];
+            for (size_t c=0; c<N; c++) {
+                const size_t i = (c/stride) % nAlong;
+                if (i > 0) {
+                    REQUIRE(L(c, c-stride) == Approx(-co.lower[i]));
+                }
+                if (i < nAlong-1) {
+                    REQUIRE(L(c, c+stride) == Approx(-co.upper[i]));
+                }
+            }
+        }
+    }
+
+    SECTION("Gradient of a linear field is exact in the interior") {
+        Field<double, 1, 2> phi(mesh, "phi");
+        for (size_t j=0; j<9; j++) {
+            for (size_t i=0; i<12; i++) {
+                phi.x()[i + 12*j] = 2*mesh->centres(0)[i] + 3*mesh->centres(1)[j];
+            }
+        }
+        SparseOperator G(assembler.gradient());
+        Field<double, 2, 2> grad(mesh, "grad");
+        G.apply(phi, grad);
+        for (size_t j=1; j<8; j++) {
+            for (size_t i=1; i<11; i++) {
+                REQUIRE(grad.x()[i + 12*j] == Approx(2));
+                REQUIRE(grad.y()[i + 12*j] == Approx(3));
+            }
+        }
+
+        // Divergence of a uniform vector field, away from the boundaries
+        SparseOperator D(assembler.divergence());
+        Field<double, 1, 2> div(mesh, "div");
+        D.apply(grad, div);
+        REQUIRE(div.x()[5 + 12*4] == Approx(0).epsilon(1e-9));
+    }
+
+    SECTION("CSR and SELL-C-sigma agree, with pattern reuse") {
+        Field<double, 1, 2> kappa(mesh, "kappa");
+        Field<double, 1, 2> phi(mesh, "phi");
+        for (size_t c=0; c<N; c++) {
+            kappa.x()[c] = 1 + 0.5*std::sin(0.2*c);
+            phi.x()[c] = std::cos(0.7*c);
+        }
+        CSRMatrix A = assembler.diffusion(kappa, -1.0);
+        REQUIRE(A.patternPtr() == assembler.laplacian().patternPtr());
+
+        SparseOperator csr(A, SparseFormat::CSR, pool);
+        SparseOperator sell(A, SparseFormat::SellCSigma, pool);
+        SparseOperator automatic(A);
+        REQUIRE(automatic.format() == SparseFormat::SellCSigma);
+
+        Field<double, 1, 2> y1(mesh, "y1"), y2(mesh, "y2");
+        csr.apply(phi, y1);
+        sell.apply(phi, y2);
+        REQUIRE(matchVectorsApprox(y1.x(), y2.x()));
+
+        // New coefficients, same structure
+        kappa *= 3;
+        assembler.diffusion(kappa, -1.0, A);
+        csr.refresh(A);
+        sell.refresh(A);
+        csr.apply(phi, y1);
+        sell.apply(phi, y2);
+        REQUIRE(matchVectorsApprox(y1.x(), y2.x()));
+        std::vector<double> ref(N);
+        A.multiply(phi.x().data(), ref.data());
+        REQUIRE(matchVectorsApprox(ref, y2.x()));
+    }
+
+    SECTION("Irregular rows fall back to CSR") {
+        auto p = std::make_shared<SparsityPattern>();
+        p->rows = 1024;
+        p->cols = 1024;
+        p->rowPtr.push_back(0);
+        // Four long rows per sorting window leave half a chunk padded
+        for (size_t r=0; r<1024; r++) {
+            const size_t len = (r % 64 == 0 ? 64 : 1);
+            for (size_t c=0; c<len; c++) {
+                p->colIdx.push_back(len == 1 ? r : c);
+            }
+            p->rowPtr.push_back(p->colIdx.size());
+        }
+        CSRMatrix A(p);
+        SparseOperator op(A);
+        REQUIRE(op.format() == SparseFormat::CSR);
+    }
+
+    SECTION("An assembler shared between threads builds each pattern once") {
+        const CSRMatrix refL = assembler.laplacian();
+        const CSRMatrix refD = assembler.divergence();
+        // A fresh assembler, so the patterns are built by the threads
+        OperatorAssembler<2> shared(mesh, bcs, pool);
+        std::vector<CSRMatrix> L, D;
+        for (size_t i=0; i<4; i++) {
+            L.push_back(refL);
+            D.push_back(refD);
+        }
+        std::vector<std::thread> threads;
+        for (size_t i=0; i<4; i++) {
+            threads.emplace_back([&shared, &L, &D, i]() {
+                L[i] = shared.laplacian();
+                D[i] = shared.divergence();
+            });
+        }
+        for (std::thread& t : threads) {
+            t.join();
+        }
+        for (size_t i=0; i<4; i++) {
+            REQUIRE(&L[i].pattern() == &L[0].pattern());
+            REQUIRE(&D[i].pattern() == &D[0].pattern());
+            REQUIRE(L[i].pattern().colIdx == refL.pattern().colIdx);
+            REQUIRE(L[i].values() == refL.values());
+            REQUIRE(D[i].values() == refD.values());
+        }
+    }
+}
+
+TEST_CASE("Solvers in concurrent cases", "[caserunner]") {
+    auto mesh = std::make_shared<Mesh<2>>(MeshScalingType::Constant,
+                                          MeshDimension(64, 0, 1),
+                                          MeshDimension(256, 0, 1));
+    const std::array<SpectralBoundary, 2> bcs { {
+        SpectralBoundary::Periodic, SpectralBoundary::Neumann } };
+    const auto co = LineSolver<2>::implicitDiffusion(
+                *mesh, 0, 0.05, LineBoundary::Dirichlet, LineBoundary::Neumann);
+    Field<double, 1, 2> rhs(mesh, "rhs");
+    for (size_t c=0; c<mesh->numCells(); c++) {
+        rhs.x()[c] = std::sin(0.01*c) + 0.1*std::cos(0.3*c);
+    }
+
+    // One line solve then a Poisson solve, with the loops on pool
+    auto solveCase = [&](Parallel::ThreadPool& pool) {
+        Field<double, 1, 2> q(rhs, "q");
+        LineSolver<2>(mesh, 0, co, LineSolver<2>::Algorithm::Thomas, pool)
+            .solve(q, 0);
+        FFTPoissonSolver<2>(mesh, bcs, 1.0, pool).solve(q, q);
+        return q;
+    };
+    Parallel::ThreadPool one(1);
+    const Field<double, 1, 2> serial = solveCase(one);
+
+    // The cases run on a pool of their own, and are outside threads of the
+    // pool their loops run on
+    Parallel::ThreadPool four(4);
+    for (Parallel::ThreadPool* loops : { &Parallel::ThreadPool::global(),
+                                         &four }) {
+        Parallel::ThreadPool runnerPool(4);
+        Parallel::CaseRunner runner(runnerPool);
+        std::atomic<size_t> wrong(0);
+        for (size_t i=0; i<8; i++) {
+            runner.add("case " + std::to_string(i), 1.0, [&]() {
+                wrong += !(solveCase(*loops) == serial);
+            });
+        }
+        runner.run();
+        REQUIRE(wrong == 0);
+    }
+}